@@ -284,8 +284,11 @@ static int l_Luno_Close(lua_State *L)
     return 0;
 }
 
+static lua_State *load_callback_state; // State running luno.update or luno.wait_load, load callbacks are called on it
+
 static int l_Luno_Update(lua_State *L)
 {
+    load_callback_state = L; // Finished loads call back from inside Luno_Update
     if (!Luno_Update())
     {
         lua_pushboolean(L, 0); // Push `false` if Luno_Update() indicates termination
@@ -440,6 +443,15 @@ static int l_Luno_LoadImageMem(lua_State *L)
     return 1;
 }
 
+// Luno_SaveImage
+static int l_Luno_SaveImage(lua_State *L)
+{
+    LunoImage *image = *(LunoImage **)luaL_checkudata(L, 1, "LunoImage");
+    const char *filePath = luaL_checkstring(L, 2);
+    lua_pushboolean(L, Luno_SaveImage(image, filePath));
+    return 1;
+}
+
 // Luno_FillImage
 static int l_Luno_FillImage(lua_State *L)
 {
@@ -486,11 +498,84 @@ static int l_Luno_DrawImageRect(lua_State *L)
     return 0;
 }
 
+// Pushes a view of the image at `index` and keeps that image alive as long as the view.
+static void push_image_view(lua_State *L, int index, LunoImage *view)
+{
+    *(LunoImage **)lua_newuserdatauv(L, sizeof(LunoImage *), 1) = view;
+    luaL_getmetatable(L, "LunoImage");
+    lua_setmetatable(L, -2);
+    lua_pushvalue(L, index);
+    lua_setiuservalue(L, -2, 1);
+}
+
+// Luno_CreateImageView
+static int l_Luno_CreateImageView(lua_State *L)
+{
+    LunoImage *image = *(LunoImage **)luaL_checkudata(L, 1, "LunoImage");
+    LunoRect *rect = (LunoRect *)luaL_checkudata(L, 2, "LunoRect");
+    LunoImage *view = Luno_CreateImageView(image, *rect);
+
+    if (!view)
+    {
+        return luaL_error(L, "Failed to create image view");
+    }
+
+    push_image_view(L, 1, view);
+    return 1;
+}
+
+// Luno_SliceImage
+static int l_Luno_SliceImage(lua_State *L)
+{
+    LunoImage *image = *(LunoImage **)luaL_checkudata(L, 1, "LunoImage");
+    int frameWidth = luaL_checkinteger(L, 2);
+    int frameHeight = luaL_checkinteger(L, 3);
+    int count = Luno_SliceImage(image, frameWidth, frameHeight, NULL, 0);
+
+    lua_createtable(L, count, 0);
+    int columns = count > 0 ? image->width / frameWidth : 1;
+    for (int i = 0; i < count; i++)
+    {
+        LunoRect frame = {(i % columns) * frameWidth, (i / columns) * frameHeight, frameWidth, frameHeight};
+        LunoImage *view = Luno_CreateImageView(image, frame);
+        if (!view)
+        {
+            return luaL_error(L, "Failed to create image view");
+        }
+        push_image_view(L, 1, view);
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+// Luno_OpenPak
+static int l_Luno_OpenPak(lua_State *L)
+{
+    *(LunoPak **)lua_newuserdata(L, sizeof(LunoPak *)) = Luno_OpenPak(luaL_checkstring(L, 1));
+    luaL_getmetatable(L, "LunoPak");
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+// Luno_ClosePak
+static int l_Luno_ClosePak(lua_State *L)
+{
+    LunoPak **pak = (LunoPak **)luaL_checkudata(L, 1, "LunoPak");
+    Luno_ClosePak(*pak);
+    *pak = NULL;
+    return 0;
+}
+
 // Luno_DestroyImage
 static int l_Luno_DestroyImage(lua_State *L)
 {
-    LunoImage *image = *(LunoImage **)luaL_checkudata(L, 1, "LunoImage");
-    Luno_DestroyImage(image);
+    LunoImage **image = (LunoImage **)luaL_checkudata(L, 1, "LunoImage");
+    if (*image)
+    {
+        Luno_DestroyImage(*image);
+        *image = NULL;
+    }
     return 0;
 }
 
@@ -522,6 +607,35 @@ static int l_Luno_DrawCircle(lua_State *L)
     return 0;
 }
 
+// Luno_DrawEllipse
+static int l_Luno_DrawEllipse(lua_State *L)
+{
+    int x = luaL_checkinteger(L, 1);
+    int y = luaL_checkinteger(L, 2);
+    int radiusX = luaL_checkinteger(L, 3);
+    int radiusY = luaL_checkinteger(L, 4);
+    LunoColor color;
+
+    if (lua_type(L, 5) == LUA_TUSERDATA)
+    {
+        // If it's a LunoColor userdata, extract the value directly
+        color = *(LunoColor *)luaL_checkudata(L, 5, "LunoColor");
+    }
+    else if (lua_type(L, 5) == LUA_TTABLE)
+    {
+        // If it's a Lua table, parse it into a LunoColor
+        color = luaL_checkLunoColor(L, 5);
+    }
+    else
+    {
+        return luaL_error(L, "bad argument #5 to 'draw_ellipse' (LunoColor or table expected)");
+    }
+
+    bool fill = lua_toboolean(L, 6);
+    Luno_DrawEllipse(x, y, radiusX, radiusY, color, fill);
+    return 0;
+}
+
 // Luno_DrawLine
 static int l_Luno_DrawLine(lua_State *L)
 {
@@ -684,6 +798,168 @@ static int l_Luno_IsCursorVisible(lua_State *L)
     return 1;
 }
 
+/**********************************************************************************
+ *
+ * Multithreading Bindings
+ *
+ **********************************************************************************/
+
+// Luno_SetThreadCount
+static int l_Luno_SetThreadCount(lua_State *L)
+{
+    int count = luaL_checkinteger(L, 1);
+    Luno_SetThreadCount(count);
+    return 0;
+}
+
+// Luno_GetThreadCount
+static int l_Luno_GetThreadCount(lua_State *L)
+{
+    lua_pushinteger(L, Luno_GetThreadCount());
+    return 1;
+}
+
+// Luno_SetTiledRendering
+static int l_Luno_SetTiledRendering(lua_State *L)
+{
+    bool enabled = lua_toboolean(L, 1);
+    Luno_SetTiledRendering(enabled);
+    return 0;
+}
+
+// Luno_SetFrameStats
+static int l_Luno_SetFrameStats(lua_State *L)
+{
+    bool enabled = lua_toboolean(L, 1);
+    Luno_SetFrameStats(enabled);
+    return 0;
+}
+
+// Luno_GetFrameStats
+static int l_Luno_GetFrameStats(lua_State *L)
+{
+    static const char *primitives[LUNO_PRIMITIVE_COUNT] = {"clear", "pixel", "line", "rect", "circle", "ellipse", "image", "text"};
+    LunoFrameStats stats;
+    Luno_GetFrameStats(&stats);
+
+    lua_newtable(L);
+    lua_pushnumber(L, stats.frameTime);
+    lua_setfield(L, -2, "frame_time");
+    lua_pushnumber(L, stats.drawTime);
+    lua_setfield(L, -2, "draw_time");
+    lua_pushnumber(L, stats.presentTime);
+    lua_setfield(L, -2, "present_time");
+    lua_pushnumber(L, stats.sleepTime);
+    lua_setfield(L, -2, "sleep_time");
+    lua_pushnumber(L, stats.pumpTime);
+    lua_setfield(L, -2, "pump_time");
+    lua_pushnumber(L, stats.minFrameTime);
+    lua_setfield(L, -2, "min_frame_time");
+    lua_pushnumber(L, stats.avgFrameTime);
+    lua_setfield(L, -2, "avg_frame_time");
+    lua_pushnumber(L, stats.p99FrameTime);
+    lua_setfield(L, -2, "p99_frame_time");
+    lua_pushnumber(L, stats.maxFrameTime);
+    lua_setfield(L, -2, "max_frame_time");
+
+    // draws / pixels: tables keyed by primitive name
+    lua_newtable(L);
+    for (int i = 0; i < LUNO_PRIMITIVE_COUNT; i++)
+    {
+        lua_pushinteger(L, stats.draws[i]);
+        lua_setfield(L, -2, primitives[i]);
+    }
+    lua_setfield(L, -2, "draws");
+    lua_newtable(L);
+    for (int i = 0; i < LUNO_PRIMITIVE_COUNT; i++)
+    {
+        lua_pushinteger(L, (lua_Integer)stats.pixels[i]);
+        lua_setfield(L, -2, primitives[i]);
+    }
+    lua_setfield(L, -2, "pixels");
+    return 1;
+}
+
+// Luno_SetStatsOverlay
+static int l_Luno_SetStatsOverlay(lua_State *L)
+{
+    bool visible = lua_toboolean(L, 1);
+    Luno_SetStatsOverlay(visible);
+    return 0;
+}
+
+// Luno_SetFrameBuffering
+static int l_Luno_SetFrameBuffering(lua_State *L)
+{
+    int count = luaL_checkinteger(L, 1);
+    Luno_SetFrameBuffering(count);
+    return 0;
+}
+
+/**********************************************************************************
+ *
+ * Command Buffer Bindings
+ *
+ **********************************************************************************/
+
+// Returns the command buffer of the userdata at `index`, raising an error once it was destroyed
+static LunoCommandBuffer *luaL_checkLunoCommandBuffer(lua_State *L, int index)
+{
+    LunoCommandBuffer *buffer = *(LunoCommandBuffer **)luaL_checkudata(L, index, "LunoCommandBuffer");
+    if (!buffer)
+    {
+        luaL_error(L, "Command buffer was destroyed");
+    }
+    return buffer;
+}
+
+// Luno_CreateCommandBuffer
+static int l_Luno_CreateCommandBuffer(lua_State *L)
+{
+    *(LunoCommandBuffer **)lua_newuserdata(L, sizeof(LunoCommandBuffer *)) = Luno_CreateCommandBuffer();
+    luaL_getmetatable(L, "LunoCommandBuffer");
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+// Luno_BeginCommandBuffer
+static int l_Luno_BeginCommandBuffer(lua_State *L)
+{
+    Luno_BeginCommandBuffer(luaL_checkLunoCommandBuffer(L, 1));
+    return 0;
+}
+
+// Luno_EndCommandBuffer
+static int l_Luno_EndCommandBuffer(lua_State *L)
+{
+    Luno_EndCommandBuffer();
+    return 0;
+}
+
+// Luno_SubmitCommandBuffer
+static int l_Luno_SubmitCommandBuffer(lua_State *L)
+{
+    Luno_SubmitCommandBuffer(luaL_checkLunoCommandBuffer(L, 1));
+    return 0;
+}
+
+// Luno_GetCommandCount
+static int l_Luno_GetCommandCount(lua_State *L)
+{
+    lua_pushinteger(L, Luno_GetCommandCount(luaL_checkLunoCommandBuffer(L, 1)));
+    return 1;
+}
+
+// Luno_DestroyCommandBuffer (also the __gc metamethod, so it must tolerate being called twice)
+static int l_Luno_DestroyCommandBuffer(lua_State *L)
+{
+    LunoCommandBuffer **buffer = (LunoCommandBuffer **)luaL_checkudata(L, 1, "LunoCommandBuffer");
+    Luno_DestroyCommandBuffer(*buffer);
+    *buffer = NULL;
+    return 0;
+}
+
 /**********************************************************************************
  *
  * Timer Functions Bindings
@@ -728,6 +1004,292 @@ static int l_Luno_TimerElapsed(lua_State *L)
     return 1;
 }
 
+// Luno_StartTimer
+static int l_Luno_StartTimer(lua_State *L)
+{
+    int delay = luaL_checkinteger(L, 1);
+    int interval = luaL_optinteger(L, 2, 0);
+    lua_pushinteger(L, Luno_StartTimer(delay, interval, NULL, NULL));
+    return 1;
+}
+
+// Luno_CancelTimer
+static int l_Luno_CancelTimer(lua_State *L)
+{
+    lua_pushboolean(L, Luno_CancelTimer(luaL_checkinteger(L, 1)));
+    return 1;
+}
+
+// Luno_IsTimerPending
+static int l_Luno_IsTimerPending(lua_State *L)
+{
+    lua_pushboolean(L, Luno_IsTimerPending(luaL_checkinteger(L, 1)));
+    return 1;
+}
+
+// Luno_GetExpiredTimers
+static int l_Luno_GetExpiredTimers(lua_State *L)
+{
+    int count = Luno_GetExpiredTimers(NULL, 0);
+    int *timers = (int *)malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!timers)
+        return luaL_error(L, "Out of memory");
+    Luno_GetExpiredTimers(timers, count);
+
+    lua_createtable(L, count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        lua_pushinteger(L, timers[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    free(timers);
+    return 1;
+}
+
+// Luno_GetTimeNs
+static int l_Luno_GetTimeNs(lua_State *L)
+{
+    lua_pushinteger(L, (lua_Integer)Luno_GetTimeNs());
+    return 1;
+}
+
+// Luno_SetFixedTimestep
+static int l_Luno_SetFixedTimestep(lua_State *L)
+{
+    Luno_SetFixedTimestep(luaL_checknumber(L, 1));
+    return 0;
+}
+
+// Luno_StepFixed
+static int l_Luno_StepFixed(lua_State *L)
+{
+    lua_pushboolean(L, Luno_StepFixed());
+    return 1;
+}
+
+// Luno_GetInterpolationAlpha
+static int l_Luno_GetInterpolationAlpha(lua_State *L)
+{
+    lua_pushnumber(L, Luno_GetInterpolationAlpha());
+    return 1;
+}
+
+/**********************************************************************************
+ *
+ * Async Loading Bindings
+ *
+ **********************************************************************************/
+
+// Callbacks and memory buffers of loads are kept in a registry table keyed by handle until the load is taken or
+// cancelled, so the collector leaves them alone while a background thread may still use them
+static void push_load_entries(lua_State *L)
+{
+    if (lua_getfield(L, LUA_REGISTRYINDEX, "LunoLoads") != LUA_TTABLE)
+    {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, "LunoLoads");
+    }
+}
+
+// Stores the value on top of the stack as the entry of `load` and pops it
+static void set_load_entry(lua_State *L, int load)
+{
+    push_load_entries(L);
+    lua_insert(L, -2);
+    lua_rawseti(L, -2, load);
+    lua_pop(L, 1);
+}
+
+static void load_finished(int load, void *user)
+{
+    lua_State *L = load_callback_state;
+    push_load_entries(L);
+    lua_rawgeti(L, -1, load);
+    lua_getfield(L, -1, "callback");
+    lua_pushinteger(L, load);
+    if (lua_pcall(L, 1, 0, 0) != LUA_OK)
+    {
+        fprintf(stderr, "Lua Error: %s\n", lua_tostring(L, -1));
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+}
+
+// Queues a load through `start` with the optional priority and callback at `index` and `index + 1`. `buffer`, if
+// given, is the stack index of the string a load from memory decodes.
+static int start_load(lua_State *L, int index, int buffer, int (*start)(lua_State *L, int priority, void (*callback)(int load, void *user)))
+{
+    int priority = luaL_optinteger(L, index, 0);
+    bool callback = !lua_isnoneornil(L, index + 1);
+    if (callback)
+        luaL_checktype(L, index + 1, LUA_TFUNCTION);
+
+    int load = start(L, priority, callback ? load_finished : NULL);
+    if (load && (callback || buffer))
+    {
+        lua_createtable(L, 0, 2);
+        if (callback)
+        {
+            lua_pushvalue(L, index + 1);
+            lua_setfield(L, -2, "callback");
+        }
+        if (buffer)
+        {
+            lua_pushvalue(L, buffer);
+            lua_setfield(L, -2, "buffer");
+        }
+        set_load_entry(L, load);
+    }
+    lua_pushinteger(L, load);
+    return 1;
+}
+
+static int start_image_load(lua_State *L, int priority, void (*callback)(int load, void *user))
+{
+    return Luno_LoadImageAsync(luaL_checkstring(L, 1), priority, callback, NULL);
+}
+
+static int start_image_mem_load(lua_State *L, int priority, void (*callback)(int load, void *user))
+{
+    size_t len;
+    const char *buffer = luaL_checklstring(L, 1, &len);
+    return Luno_LoadImageMemAsync((unsigned char *)buffer, (int)len, priority, callback, NULL);
+}
+
+static int start_font_load(lua_State *L, int priority, void (*callback)(int load, void *user))
+{
+    return Luno_LoadFontAsync(luaL_checkstring(L, 1), luaL_checkinteger(L, 2), luaL_checkinteger(L, 3), priority, callback, NULL);
+}
+
+// Luno_LoadImageAsync
+static int l_Luno_LoadImageAsync(lua_State *L)
+{
+    return start_load(L, 2, 0, start_image_load);
+}
+
+// Luno_LoadImageMemAsync
+static int l_Luno_LoadImageMemAsync(lua_State *L)
+{
+    return start_load(L, 2, 1, start_image_mem_load);
+}
+
+// Luno_LoadFontAsync
+static int l_Luno_LoadFontAsync(lua_State *L)
+{
+    return start_load(L, 4, 0, start_font_load);
+}
+
+// Luno_GetLoadState
+static int l_Luno_GetLoadState(lua_State *L)
+{
+    static const char *const states[] = {"none", "pending", "done", "failed"};
+    lua_pushstring(L, states[Luno_GetLoadState(luaL_checkinteger(L, 1))]);
+    return 1;
+}
+
+// Luno_GetLoadError
+static int l_Luno_GetLoadError(lua_State *L)
+{
+    lua_pushstring(L, Luno_GetLoadError(luaL_checkinteger(L, 1)));
+    return 1;
+}
+
+// Luno_TakeLoadedImage
+static int l_Luno_TakeLoadedImage(lua_State *L)
+{
+    int load = luaL_checkinteger(L, 1);
+    LunoImage *image = Luno_TakeLoadedImage(load);
+    if (Luno_GetLoadState(load) == LUNO_LOAD_NONE)
+    {
+        lua_pushnil(L);
+        set_load_entry(L, load);
+    }
+    if (!image)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    *(LunoImage **)lua_newuserdata(L, sizeof(LunoImage *)) = image;
+    luaL_getmetatable(L, "LunoImage");
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+// Luno_TakeLoadedFont
+static int l_Luno_TakeLoadedFont(lua_State *L)
+{
+    int load = luaL_checkinteger(L, 1);
+    LunoFont *font = Luno_TakeLoadedFont(load);
+    if (Luno_GetLoadState(load) == LUNO_LOAD_NONE)
+    {
+        lua_pushnil(L);
+        set_load_entry(L, load);
+    }
+    if (!font)
+    {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    *(LunoFont **)lua_newuserdata(L, sizeof(LunoFont *)) = font;
+    luaL_getmetatable(L, "LunoFont");
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+// Luno_CancelLoad
+static int l_Luno_CancelLoad(lua_State *L)
+{
+    int load = luaL_checkinteger(L, 1);
+    bool cancelled = Luno_CancelLoad(load);
+    if (cancelled)
+    {
+        lua_pushnil(L);
+        set_load_entry(L, load);
+    }
+    lua_pushboolean(L, cancelled);
+    return 1;
+}
+
+// Luno_SetLoadPriority
+static int l_Luno_SetLoadPriority(lua_State *L)
+{
+    lua_pushboolean(L, Luno_SetLoadPriority(luaL_checkinteger(L, 1), luaL_checkinteger(L, 2)));
+    return 1;
+}
+
+// Luno_WaitLoad
+static int l_Luno_WaitLoad(lua_State *L)
+{
+    load_callback_state = L;
+    lua_pushboolean(L, Luno_WaitLoad(luaL_checkinteger(L, 1)));
+    return 1;
+}
+
+// Luno_GetFinishedLoads
+static int l_Luno_GetFinishedLoads(lua_State *L)
+{
+    int count = Luno_GetFinishedLoads(NULL, 0);
+    int *loads = (int *)malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!loads)
+        return luaL_error(L, "Out of memory");
+    Luno_GetFinishedLoads(loads, count);
+
+    lua_createtable(L, count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        lua_pushinteger(L, loads[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    free(loads);
+    return 1;
+}
+
 /**********************************************************************************
  *
  * Font Handling Bindings
@@ -1108,15 +1670,21 @@ static const luaL_Reg lunolib[] = {
     {"create_image", l_Luno_CreateImage},
     {"load_image", l_Luno_LoadImage},
     {"load_image_mem", l_Luno_LoadImageMem},
+    {"save_image", l_Luno_SaveImage},
     {"draw_pixel", l_Luno_DrawPixel},
     {"get_pixel", l_Luno_GetPixel},
     {"draw_line", l_Luno_DrawLine},
     {"draw_rect", l_Luno_DrawRect},
     {"draw_circle", l_Luno_DrawCircle},
+    {"draw_ellipse", l_Luno_DrawEllipse},
     {"fill_image", l_Luno_FillImage},
     {"draw_image", l_Luno_DrawImage},
     {"draw_image_rect", l_Luno_DrawImageRect},
     {"destroy_image", l_Luno_DestroyImage},
+    {"create_image_view", l_Luno_CreateImageView},
+    {"slice_image", l_Luno_SliceImage},
+    {"open_pak", l_Luno_OpenPak},
+    {"close_pak", l_Luno_ClosePak},
     {"set_clear_color", l_Luno_SetClearColor},
     {"clear", l_Luno_Clear},
     // Keyboard and mouse input functions
@@ -1133,8 +1701,44 @@ static const luaL_Reg lunolib[] = {
     {"timer_ticked", l_Luno_TimerTicked},
     {"reset_timer", l_Luno_ResetTimer},
     {"timer_elapsed", l_Luno_TimerElapsed},
+    {"start_timer", l_Luno_StartTimer},
+    {"cancel_timer", l_Luno_CancelTimer},
+    {"is_timer_pending", l_Luno_IsTimerPending},
+    {"get_expired_timers", l_Luno_GetExpiredTimers},
+    {"get_time_ns", l_Luno_GetTimeNs},
+    {"set_fixed_timestep", l_Luno_SetFixedTimestep},
+    {"step_fixed", l_Luno_StepFixed},
+    {"get_interpolation_alpha", l_Luno_GetInterpolationAlpha},
+    // Async loading functions
+    {"load_image_async", l_Luno_LoadImageAsync},
+    {"load_image_mem_async", l_Luno_LoadImageMemAsync},
+    {"load_font_async", l_Luno_LoadFontAsync},
+    {"get_load_state", l_Luno_GetLoadState},
+    {"get_load_error", l_Luno_GetLoadError},
+    {"take_loaded_image", l_Luno_TakeLoadedImage},
+    {"take_loaded_font", l_Luno_TakeLoadedFont},
+    {"cancel_load", l_Luno_CancelLoad},
+    {"set_load_priority", l_Luno_SetLoadPriority},
+    {"wait_load", l_Luno_WaitLoad},
+    {"get_finished_loads", l_Luno_GetFinishedLoads},
     {"set_cursor_visibility", l_Luno_SetCursorVisibility},
     {"is_cursor_visible", l_Luno_IsCursorVisible},
+    // Multithreading functions
+    {"set_thread_count", l_Luno_SetThreadCount},
+    {"get_thread_count", l_Luno_GetThreadCount},
+    {"set_tiled_rendering", l_Luno_SetTiledRendering},
+    {"set_frame_buffering", l_Luno_SetFrameBuffering},
+    // Frame statistics functions
+    {"set_frame_stats", l_Luno_SetFrameStats},
+    {"get_frame_stats", l_Luno_GetFrameStats},
+    {"set_stats_overlay", l_Luno_SetStatsOverlay},
+    // Command buffer functions
+    {"create_command_buffer", l_Luno_CreateCommandBuffer},
+    {"begin_command_buffer", l_Luno_BeginCommandBuffer},
+    {"end_command_buffer", l_Luno_EndCommandBuffer},
+    {"submit_command_buffer", l_Luno_SubmitCommandBuffer},
+    {"get_command_count", l_Luno_GetCommandCount},
+    {"destroy_command_buffer", l_Luno_DestroyCommandBuffer},
     // Font functions
     {"font_from_image", l_Luno_FontFromImage},
     {"load_font", l_Luno_LoadFont},
@@ -1174,6 +1778,16 @@ int luaopen_luno(lua_State *L)
     lua_setfield(L, -2, "__gc");
     lua_pop(L, 1);
 
+    // Register LunoPak metatable (no __gc: images loaded from a bundle may outlive its handle)
+    luaL_newmetatable(L, "LunoPak");
+    lua_pop(L, 1);
+
+    // Register LunoCommandBuffer metatable
+    luaL_newmetatable(L, "LunoCommandBuffer");
+    lua_pushcfunction(L, l_Luno_DestroyCommandBuffer);
+    lua_setfield(L, -2, "__gc");
+    lua_pop(L, 1);
+
     register_luno_timers(L);
 
     return 1;
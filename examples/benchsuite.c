@@ -0,0 +1,1239 @@
+// Headless benchmark suite: every primitive and loader at several sizes and alpha modes, reported as JSON.
+// Build: gcc -O3 -march=native -DLUNO_HEADLESS -o benchsuite benchsuite.c -lm -pthread
+//
+// Usage: benchsuite [options]
+//   --out FILE        write the JSON report to FILE instead of stdout
+//   --compare FILE    compare against a saved report and flag regressions (exit code 1 if any)
+//   --threshold PCT   slowdown in percent that counts as a regression (default 10)
+//   --filter TEXT     only run cases whose name contains TEXT
+//   --time SECONDS    measuring time per case (default 0.3)
+//   --assets DIR      directory of TGA and QOI images for the codec/ cases (default assets)
+//
+// Save a baseline with `benchsuite --out base.json`, then check a change with `benchsuite --compare base.json`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// Count every allocation Luno makes
+static long long benchAllocs;
+static long long benchAllocBytes;
+
+static void *BenchMalloc(size_t size)
+{
+    benchAllocs++;
+    benchAllocBytes += size;
+    return malloc(size);
+}
+
+static void *BenchCalloc(size_t count, size_t size)
+{
+    benchAllocs++;
+    benchAllocBytes += count * size;
+    return calloc(count, size);
+}
+
+static void *BenchRealloc(void *pointer, size_t size)
+{
+    benchAllocs++;
+    benchAllocBytes += size;
+    return realloc(pointer, size);
+}
+
+#define LUNO_MALLOC(size) BenchMalloc(size)
+#define LUNO_CALLOC(count, size) BenchCalloc(count, size)
+#define LUNO_REALLOC(pointer, size) BenchRealloc(pointer, size)
+#define LUNO_FREE(pointer) free(pointer)
+
+#define LUNO_IMPL
+#include "../luno.h"
+
+#ifdef _WIN32
+static double BenchNow(void)
+{
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)freq.QuadPart;
+}
+#else
+static double BenchNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+#endif
+
+// --- Results ---
+
+#define BENCH_MAX_RESULTS 512
+
+typedef struct
+{
+    char name[64];
+    double nsPerCall;
+    double mpixPerSec; // 0 for cases that do not write pixels
+    double allocsPerCall;
+    double bytesPerCall;
+} BenchResult;
+
+static BenchResult benchResults[BENCH_MAX_RESULTS];
+static int benchResultCount;
+static const char *benchFilter;
+static double benchTime = 0.3;
+
+// Measures `fn`, which performs `batch` calls of the primitive writing `pixels` pixels in total. The case runs in
+// three rounds and keeps the fastest, which is far more stable between runs than the mean.
+static void Run(const char *name, void (*fn)(void), double pixels, int batch)
+{
+    if (benchFilter && !strstr(name, benchFilter))
+        return;
+    if (benchResultCount == BENCH_MAX_RESULTS)
+    {
+        fprintf(stderr, "Too many benchmark cases, raise BENCH_MAX_RESULTS\n");
+        exit(1);
+    }
+
+    fn(); // warm up
+
+    double best = 0;
+    long long allocs = 0, bytes = 0, calls = 0;
+    for (int round = 0; round < 3; round++)
+    {
+        long long allocsBefore = benchAllocs, bytesBefore = benchAllocBytes;
+        int n = 0;
+        double start = BenchNow();
+        double elapsed;
+        do
+        {
+            fn();
+            n++;
+            elapsed = BenchNow() - start;
+        } while (elapsed < benchTime / 3);
+
+        double ns = elapsed / n * 1e9 / batch;
+        if (round == 0 || ns < best)
+            best = ns;
+        allocs += benchAllocs - allocsBefore;
+        bytes += benchAllocBytes - bytesBefore;
+        calls += (long long)n * batch;
+    }
+
+    BenchResult *result = &benchResults[benchResultCount++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->nsPerCall = best;
+    result->mpixPerSec = pixels > 0 ? pixels / batch / best * 1e3 : 0;
+    result->allocsPerCall = (double)allocs / calls;
+    result->bytesPerCall = (double)bytes / calls;
+    fprintf(stderr, "%-40s %12.1f ns/call %10.1f Mpix/s %8.2f allocs/call\n", result->name, result->nsPerCall,
+            result->mpixPerSec, result->allocsPerCall);
+}
+
+static void WriteReport(FILE *file)
+{
+#ifdef LUNO_PREMULTIPLIED
+    const char *blendMode = "premultiplied";
+#else
+    const char *blendMode = "straight";
+#endif
+#if defined(LUNO_AVX2)
+    const char *simd = "avx2";
+#elif defined(LUNO_SSE2)
+    const char *simd = "sse2";
+#else
+    const char *simd = "scalar";
+#endif
+    fprintf(file, "{\n  \"blend\": \"%s\",\n  \"simd\": \"%s\",\n  \"threads\": %d,\n  \"results\": [\n", blendMode,
+            simd, Luno_GetThreadCount());
+    for (int i = 0; i < benchResultCount; i++)
+    {
+        BenchResult *r = &benchResults[i];
+        fprintf(file,
+                "    {\"name\": \"%s\", \"ns_per_call\": %.3f, \"mpix_per_s\": %.3f, \"allocs_per_call\": %.4f, "
+                "\"bytes_per_call\": %.1f}%s\n",
+                r->name, r->nsPerCall, r->mpixPerSec, r->allocsPerCall, r->bytesPerCall,
+                i + 1 < benchResultCount ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+// Reads the value following `"key": ` in `entry`, returns false when the entry has no such key.
+static bool ReadNumber(const char *entry, const char *end, const char *key, double *value)
+{
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    const char *found = strstr(entry, pattern);
+    if (!found || found > end)
+        return false;
+    *value = strtod(found + strlen(pattern), NULL);
+    return true;
+}
+
+// Compares the results with a report written by an earlier run. Cases slower by more than `threshold` percent,
+// or allocating more often, are flagged. Returns the number of regressions.
+static int Compare(const char *path, double threshold)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open baseline %s\n", path);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = (char *)malloc(size + 1);
+    size = (long)fread(text, 1, size, file);
+    text[size] = 0;
+    fclose(file);
+
+    int regressions = 0, matched = 0;
+    printf("%-40s %12s %12s %8s\n", "case", "baseline ns", "current ns", "change");
+    for (int i = 0; i < benchResultCount; i++)
+    {
+        BenchResult *r = &benchResults[i];
+        char pattern[sizeof(r->name) + 16];
+        snprintf(pattern, sizeof(pattern), "\"name\": \"%.63s\"", r->name);
+        const char *entry = strstr(text, pattern);
+        if (!entry)
+        {
+            printf("%-40s %12s %12.1f %8s  new\n", r->name, "-", r->nsPerCall, "");
+            continue;
+        }
+        const char *end = strchr(entry, '}');
+        end = end ? end : text + size;
+
+        double baseNs = 0, baseAllocs = 0;
+        if (!ReadNumber(entry, end, "ns_per_call", &baseNs) || baseNs <= 0)
+            continue;
+        ReadNumber(entry, end, "allocs_per_call", &baseAllocs);
+        matched++;
+
+        double change = (r->nsPerCall / baseNs - 1) * 100;
+        bool slower = change > threshold;
+        bool allocates = r->allocsPerCall > baseAllocs + 1e-3;
+        printf("%-40s %12.1f %12.1f %+7.1f%%%s%s\n", r->name, baseNs, r->nsPerCall, change,
+               slower ? "  REGRESSION" : (change < -threshold ? "  faster" : ""), allocates ? "  MORE ALLOCATIONS" : "");
+        regressions += slower || allocates;
+    }
+    printf("%d of %d cases matched the baseline, %d regressions (threshold %.1f%%)\n", matched, benchResultCount,
+           regressions, threshold);
+    free(text);
+    return regressions;
+}
+
+// --- Cases ---
+
+static const int benchSizes[] = {16, 64, 256, 1024};
+static const LunoColor benchColors[] = {{200, 60, 30, 255}, {200, 60, 30, 128}};
+static const char *alphaNames[] = {"translucent", "binary", "opaque"};
+
+static LunoImage *image;
+static LunoImage *sheet;
+static LunoRect rect;
+static LunoColor color;
+static int size;
+
+static const char *AlphaName(LunoColor c)
+{
+    return c.a == 255 ? "opaque" : "translucent";
+}
+
+// Fills an image with deterministic noise whose alpha values fall into the given class.
+static LunoImage *CreateNoiseImage(int width, int height, LunoAlphaClass alphaClass)
+{
+    LunoImage *noise = Luno_CreateImage(width, height);
+    unsigned int seed = 12345;
+    for (int i = 0; i < width * height; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        LunoColor c = {(seed >> 8) & 0xFF, (seed >> 16) & 0xFF, (seed >> 24) & 0xFF, (seed >> 4) & 0xFF};
+        if (alphaClass == LUNO_ALPHA_OPAQUE)
+            c.a = 255;
+        else if (alphaClass == LUNO_ALPHA_BINARY)
+            c.a = (c.a & 1) ? 255 : 0;
+        noise->pixels[i] = c;
+    }
+    Luno_UpdateImageAlpha(noise);
+    return noise;
+}
+
+static void FillImage(void)
+{
+    Luno_FillImage(image, color);
+}
+
+static void Clear(void)
+{
+    Luno_Clear();
+}
+
+static void BenchFill(void)
+{
+    char name[64];
+    for (size_t i = 0; i < sizeof(benchSizes) / sizeof(benchSizes[0]); i++)
+    {
+        size = benchSizes[i];
+        image = Luno_CreateImage(size, size);
+        color = benchColors[0];
+        snprintf(name, sizeof(name), "fill/%dx%d", size, size);
+        Run(name, FillImage, (double)size * size, 1);
+        Luno_DestroyImage(image);
+    }
+    Run("clear/1920x1080", Clear, 1920.0 * 1080, 1);
+}
+
+// A batch of small sprites created and freed together, from the heap and from an arena
+#define BENCH_SPRITES 1000
+static LunoImage *sprites[BENCH_SPRITES];
+static LunoImageArena *spriteArena;
+
+static void SpritesHeap(void)
+{
+    for (int i = 0; i < BENCH_SPRITES; i++)
+        sprites[i] = Luno_CreateImage(16, 16);
+    for (int i = 0; i < BENCH_SPRITES; i++)
+        Luno_DestroyImage(sprites[i]);
+}
+
+static void SpritesArena(void)
+{
+    Luno_SetImageArena(spriteArena);
+    for (int i = 0; i < BENCH_SPRITES; i++)
+        sprites[i] = Luno_CreateImage(16, 16);
+    Luno_SetImageArena(NULL);
+    Luno_ResetImageArena(spriteArena);
+}
+
+static void BenchImageAlloc(void)
+{
+    spriteArena = Luno_CreateImageArena(0);
+    Run("sprites/16x16/heap", SpritesHeap, 256.0 * BENCH_SPRITES, BENCH_SPRITES);
+    Run("sprites/16x16/arena", SpritesArena, 256.0 * BENCH_SPRITES, BENCH_SPRITES);
+    Luno_DestroyImageArena(spriteArena);
+}
+
+static void RectFilled(void)
+{
+    Luno_DrawRect(rect, color, true);
+}
+
+static void RectOutline(void)
+{
+    Luno_DrawRect(rect, color, false);
+}
+
+static void BenchRects(void)
+{
+    char name[64];
+    for (size_t c = 0; c < sizeof(benchColors) / sizeof(benchColors[0]); c++)
+    {
+        color = benchColors[c];
+        for (size_t i = 0; i < sizeof(benchSizes) / sizeof(benchSizes[0]); i++)
+        {
+            size = benchSizes[i];
+            rect = (LunoRect){100, 20, size, size};
+            int visible = size < 1060 ? size : 1060; // Clipped at the bottom edge
+            snprintf(name, sizeof(name), "rect/%d/%s", size, AlphaName(color));
+            Run(name, RectFilled, (double)size * visible, 1);
+            snprintf(name, sizeof(name), "rect_outline/%d/%s", size, AlphaName(color));
+            Run(name, RectOutline, 2.0 * size + 2.0 * visible, 1);
+        }
+    }
+}
+
+static void CircleFilled(void)
+{
+    Luno_DrawCircle(960, 540, size, color, true);
+}
+
+static void CircleOutline(void)
+{
+    Luno_DrawCircle(960, 540, size, color, false);
+}
+
+static void EllipseFilled(void)
+{
+    Luno_DrawEllipse(960, 540, size, size / 2, color, true);
+}
+
+static void BenchCircles(void)
+{
+    static const int radii[] = {8, 32, 128, 512};
+    char name[64];
+    for (size_t c = 0; c < sizeof(benchColors) / sizeof(benchColors[0]); c++)
+    {
+        color = benchColors[c];
+        for (size_t i = 0; i < sizeof(radii) / sizeof(radii[0]); i++)
+        {
+            size = radii[i];
+            double area = 3.14159265 * size * size;
+            snprintf(name, sizeof(name), "circle/r%d/%s", size, AlphaName(color));
+            Run(name, CircleFilled, area, 1);
+            snprintf(name, sizeof(name), "circle_outline/r%d/%s", size, AlphaName(color));
+            Run(name, CircleOutline, 2 * 3.14159265 * size, 1);
+            snprintf(name, sizeof(name), "ellipse/r%d/%s", size, AlphaName(color));
+            Run(name, EllipseFilled, area / 2, 1);
+        }
+    }
+}
+
+static void LineHorizontal(void)
+{
+    Luno_DrawLine(10, 500, 10 + size - 1, 500, color);
+}
+
+static void LineDiagonal(void)
+{
+    Luno_DrawLine(10, 10, 10 + size - 1, 10 + (size - 1) / 2, color);
+}
+
+static void BenchLines(void)
+{
+    static const int lengths[] = {16, 256, 1024};
+    char name[64];
+    for (size_t c = 0; c < sizeof(benchColors) / sizeof(benchColors[0]); c++)
+    {
+        color = benchColors[c];
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+        {
+            size = lengths[i];
+            snprintf(name, sizeof(name), "line_h/%d/%s", size, AlphaName(color));
+            Run(name, LineHorizontal, size, 1);
+            snprintf(name, sizeof(name), "line_diag/%d/%s", size, AlphaName(color));
+            Run(name, LineDiagonal, size, 1);
+        }
+    }
+}
+
+static void Blit(void)
+{
+    Luno_DrawImage(image, 100, 20);
+}
+
+static void BlitClipped(void)
+{
+    // Only a 16 pixel strip is visible
+    Luno_DrawImage(image, 1920 - 16, -image->height + 16);
+}
+
+static void BlitRect(void)
+{
+    Luno_DrawImageRect(sheet, 100, 20, (LunoRect){sheet->width / 4, 0, sheet->width / 2, sheet->height});
+}
+
+static void BenchImages(void)
+{
+    char name[64];
+    for (int alphaClass = LUNO_ALPHA_TRANSLUCENT; alphaClass <= LUNO_ALPHA_OPAQUE; alphaClass++)
+    {
+        for (size_t i = 0; i < sizeof(benchSizes) / sizeof(benchSizes[0]); i++)
+        {
+            size = benchSizes[i];
+            image = CreateNoiseImage(size, size, alphaClass);
+            sheet = CreateNoiseImage(size * 2, size, alphaClass);
+            int visible = size < 1060 ? size : 1060;
+
+            snprintf(name, sizeof(name), "blit/%d/%s", size, alphaNames[alphaClass]);
+            Run(name, Blit, (double)size * visible, 1);
+            snprintf(name, sizeof(name), "blit_clipped/%d/%s", size, alphaNames[alphaClass]);
+            Run(name, BlitClipped, 16.0 * (size < 16 ? size : 16), 1);
+            snprintf(name, sizeof(name), "image_rect/%d/%s", size, alphaNames[alphaClass]);
+            Run(name, BlitRect, (double)size * visible, 1);
+
+            Luno_DestroyImage(image);
+            Luno_DestroyImage(sheet);
+        }
+    }
+}
+
+// The baseline blend, before the SIMD kernels and LUNO_PREMULTIPLIED: dst + (src - dst) * a >> 8 per pixel, with
+// alpha 255 not quite replacing the destination.
+static inline LunoColor BaselineBlend(LunoColor dst, LunoColor src)
+{
+    return (LunoColor){dst.r + (((src.r - dst.r) * src.a) >> 8), dst.g + (((src.g - dst.g) * src.a) >> 8),
+                       dst.b + (((src.b - dst.b) * src.a) >> 8), dst.a};
+}
+
+// Premultiplied source-over in plain C: src + dst * (255 - a) / 255 on all four channels.
+static inline LunoColor PremultipliedBlend(LunoColor dst, LunoColor src)
+{
+    int inv = 255 - src.a;
+    return (LunoColor){src.r + _Luno_Div255(dst.r * inv), src.g + _Luno_Div255(dst.g * inv),
+                       src.b + _Luno_Div255(dst.b * inv), src.a + _Luno_Div255(dst.a * inv)};
+}
+
+// The blend is a constant at each call, so it is inlined into the loop.
+static inline void BlitScalar(LunoColor (*blend)(LunoColor dst, LunoColor src))
+{
+    LunoImage *bb = &_lunoContext.backbuffer;
+    for (int j = 0; j < image->height; j++)
+    {
+        LunoColor *dst = &bb->pixels[100 + (20 + j) * bb->width];
+        const LunoColor *src = &image->pixels[j * image->width];
+        for (int i = 0; i < image->width; i++)
+            dst[i] = blend(dst[i], src[i]);
+    }
+}
+
+static inline void SpanScalar(LunoColor (*blend)(LunoColor dst, LunoColor src))
+{
+    LunoImage *bb = &_lunoContext.backbuffer;
+    LunoColor pixel = _Luno_ToPixel(color);
+    for (int y = rect.y; y < rect.y + rect.h; y++)
+    {
+        LunoColor *dst = &bb->pixels[rect.x + y * bb->width];
+        for (int i = 0; i < rect.w; i++)
+            dst[i] = blend(dst[i], pixel);
+    }
+}
+
+static void BlitBaseline(void)
+{
+    BlitScalar(BaselineBlend);
+}
+
+static void BlitPremultiplied(void)
+{
+    BlitScalar(PremultipliedBlend);
+}
+
+static void SpanBaseline(void)
+{
+    SpanScalar(BaselineBlend);
+}
+
+static void SpanPremultiplied(void)
+{
+    SpanScalar(PremultipliedBlend);
+}
+
+// Luno's blend in the mode the suite is built with, against the baseline straight blend and a plain C premultiplied
+// blend. Build once more with -DLUNO_PREMULTIPLIED to time Luno's own premultiplied kernels.
+static void BenchBlend(void)
+{
+    static const int blendSizes[] = {64, 256, 1024};
+    char name[64];
+    color = benchColors[1];
+    for (size_t i = 0; i < sizeof(blendSizes) / sizeof(blendSizes[0]); i++)
+    {
+        size = blendSizes[i];
+        double pixels = (double)size * size;
+        image = CreateNoiseImage(size, size, LUNO_ALPHA_TRANSLUCENT);
+        rect = (LunoRect){100, 20, size, size};
+
+        snprintf(name, sizeof(name), "blend_blit/%d/luno", size);
+        Run(name, Blit, pixels, 1);
+        snprintf(name, sizeof(name), "blend_blit/%d/baseline", size);
+        Run(name, BlitBaseline, pixels, 1);
+        snprintf(name, sizeof(name), "blend_blit/%d/plain_premultiplied", size);
+        Run(name, BlitPremultiplied, pixels, 1);
+        snprintf(name, sizeof(name), "blend_span/%d/luno", size);
+        Run(name, RectFilled, pixels, 1);
+        snprintf(name, sizeof(name), "blend_span/%d/baseline", size);
+        Run(name, SpanBaseline, pixels, 1);
+        snprintf(name, sizeof(name), "blend_span/%d/plain_premultiplied", size);
+        Run(name, SpanPremultiplied, pixels, 1);
+
+        Luno_DestroyImage(image);
+    }
+}
+
+static const char *benchText = "The quick brown fox jumps over the lazy dog 0123456789 !?";
+
+static void Text(void)
+{
+    Luno_DrawText(benchText, 10, 500, color);
+}
+
+static void BenchText(void)
+{
+    char name[64];
+    Luno_ResetFont();
+    double glyphArea = (double)strlen(benchText) * 16 * 16;
+    for (size_t c = 0; c < sizeof(benchColors) / sizeof(benchColors[0]); c++)
+    {
+        color = benchColors[c];
+        snprintf(name, sizeof(name), "text/%dchars/%s", (int)strlen(benchText), AlphaName(color));
+        Run(name, Text, glyphArea, 1);
+    }
+}
+
+// The encoded file the loader cases decode
+static unsigned char *encoded;
+static int encodedSize;
+
+// Encodes `pixels` (BGRA) as a true-color TGA, raw or run-length encoded.
+static unsigned char *EncodeTga(const unsigned char *pixels, int width, int height, int bytesPerPixel, bool rle,
+                                int *fileSize)
+{
+    unsigned char *data = (unsigned char *)malloc(18 + (size_t)width * height * (bytesPerPixel + 1));
+    memset(data, 0, 18);
+    data[2] = rle ? 10 : 2;
+    data[12] = width & 0xFF;
+    data[13] = width >> 8;
+    data[14] = height & 0xFF;
+    data[15] = height >> 8;
+    data[16] = bytesPerPixel * 8;
+
+    unsigned char *out = data + 18;
+    int count = width * height;
+    for (int i = 0; i < count;)
+    {
+        if (!rle)
+        {
+            memcpy(out, &pixels[i * 4], bytesPerPixel);
+            out += bytesPerPixel;
+            i++;
+            continue;
+        }
+
+        // Run packet for repeated pixels, raw packet up to the next repeat
+        int run = 1;
+        while (i + run < count && run < 128 && !memcmp(&pixels[i * 4], &pixels[(i + run) * 4], bytesPerPixel))
+            run++;
+        if (run > 1)
+        {
+            *out++ = 0x80 | (run - 1);
+            memcpy(out, &pixels[i * 4], bytesPerPixel);
+            out += bytesPerPixel;
+            i += run;
+            continue;
+        }
+        int raw = 1;
+        while (i + raw < count && raw < 128 &&
+               (i + raw + 1 >= count || memcmp(&pixels[(i + raw) * 4], &pixels[(i + raw + 1) * 4], bytesPerPixel)))
+            raw++;
+        *out++ = raw - 1;
+        for (int j = 0; j < raw; j++, out += bytesPerPixel)
+            memcpy(out, &pixels[(i + j) * 4], bytesPerPixel);
+        i += raw;
+    }
+    *fileSize = (int)(out - data);
+    return data;
+}
+
+// Encodes `pixels` (BGRA) as QOI through Luno's own encoder. The buffer is freed with LUNO_FREE.
+static unsigned char *EncodeQoi(const unsigned char *pixels, int width, int height, int *fileSize)
+{
+    LunoImage *source = Luno_CreateImage(width, height);
+    for (int i = 0; i < width * height; i++)
+    {
+        const unsigned char *p = &pixels[i * 4];
+        source->pixels[i] = _Luno_ToPixel((LunoColor){p[2], p[1], p[0], p[3]});
+    }
+    Luno_UpdateImageAlpha(source);
+    size_t dataSize;
+    unsigned char *data = _Luno_EncodeQoi(source, &dataSize);
+    Luno_DestroyImage(source);
+    *fileSize = (int)dataSize;
+    return data;
+}
+
+static void LoadEncoded(void)
+{
+    LunoImage *loaded = Luno_LoadImageMem(encoded, encodedSize);
+    Luno_DestroyImage(loaded);
+}
+
+// Loading from disk reads the whole file, so bytes_per_call is the peak memory of a load: file plus image
+static const char *encodedFile = "benchsuite.img";
+
+static void LoadEncodedFile(void)
+{
+    LunoImage *loaded = Luno_LoadImage(encodedFile);
+    Luno_DestroyImage(loaded);
+}
+
+// Measures loading `encoded` from memory as `name` and, when `fileName` is given, from disk as `fileName`
+static void RunLoad(const char *name, const char *fileName, double pixels)
+{
+    Run(name, LoadEncoded, pixels, 1);
+    if (!fileName)
+        return;
+
+    FILE *file = fopen(encodedFile, "wb");
+    if (file)
+    {
+        fwrite(encoded, 1, encodedSize, file);
+        fclose(file);
+        Run(fileName, LoadEncodedFile, pixels, 1);
+        remove(encodedFile);
+    }
+}
+
+static void BenchTga(void)
+{
+    static const int tgaSizes[] = {64, 256, 1024};
+    char name[64];
+    for (size_t i = 0; i < sizeof(tgaSizes) / sizeof(tgaSizes[0]); i++)
+    {
+        // Flat-color art: runs of 1 to 16 equal pixels, as in typical sprite sheets
+        size = tgaSizes[i];
+        unsigned char *pixels = (unsigned char *)malloc((size_t)size * size * 4);
+        unsigned int seed = 4321;
+        for (int p = 0; p < size * size;)
+        {
+            seed = seed * 1103515245 + 12345;
+            int run = 1 + ((seed >> 24) & 15);
+            for (int j = 0; j < run && p < size * size; j++, p++)
+            {
+                pixels[p * 4 + 0] = (seed >> 8) & 0xFF;
+                pixels[p * 4 + 1] = (seed >> 14) & 0xFF;
+                pixels[p * 4 + 2] = (seed >> 18) & 0xFF;
+                pixels[p * 4 + 3] = (seed & 0x100) ? 255 : 0;
+            }
+        }
+
+        char fileName[64];
+        for (int bits = 24; bits <= 32; bits += 8)
+        {
+            for (int rle = 0; rle <= 1; rle++)
+            {
+                encoded = EncodeTga(pixels, size, size, bits / 8, rle, &encodedSize);
+                snprintf(name, sizeof(name), "tga_%s/%d/%dbit", rle ? "rle" : "raw", size, bits);
+                snprintf(fileName, sizeof(fileName), "tga_file_%s/%d/%dbit", rle ? "rle" : "raw", size, bits);
+                RunLoad(name, fileName, (double)size * size);
+                free(encoded);
+            }
+        }
+
+        encoded = EncodeQoi(pixels, size, size, &encodedSize);
+        snprintf(name, sizeof(name), "qoi/%d", size);
+        snprintf(fileName, sizeof(fileName), "qoi_file/%d", size);
+        RunLoad(name, fileName, (double)size * size);
+        LUNO_FREE(encoded);
+        free(pixels);
+    }
+}
+
+// Every TGA and QOI image in the asset directory, decoded as raw TGA, RLE TGA and QOI
+static const char *assetPath = "assets";
+
+static bool IsImageFile(const char *name)
+{
+    size_t length = strlen(name);
+    if (length < 4)
+        return false;
+    const char *extension = name + length - 4;
+    return !strcmp(extension, ".tga") || !strcmp(extension, ".qoi");
+}
+
+static void BenchAsset(const char *path, const char *fileName)
+{
+    // Luno_LoadImage exits on failure, skip files that cannot be read
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return;
+    fclose(file);
+
+    LunoImage *source = Luno_LoadImage(path);
+    int width = source->width, height = source->height;
+    bool opaque = source->alphaClass == LUNO_ALPHA_OPAQUE;
+    unsigned char *pixels = (unsigned char *)malloc((size_t)width * height * 4);
+    for (int i = 0; i < width * height; i++)
+    {
+        LunoColor c = _Luno_FromPixel(source->pixels[i]);
+        unsigned char *p = &pixels[i * 4];
+        p[0] = c.b;
+        p[1] = c.g;
+        p[2] = c.r;
+        p[3] = c.a;
+    }
+    Luno_DestroyImage(source);
+
+    // Opaque images are stored as 24-bit TGA, as an exporter would write them
+    static const char *formats[] = {"tga_raw", "tga_rle", "qoi"};
+    int sizes[3];
+    int ran = benchResultCount;
+    char name[128];
+    for (int f = 0; f < 3; f++)
+    {
+        if (f < 2)
+            encoded = EncodeTga(pixels, width, height, opaque ? 3 : 4, f == 1, &encodedSize);
+        else
+            encoded = EncodeQoi(pixels, width, height, &encodedSize);
+        sizes[f] = encodedSize;
+        snprintf(name, sizeof(name), "codec/%s/%s", fileName, formats[f]);
+        RunLoad(name, NULL, (double)width * height);
+        if (f < 2)
+            free(encoded);
+        else
+            LUNO_FREE(encoded);
+    }
+
+    // File sizes of the images whose cases ran, ahead of the report
+    static bool sizeHeader;
+    if (benchResultCount > ran)
+    {
+        if (!sizeHeader)
+            fprintf(stderr, "%-36s %10s %10s %10s\n", "bytes", "tga_raw", "tga_rle", "qoi");
+        sizeHeader = true;
+        fprintf(stderr, "%-24s %5dx%-5d %10d %10d %10d\n", fileName, width, height, sizes[0], sizes[1], sizes[2]);
+    }
+    free(pixels);
+}
+
+static void BenchCodecs(void)
+{
+    char path[4096];
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    snprintf(path, sizeof(path), "%s/*", assetPath);
+    HANDLE search = FindFirstFileA(path, &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        if (!(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && IsImageFile(found.cFileName))
+        {
+            snprintf(path, sizeof(path), "%s/%s", assetPath, found.cFileName);
+            BenchAsset(path, found.cFileName);
+        }
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+#else
+    DIR *directory = opendir(assetPath);
+    if (!directory)
+        return;
+    struct dirent *found;
+    while ((found = readdir(directory)))
+    {
+        if (IsImageFile(found->d_name))
+        {
+            snprintf(path, sizeof(path), "%s/%s", assetPath, found->d_name);
+            BenchAsset(path, found->d_name);
+        }
+    }
+    closedir(directory);
+#endif
+}
+
+// Inputs for the collision predicates, so every call sees different values
+#define BENCH_SHAPES 1024
+static LunoRect shapeRects[BENCH_SHAPES];
+static int shapeX[BENCH_SHAPES], shapeY[BENCH_SHAPES];
+static float shapeRadius[BENCH_SHAPES];
+static volatile int collisionHits;
+
+static void PointRec(void)
+{
+    int hits = 0;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+        hits += Luno_PointRecOverlaps(shapeX[i], shapeY[i], shapeRects[(i + 1) & (BENCH_SHAPES - 1)]);
+    collisionHits = hits;
+}
+
+static void RecsOverlap(void)
+{
+    int hits = 0;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+        hits += Luno_RecsOverlap(shapeRects[i], shapeRects[(i + 1) & (BENCH_SHAPES - 1)]);
+    collisionHits = hits;
+}
+
+static void PointCircle(void)
+{
+    int hits = 0;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+    {
+        int j = (i + 1) & (BENCH_SHAPES - 1);
+        hits += Luno_PointCircleOverlaps(shapeX[i], shapeY[i], shapeX[j], shapeY[j], shapeRadius[j]);
+    }
+    collisionHits = hits;
+}
+
+static void RecCircle(void)
+{
+    int hits = 0;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+    {
+        int j = (i + 1) & (BENCH_SHAPES - 1);
+        hits += Luno_RecCircleOverlaps(shapeRects[i], shapeX[j], shapeY[j], shapeRadius[j]);
+    }
+    collisionHits = hits;
+}
+
+static void Circles(void)
+{
+    int hits = 0;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+    {
+        int j = (i + 1) & (BENCH_SHAPES - 1);
+        hits += Luno_CirclesOverlaps(shapeX[i], shapeY[i], shapeRadius[i], shapeX[j], shapeY[j], shapeRadius[j]);
+    }
+    collisionHits = hits;
+}
+
+static void BenchCollision(void)
+{
+    unsigned int seed = 999;
+    for (int i = 0; i < BENCH_SHAPES; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        shapeX[i] = (seed >> 8) % 1000;
+        shapeY[i] = (seed >> 16) % 1000;
+        shapeRects[i] = (LunoRect){(seed >> 4) % 1000, (seed >> 12) % 1000, 10 + (seed >> 20) % 200, 10 + (seed >> 24) % 200};
+        shapeRadius[i] = 5.0f + (seed >> 22) % 100;
+    }
+
+    Run("collision/point_rec", PointRec, 0, BENCH_SHAPES);
+    Run("collision/recs", RecsOverlap, 0, BENCH_SHAPES);
+    Run("collision/point_circle", PointCircle, 0, BENCH_SHAPES);
+    Run("collision/rec_circle", RecCircle, 0, BENCH_SHAPES);
+    Run("collision/circles", Circles, 0, BENCH_SHAPES);
+}
+
+// Many timers with intervals of 0.1 to 5 seconds, checked once per 60 Hz frame
+#define BENCH_TIMERS 10000
+static LunoTimer pollTimers[BENCH_TIMERS];
+static double timerClock;
+static volatile int timerTicks;
+
+static double TimerClock(void)
+{
+    return timerClock;
+}
+
+static void PollTimers(void)
+{
+    timerClock += 1.0 / 60;
+    int ticks = 0;
+    for (int i = 0; i < BENCH_TIMERS; i++)
+        ticks += Luno_TimerTicked(&pollTimers[i]);
+    timerTicks = ticks;
+}
+
+static void WheelTimers(void)
+{
+    timerClock += 1.0 / 60;
+    Luno_Update();
+    timerTicks = Luno_GetExpiredTimers(NULL, 0);
+}
+
+static void BenchTimers(void)
+{
+    Luno_SetTimeSource(TimerClock);
+    unsigned int seed = 4242;
+    int handles[BENCH_TIMERS];
+    for (int i = 0; i < BENCH_TIMERS; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int interval = 100 + (seed >> 8) % 4900;
+        pollTimers[i] = Luno_CreateTimer(interval);
+        handles[i] = Luno_StartTimer(interval, interval, NULL, NULL);
+    }
+
+    Run("timers/poll", PollTimers, 0, BENCH_TIMERS);
+    Run("timers/wheel", WheelTimers, 0, BENCH_TIMERS);
+
+    for (int i = 0; i < BENCH_TIMERS; i++)
+        Luno_CancelTimer(handles[i]);
+    Luno_SetTimeSource(NULL);
+}
+
+static LunoImage *sceneSprites[3];
+
+// A busy frame: full clear, translucent panels, circles, sprites of every alpha class and text.
+static void DrawScene(void)
+{
+    unsigned int seed = 777;
+    Luno_Clear();
+    for (int i = 0; i < 600; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int x = (seed >> 8) % 1920;
+        int y = (seed >> 4) % 1080;
+        LunoColor c = {(seed >> 16) & 0xFF, (seed >> 20) & 0xFF, (seed >> 24) & 0xFF, (i & 1) ? 255 : 140};
+        switch (i % 5)
+        {
+        case 0:
+            Luno_DrawRect((LunoRect){x - 100, y - 60, 200, 120}, c, true);
+            break;
+        case 1:
+            Luno_DrawCircle(x, y, 60, c, true);
+            break;
+        case 2:
+        case 3:
+            Luno_DrawImage(sceneSprites[i % 3], x - 32, y - 32);
+            break;
+        default:
+            Luno_DrawText("The quick brown fox jumps over the lazy dog", x - 200, y, c);
+            break;
+        }
+    }
+    Luno_GetBackbuffer(); // Flushes recorded draws
+}
+
+// Stands in for a frame capture: reads every pixel of the presented frame, like an encoder would.
+static volatile unsigned int frameChecksum;
+
+static void CaptureFrame(const LunoImage *frame, void *user)
+{
+    (void)user;
+    const unsigned char *bytes = (const unsigned char *)frame->pixels;
+    unsigned int sum = 0;
+    for (int i = 0; i < frame->width * frame->height * 4; i++)
+        sum = sum * 31 + bytes[i];
+    frameChecksum += sum;
+}
+
+static void PresentScene(void)
+{
+    DrawScene();
+    Luno_Update();
+}
+
+// The busy frame drawn immediately and tiled on 1, 2, 4, ... and finally every core, then presented to a capture
+// callback with one to three frame buffers
+static void BenchScene(void)
+{
+    char name[64];
+    for (int i = 0; i < 3; i++)
+        sceneSprites[i] = CreateNoiseImage(64, 64, (LunoAlphaClass)i);
+
+    Run("scene/immediate", DrawScene, 0, 1);
+    int cores = Luno_GetThreadCount();
+    Luno_SetTiledRendering(true);
+    for (int threads = 1;; threads *= 2)
+    {
+        threads = threads < cores ? threads : cores;
+        Luno_SetThreadCount(threads);
+        snprintf(name, sizeof(name), "scene/tiled/%dthreads", threads);
+        Run(name, DrawScene, 0, 1);
+        if (threads == cores)
+            break;
+    }
+    Luno_SetTiledRendering(false);
+    Luno_SetThreadCount(0);
+
+    Luno_SetPresentCallback(CaptureFrame, NULL);
+    for (int buffers = 1; buffers <= 3; buffers++)
+    {
+        Luno_SetFrameBuffering(buffers);
+        snprintf(name, sizeof(name), "present/capture/%dbuffers", buffers);
+        Run(name, PresentScene, 0, 1);
+    }
+    Luno_SetFrameBuffering(1);
+    Luno_SetPresentCallback(NULL, NULL);
+
+    for (int i = 0; i < 3; i++)
+        Luno_DestroyImage(sceneSprites[i]);
+}
+
+static LunoImage *levelAtlas;
+static LunoCommandBuffer *levelCommands;
+
+// A static level: a tile map cut from an atlas, small props and labels
+static void DrawLevel(void)
+{
+    Luno_Clear();
+    for (int y = 0; y < 1080; y += 16)
+        for (int x = 0; x < 1920; x += 16)
+            Luno_DrawImageRect(levelAtlas, x, y, (LunoRect){x % 256, y % 256, 16, 16});
+    for (int i = 0; i < 2000; i++)
+        Luno_DrawRect((LunoRect){(i * 97) % 1920, (i * 57) % 1080, 4, 4}, LUNO_YELLOW, true);
+    for (int i = 0; i < 100; i++)
+        Luno_DrawText("Label", (i * 193) % 1900, (i * 71) % 1070, LUNO_WHITE);
+}
+
+static void SubmitLevel(void)
+{
+    Luno_SubmitCommandBuffer(levelCommands);
+}
+
+static void BenchCommands(void)
+{
+    levelAtlas = CreateNoiseImage(256, 256, LUNO_ALPHA_OPAQUE);
+    levelCommands = Luno_CreateCommandBuffer();
+    Luno_BeginCommandBuffer(levelCommands);
+    DrawLevel();
+    Luno_EndCommandBuffer();
+
+    Run("level/immediate", DrawLevel, 0, 1);
+    Run("level/command_buffer", SubmitLevel, 0, 1);
+
+    Luno_DestroyCommandBuffer(levelCommands);
+    Luno_DestroyImage(levelAtlas);
+}
+
+// The buffers of the conversion and 4K thread cases
+static LunoPixelFormat convertFrom, convertTo;
+static unsigned char *convertSource;
+static unsigned char *convertTarget;
+static int convertCount;
+
+static void Convert(void)
+{
+    Luno_ConvertPixels(convertTarget, convertTo, convertSource, convertFrom, convertCount);
+}
+
+static void BenchConvert(void)
+{
+    static const struct
+    {
+        LunoPixelFormat from, to;
+        const char *name;
+    } conversions[] = {
+        {LUNO_FORMAT_RGBA32, LUNO_FORMAT_BGRA32, "rgba32_bgra32"},
+        {LUNO_FORMAT_BGR24, LUNO_FORMAT_BGRA32, "bgr24_bgra32"},
+        {LUNO_FORMAT_RGB24, LUNO_FORMAT_BGRA32, "rgb24_bgra32"},
+        {LUNO_FORMAT_BGRA32, LUNO_FORMAT_RGB24, "bgra32_rgb24"},
+    };
+    char name[64];
+    convertCount = 1920 * 1080;
+    convertSource = (unsigned char *)calloc(convertCount, 4);
+    convertTarget = (unsigned char *)calloc(convertCount, 4);
+    for (size_t i = 0; i < sizeof(conversions) / sizeof(conversions[0]); i++)
+    {
+        convertFrom = conversions[i].from;
+        convertTo = conversions[i].to;
+        snprintf(name, sizeof(name), "convert/%s/1920x1080", conversions[i].name);
+        Run(name, Convert, convertCount, 1);
+    }
+    free(convertSource);
+    free(convertTarget);
+}
+
+static void FillTarget(void)
+{
+    Luno_FillImage(image, LUNO_DARKGRAY);
+}
+
+// Bulk pixel operations on 4K buffers, which are split into row bands across the thread pool. Recreates the window
+// at 3840x2160 for the clear and restores 1920x1080 afterwards.
+static void BenchThreads(void)
+{
+    int width = 3840, height = 2160;
+    Luno_Close();
+    if (!Luno_Create("benchsuite", width, height, 0))
+        exit(1);
+
+    image = Luno_CreateImage(width, height);
+    convertCount = width * height;
+    convertSource = (unsigned char *)calloc(convertCount, 3);
+    convertTarget = (unsigned char *)image->pixels;
+    convertFrom = LUNO_FORMAT_RGB24;
+    convertTo = LUNO_FORMAT_NATIVE;
+
+    // Uncompressed 32 bit TGA
+    encodedSize = 18 + width * height * 4;
+    encoded = (unsigned char *)calloc(encodedSize, 1);
+    encoded[2] = 2;
+    encoded[12] = width & 0xFF;
+    encoded[13] = width >> 8;
+    encoded[14] = height & 0xFF;
+    encoded[15] = height >> 8;
+    encoded[16] = 32;
+
+    static const struct
+    {
+        void (*fn)(void);
+        const char *name;
+    } ops[] = {
+        {FillTarget, "fill"},
+        {Convert, "convert_rgb24"},
+        {Clear, "clear"},
+        {LoadEncoded, "tga_raw"},
+    };
+
+    char name[64];
+    int cores = Luno_GetThreadCount();
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+    {
+        for (int threads = 1;; threads *= 2)
+        {
+            threads = threads < cores ? threads : cores;
+            Luno_SetThreadCount(threads);
+            snprintf(name, sizeof(name), "threads/%s/%dx%d/%dthreads", ops[i].name, width, height, threads);
+            Run(name, ops[i].fn, (double)width * height, 1);
+            if (threads == cores)
+                break;
+        }
+    }
+    Luno_SetThreadCount(0);
+
+    free(encoded);
+    free(convertSource);
+    Luno_DestroyImage(image);
+    Luno_Close();
+    if (!Luno_Create("benchsuite", 1920, 1080, 0))
+        exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *outPath = NULL;
+    const char *comparePath = NULL;
+    double threshold = 10;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--out") && hasValue)
+            outPath = argv[++i];
+        else if (!strcmp(argv[i], "--compare") && hasValue)
+            comparePath = argv[++i];
+        else if (!strcmp(argv[i], "--threshold") && hasValue)
+            threshold = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--filter") && hasValue)
+            benchFilter = argv[++i];
+        else if (!strcmp(argv[i], "--time") && hasValue)
+            benchTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--assets") && hasValue)
+            assetPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--out FILE] [--compare FILE] [--threshold PCT] [--filter TEXT] [--time SECONDS] "
+                            "[--assets DIR]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if (!Luno_Create("benchsuite", 1920, 1080, 0))
+        return 1;
+
+    BenchFill();
+    BenchImageAlloc();
+    BenchRects();
+    BenchCircles();
+    BenchLines();
+    BenchImages();
+    BenchBlend();
+    BenchText();
+    BenchTga();
+    BenchCodecs();
+    BenchCollision();
+    BenchTimers();
+    BenchScene();
+    BenchCommands();
+    BenchConvert();
+    BenchThreads();
+
+    Luno_Close();
+
+    if (outPath)
+    {
+        FILE *file = fopen(outPath, "w");
+        if (!file)
+        {
+            fprintf(stderr, "Unable to write %s\n", outPath);
+            return 1;
+        }
+        WriteReport(file);
+        fclose(file);
+    }
+    else if (!comparePath)
+    {
+        WriteReport(stdout);
+    }
+
+    if (comparePath)
+        return Compare(comparePath, threshold) > 0 ? 1 : 0;
+    return 0;
+}
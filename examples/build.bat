@@ -1,2 +1,5 @@
 @echo off
-gcc -o demo.exe image.c -lgdi32 -luser32 -lwinmm -O3 -Wall -s -fno-strict-aliasing -fomit-frame-pointer
\ No newline at end of file
+gcc -o demo.exe image.c -lgdi32 -luser32 -lwinmm -O3 -Wall -s -fno-strict-aliasing -fomit-frame-pointer
+gcc -o check.exe check.c -DLUNO_HEADLESS -O2 -Wall -s -fno-strict-aliasing
+gcc -o benchsuite.exe benchsuite.c -DLUNO_HEADLESS -O3 -Wall -s -fno-strict-aliasing -fomit-frame-pointer
+gcc -o lunopak.exe lunopak.c -DLUNO_HEADLESS -O2 -Wall -s -fno-strict-aliasing
\ No newline at end of file
@@ -0,0 +1,475 @@
+// Headless correctness checks for the Luno rasterizer. Prints every failed check and exits with 1 if any failed.
+// Build: gcc -O2 -DLUNO_HEADLESS -o check check.c -lm -pthread
+//        (also run it built with -DLUNO_PREMULTIPLIED and with -DLUNO_NO_SIMD)
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LUNO_IMPL
+#include "../luno.h"
+
+#define CHECK_WIDTH 320
+#define CHECK_HEIGHT 240
+
+static LunoColor frame[CHECK_WIDTH * CHECK_HEIGHT];
+static int checks;
+static int failures;
+
+// Records the outcome of one check and prints it if it failed.
+static void Expect(bool passed, const char *format, ...)
+{
+    checks++;
+    if (passed)
+        return;
+
+    failures++;
+    va_list args;
+    va_start(args, format);
+    printf("FAILED: ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+static bool SameColor(LunoColor a, LunoColor b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+// The color a single draw of `color` leaves over the clear color, as Luno blends it.
+static LunoColor BlendOnce(LunoColor color)
+{
+    Luno_Clear();
+    Luno_DrawPixel(0, 0, color);
+    Luno_ReadFrame(frame);
+    return frame[0];
+}
+
+// --- Circle and ellipse coverage ---
+// A translucent fill over an opaque background shows every pixel the fill touched more than once, because the
+// second blend darkens it further. Every pixel must hold either the background or the single-blend color, and the
+// covered pixels of each row must be one span without holes.
+
+static const LunoColor background = {40, 80, 160, 255};
+static const LunoColor halfColor = {220, 30, 90, 128};
+
+// Returns the number of covered pixels.
+static int CheckFill(bool circle, int x, int y, int radiusX, int radiusY, LunoColor once)
+{
+    const char *shape = circle ? "circle" : "ellipse";
+    Luno_Clear();
+    if (circle)
+        Luno_DrawCircle(x, y, radiusX, halfColor, true);
+    else
+        Luno_DrawEllipse(x, y, radiusX, radiusY, halfColor, true);
+    Luno_ReadFrame(frame);
+
+    int covered = 0, wrong = 0, broken = 0;
+    for (int row = 0; row < CHECK_HEIGHT; row++)
+    {
+        int spans = 0;
+        bool inside = false;
+        for (int column = 0; column < CHECK_WIDTH; column++)
+        {
+            LunoColor pixel = frame[row * CHECK_WIDTH + column];
+            bool hit = !SameColor(pixel, background);
+            if (hit)
+            {
+                covered++;
+                wrong += !SameColor(pixel, once);
+            }
+            spans += hit && !inside;
+            inside = hit;
+        }
+        broken += spans > 1;
+    }
+
+    bool visible = x + radiusX >= 0 && x - radiusX < CHECK_WIDTH && y + radiusY >= 0 && y - radiusY < CHECK_HEIGHT;
+    Expect(wrong == 0, "%s at %d,%d radius %d,%d: %d of %d covered pixels not blended exactly once", shape, x, y,
+           radiusX, radiusY, wrong, covered);
+    Expect(broken == 0, "%s at %d,%d radius %d,%d: %d rows with holes", shape, x, y, radiusX, radiusY, broken);
+    Expect(covered > 0 || !visible, "%s at %d,%d radius %d,%d: nothing drawn", shape, x, y, radiusX, radiusY);
+    return covered;
+}
+
+static void CheckCircleCoverage(void)
+{
+    if (!Luno_Create("check", CHECK_WIDTH, CHECK_HEIGHT, 0))
+        return;
+
+    Luno_SetClearColor(background);
+    LunoColor once = BlendOnce(halfColor);
+
+    // Centered, near every edge and partly outside the frame
+    static const int centers[][2] = {{160, 120}, {3, 5}, {316, 236}, {-20, 100}, {170, 250}};
+    for (size_t c = 0; c < sizeof(centers) / sizeof(centers[0]); c++)
+    {
+        int x = centers[c][0], y = centers[c][1];
+        for (int radius = 0; radius <= 150; radius += (radius < 24) ? 1 : 7)
+            CheckFill(true, x, y, radius, radius, once);
+        for (int radiusX = 0; radiusX <= 150; radiusX += (radiusX < 8) ? 1 : 13)
+        {
+            for (int radiusY = 0; radiusY <= 110; radiusY += (radiusY < 8) ? 1 : 17)
+                CheckFill(false, x, y, radiusX, radiusY, once);
+        }
+    }
+
+    // Radii far larger than the frame, whose squared terms do not fit in 64 bits, cover all of it
+    static const int huge[][2] = {{27000, 27000}, {40000, 20000}, {1000000, 300000}, {300000000, 1000000000}};
+    for (size_t h = 0; h < sizeof(huge) / sizeof(huge[0]); h++)
+    {
+        int covered = CheckFill(false, 160, 120, huge[h][0], huge[h][1], once);
+        Expect(covered == CHECK_WIDTH * CHECK_HEIGHT, "ellipse radius %d,%d covers %d pixels of the frame", huge[h][0],
+               huge[h][1], covered);
+    }
+    int covered = CheckFill(true, 160, 120, 40000, 40000, once);
+    Expect(covered == CHECK_WIDTH * CHECK_HEIGHT, "circle radius 40000 covers %d pixels of the frame", covered);
+    Luno_Close();
+}
+
+// --- Opaque overwrite ---
+// Alpha 255 must replace what is below exactly, in both blend modes: the colors of every primitive and the opaque
+// pixels of images of every alpha class. The destination is noise drawn from opaque and translucent images.
+
+static LunoColor destination[CHECK_WIDTH * CHECK_HEIGHT];
+static LunoImage *destinationImages[2];
+static unsigned int noiseSeed = 2024;
+
+static LunoColor NoiseColor(void)
+{
+    noiseSeed = noiseSeed * 1103515245 + 12345;
+    return (LunoColor){(noiseSeed >> 8) & 0xFF, (noiseSeed >> 16) & 0xFF, (noiseSeed >> 24) & 0xFF, noiseSeed & 0xFF};
+}
+
+// Creates an image of noise, with alpha 255 where `alphas` is 0 and alphas[i % count] otherwise. `colors` receives
+// the RGBA colors as given.
+static LunoImage *CreateNoiseImage(int width, int height, const int *alphas, int count, LunoColor *colors)
+{
+    for (int i = 0; i < width * height; i++)
+    {
+        colors[i] = NoiseColor();
+        colors[i].a = count ? (unsigned char)alphas[i % count] : 255;
+    }
+    LunoImage *image = Luno_CreateImage(width, height);
+    Luno_ConvertPixels(image->pixels, LUNO_FORMAT_NATIVE, colors, LUNO_FORMAT_RGBA32, width * height);
+    Luno_UpdateImageAlpha(image);
+    return image;
+}
+
+static void DrawDestination(void)
+{
+    Luno_Clear();
+    Luno_DrawImage(destinationImages[0], 0, 0);
+    Luno_DrawImage(destinationImages[1], 0, 0);
+    Luno_ReadFrame(destination);
+}
+
+// Every pixel must be left alone or hold exactly `color`, and some pixel must hold it.
+static void CheckPrimitive(const char *name, LunoColor color)
+{
+    Luno_ReadFrame(frame);
+    int changed = 0, wrong = 0;
+    for (int i = 0; i < CHECK_WIDTH * CHECK_HEIGHT; i++)
+    {
+        if (SameColor(frame[i], destination[i]))
+            continue;
+        changed++;
+        wrong += !SameColor(frame[i], color);
+    }
+    Expect(changed > 0, "%s with alpha 255 drew nothing", name);
+    Expect(wrong == 0, "%s with alpha 255: %d of %d pixels blended instead of overwritten", name, wrong, changed);
+}
+
+// Draws `source` (whose RGBA colors are `colors`) with its top-left corner at x, y and checks every pixel
+// it covers with alpha 255.
+static void CheckImage(const char *name, LunoImage *image, const LunoColor *colors, int x, int y, LunoRect srcRect)
+{
+    DrawDestination();
+    Luno_DrawImageRect(image, x, y, srcRect);
+    Luno_ReadFrame(frame);
+
+    int opaque = 0, wrong = 0;
+    for (int row = 0; row < srcRect.h; row++)
+    {
+        for (int column = 0; column < srcRect.w; column++)
+        {
+            LunoColor color = colors[srcRect.x + column + (srcRect.y + row) * image->width];
+            int dx = x + column, dy = y + row;
+            if (color.a != 255 || dx < 0 || dy < 0 || dx >= CHECK_WIDTH || dy >= CHECK_HEIGHT)
+                continue;
+            opaque++;
+            wrong += !SameColor(frame[dx + dy * CHECK_WIDTH], color);
+        }
+    }
+    Expect(opaque > 0, "%s drew no opaque pixels", name);
+    Expect(wrong == 0, "%s at %d,%d: %d of %d opaque pixels blended instead of overwritten", name, x, y, wrong, opaque);
+}
+
+static void CheckOpaqueOverwrite(void)
+{
+    static LunoColor destinationColors[CHECK_WIDTH * CHECK_HEIGHT];
+    static const int translucent[] = {0, 37, 128, 200, 254};
+    if (!Luno_Create("check", CHECK_WIDTH, CHECK_HEIGHT, 0))
+        return;
+
+    Luno_SetClearColor(background);
+    destinationImages[0] = CreateNoiseImage(CHECK_WIDTH, CHECK_HEIGHT, NULL, 0, destinationColors);
+    destinationImages[1] = CreateNoiseImage(CHECK_WIDTH, CHECK_HEIGHT, translucent, 5, destinationColors);
+
+    // Channels at both ends of the range and in between
+    static const LunoColor colors[] = {{255, 255, 255, 255}, {0, 0, 0, 255}, {255, 0, 128, 255}, {1, 254, 77, 255}};
+    for (size_t c = 0; c < sizeof(colors) / sizeof(colors[0]); c++)
+    {
+        LunoColor color = colors[c];
+        DrawDestination();
+        Luno_DrawPixel(17, 33, color);
+        CheckPrimitive("pixel", color);
+        DrawDestination();
+        Luno_DrawLine(-10, 5, 300, 200, color);
+        CheckPrimitive("line", color);
+        DrawDestination();
+        Luno_DrawRect((LunoRect){13, 7, 250, 190}, color, true);
+        CheckPrimitive("filled rectangle", color);
+        DrawDestination();
+        Luno_DrawRect((LunoRect){13, 7, 250, 190}, color, false);
+        CheckPrimitive("rectangle", color);
+        DrawDestination();
+        Luno_DrawCircle(150, 110, 90, color, true);
+        CheckPrimitive("filled circle", color);
+        DrawDestination();
+        Luno_DrawCircle(150, 110, 90, color, false);
+        CheckPrimitive("circle", color);
+        DrawDestination();
+        Luno_DrawEllipse(150, 110, 140, 60, color, true);
+        CheckPrimitive("filled ellipse", color);
+        DrawDestination();
+        Luno_DrawText("Luno 255 !?", 20, 100, color);
+        CheckPrimitive("text", color);
+    }
+
+    // Opaque, binary and translucent images, the last with alpha 255 on every other pixel
+    static const int binary[] = {0, 255, 255};
+    static const int mixed[] = {255, 1, 255, 128, 255, 254};
+    static const int *alphas[] = {NULL, binary, mixed};
+    static const int alphaCounts[] = {0, 3, 6};
+    static const char *names[] = {"opaque image", "binary image", "translucent image"};
+    static LunoColor imageColors[100 * 70];
+    for (int i = 0; i < 3; i++)
+    {
+        LunoImage *image = CreateNoiseImage(100, 70, alphas[i], alphaCounts[i], imageColors);
+        LunoRect whole = {0, 0, image->width, image->height};
+        CheckImage(names[i], image, imageColors, 31, 17, whole);
+        CheckImage(names[i], image, imageColors, -40, 200, whole);
+        CheckImage(names[i], image, imageColors, 250, -9, (LunoRect){11, 5, 60, 50});
+        Luno_DestroyImage(image);
+    }
+
+    Luno_DestroyImage(destinationImages[0]);
+    Luno_DestroyImage(destinationImages[1]);
+    Luno_Close();
+}
+
+// --- Tiled rendering ---
+// The busy scene of the benchsuite scene/ cases, plus lines, outlines, ellipses, image rects and single pixels, must
+// come out of the tiled renderer bit-identical to immediate drawing with any number of threads.
+
+#define SCENE_WIDTH 1920
+#define SCENE_HEIGHT 1080
+
+static LunoImage *sceneSprites[3];
+
+static void DrawScene(void)
+{
+    unsigned int seed = 777;
+    Luno_Clear();
+    for (int i = 0; i < 900; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        int x = (seed >> 8) % SCENE_WIDTH;
+        int y = (seed >> 4) % SCENE_HEIGHT;
+        LunoColor color = {(seed >> 16) & 0xFF, (seed >> 20) & 0xFF, (seed >> 24) & 0xFF, (i & 1) ? 255 : 140};
+        switch (i % 9)
+        {
+        case 0:
+            Luno_DrawRect((LunoRect){x - 100, y - 60, 200, 120}, color, true);
+            break;
+        case 1:
+            Luno_DrawCircle(x, y, 60, color, true);
+            break;
+        case 2:
+        case 3:
+            Luno_DrawImage(sceneSprites[i % 3], x - 32, y - 32);
+            break;
+        case 4:
+            Luno_DrawText("The quick brown fox jumps over the lazy dog", x - 200, y, color);
+            break;
+        case 5:
+            Luno_DrawLine(x, y, x + (int)(seed % 400) - 200, y + (int)((seed >> 12) % 300) - 150, color);
+            break;
+        case 6:
+            Luno_DrawEllipse(x, y, 90, 40, color, (seed >> 3) & 1);
+            Luno_DrawCircle(x, y, 30, color, false);
+            break;
+        case 7:
+            Luno_DrawImageRect(sceneSprites[i % 3], x, y, (LunoRect){8, 16, 40, 30});
+            Luno_DrawRect((LunoRect){x - 50, y - 50, 100, 100}, color, false);
+            break;
+        default:
+            Luno_DrawPixel(x, y, color);
+            break;
+        }
+    }
+}
+
+static void CheckTiledRendering(void)
+{
+    static const int alphas[] = {0, 255, 90, 255, 200, 31};
+    static const int alphaCounts[] = {0, 2, 6}; // Opaque, binary and translucent
+    static LunoColor spriteColors[64 * 64];
+    if (!Luno_Create("check", SCENE_WIDTH, SCENE_HEIGHT, 0))
+        return;
+
+    for (int i = 0; i < 3; i++)
+        sceneSprites[i] = CreateNoiseImage(64, 64, alphas, alphaCounts[i], spriteColors);
+
+    size_t bytes = (size_t)SCENE_WIDTH * SCENE_HEIGHT * sizeof(LunoColor);
+    LunoColor *immediate = (LunoColor *)malloc(bytes);
+    LunoColor *tiled = (LunoColor *)malloc(bytes);
+    Luno_SetTiledRendering(false);
+    DrawScene();
+    Luno_ReadFrame(immediate);
+
+    Luno_SetTiledRendering(true);
+    // At least 8 threads, so that tiles are shared out even on machines with few cores
+    int most = Luno_GetThreadCount() > 8 ? Luno_GetThreadCount() : 8;
+    for (int threads = 1; threads <= most; threads++)
+    {
+        Luno_SetThreadCount(threads);
+        DrawScene();
+        Luno_ReadFrame(tiled);
+
+        int wrong = 0, first = -1;
+        for (int i = 0; i < SCENE_WIDTH * SCENE_HEIGHT; i++)
+        {
+            if (!SameColor(immediate[i], tiled[i]))
+            {
+                wrong++;
+                first = (first < 0) ? i : first;
+            }
+        }
+        Expect(wrong == 0, "tiled rendering with %d threads: %d pixels differ from immediate drawing, first at %d,%d",
+               threads, wrong, first % SCENE_WIDTH, first / SCENE_WIDTH);
+    }
+    Luno_SetTiledRendering(false);
+    Luno_SetThreadCount(0);
+
+    free(immediate);
+    free(tiled);
+    for (int i = 0; i < 3; i++)
+        Luno_DestroyImage(sceneSprites[i]);
+    Luno_Close();
+}
+
+// --- Frame statistics ---
+// The pixels counted per primitive must be the pixels the draw changed. Each primitive is drawn opaque over the
+// background and partly outside the frame (so glyphs and shapes are clipped), immediately and tiled with several
+// threads. Whole-frame draws take the banded path of immediate drawing. Outline circles and rectangles write some
+// pixels twice, which are counted twice, so they are left out.
+
+static LunoImage *statsImage;
+
+static LunoPrimitive DrawStatsPrimitive(int index)
+{
+    static const LunoColor white = {255, 255, 255, 255};
+    switch (index)
+    {
+    case 0:
+        Luno_DrawLine(-10, 5, 330, 200, white);
+        return LUNO_PRIMITIVE_LINE;
+    case 1:
+        Luno_DrawRect((LunoRect){250, -20, 100, 90}, white, true);
+        return LUNO_PRIMITIVE_RECT;
+    case 2:
+        Luno_DrawRect((LunoRect){-20, -20, 400, 300}, white, true);
+        return LUNO_PRIMITIVE_RECT;
+    case 3:
+        Luno_DrawCircle(300, 20, 60, white, true);
+        return LUNO_PRIMITIVE_CIRCLE;
+    case 4:
+        Luno_DrawCircle(160, 120, 200, white, true);
+        return LUNO_PRIMITIVE_CIRCLE;
+    case 5:
+        Luno_DrawLine(100, -50, 100, 300, white);
+        return LUNO_PRIMITIVE_LINE;
+    case 6:
+        Luno_DrawEllipse(10, 200, 90, 50, white, true);
+        return LUNO_PRIMITIVE_ELLIPSE;
+    case 7:
+        Luno_DrawEllipse(200, 100, 150, 30, white, false);
+        return LUNO_PRIMITIVE_ELLIPSE;
+    case 8:
+        Luno_DrawText("Luno 255 !? The quick brown fox jumps over the lazy dog", -5, -3, white);
+        return LUNO_PRIMITIVE_TEXT;
+    case 9:
+        Luno_DrawText("Clipped at the bottom", 200, 235, white);
+        return LUNO_PRIMITIVE_TEXT;
+    default:
+        Luno_DrawImage(statsImage, 290, 220);
+        return LUNO_PRIMITIVE_IMAGE;
+    }
+}
+
+static void CheckStatsCounts(const char *mode)
+{
+    for (int index = 0; index <= 10; index++)
+    {
+        Luno_Clear();
+        Luno_Update(); // The clear is counted in this frame
+        LunoPrimitive primitive = DrawStatsPrimitive(index);
+        Luno_ReadFrame(frame);
+        Luno_Update();
+
+        LunoFrameStats stats;
+        Luno_GetFrameStats(&stats);
+        int changed = 0;
+        for (int i = 0; i < CHECK_WIDTH * CHECK_HEIGHT; i++)
+            changed += !SameColor(frame[i], background);
+        Expect(stats.draws[primitive] == 1, "%s: draw %d counted %d times", mode, index, stats.draws[primitive]);
+        Expect(stats.pixels[primitive] == changed, "%s: draw %d counted %lld pixels but changed %d", mode, index,
+               stats.pixels[primitive], changed);
+    }
+}
+
+static void CheckFrameStats(void)
+{
+    static LunoColor imageColors[64 * 64];
+    if (!Luno_Create("check", CHECK_WIDTH, CHECK_HEIGHT, 0))
+        return;
+
+    Luno_SetClearColor(background);
+    statsImage = CreateNoiseImage(64, 64, NULL, 0, imageColors);
+    Luno_SetFrameStats(true);
+    CheckStatsCounts("immediate");
+
+    Luno_SetTiledRendering(true);
+    Luno_SetThreadCount(4);
+    CheckStatsCounts("tiled");
+    Luno_SetTiledRendering(false);
+    Luno_SetThreadCount(0);
+
+    Luno_SetFrameStats(false);
+    Luno_DestroyImage(statsImage);
+    Luno_Close();
+}
+
+int main(void)
+{
+    CheckCircleCoverage();
+    CheckOpaqueOverwrite();
+    CheckTiledRendering();
+    CheckFrameStats();
+
+    printf("%d of %d checks passed\n", checks - failures, checks);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,305 @@
+// Packs TGA and QOI images into a .lunopak bundle that Luno_OpenPak maps and uses without decoding.
+// Build: gcc -O2 -DLUNO_HEADLESS -o lunopak lunopak.c -lm -pthread
+//        (add -DLUNO_PREMULTIPLIED if the game is built with it, the pixels are stored ready to draw)
+//
+// Usage: lunopak OUTPUT.lunopak [--font COLUMNSxROWS] INPUT...
+//   INPUT             a TGA or QOI file, or a directory whose TGA and QOI files are packed recursively
+//   --font CxR        also pack the glyph tables of the next input, for Luno_LoadFont(path, C, R)
+//
+// Entries are named by their path as given on the command line with '/' separators: `lunopak game.lunopak assets`
+// packs assets/player.tga, which Luno_LoadImage("assets/player.tga") then finds in the mounted bundle.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define LUNO_IMPL
+#include "../luno.h"
+
+typedef struct
+{
+    char *name;
+    int columns, rows; // Glyph layout if the image is packed as a font, 0 otherwise
+} PakInput;
+
+static PakInput *inputs;
+static int inputCount, inputCapacity;
+
+static void AddFile(const char *path, int columns, int rows)
+{
+    if (inputCount == inputCapacity)
+    {
+        inputCapacity = inputCapacity ? inputCapacity * 2 : 64;
+        inputs = (PakInput *)realloc(inputs, inputCapacity * sizeof(PakInput));
+    }
+
+    // Bundles store single '/' separators and no leading "./"
+    while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+        path += 2;
+    char *name = (char *)malloc(strlen(path) + 1);
+    char *out = name;
+    for (const char *c = path; *c; c++)
+    {
+        char next = (*c == '\\') ? '/' : *c;
+        if (next != '/' || out == name || out[-1] != '/')
+            *out++ = next;
+    }
+    *out = 0;
+
+    inputs[inputCount++] = (PakInput){name, columns, rows};
+}
+
+static void FreeInputs(void)
+{
+    for (int i = 0; i < inputCount; i++)
+        free(inputs[i].name);
+    free(inputs);
+    inputs = NULL;
+    inputCount = inputCapacity = 0;
+}
+
+static bool HasExtension(const char *name, const char *extension)
+{
+    size_t length = strlen(name);
+    if (length < 4 || name[length - 4] != '.')
+        return false;
+    for (int i = 0; i < 3; i++)
+    {
+        if ((name[length - 3 + i] | 32) != extension[i])
+            return false;
+    }
+    return true;
+}
+
+static bool IsImage(const char *name)
+{
+    return HasExtension(name, "tga") || HasExtension(name, "qoi");
+}
+
+static void AddDirectory(const char *path)
+{
+    char child[4096];
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    snprintf(child, sizeof(child), "%s/*", path);
+    HANDLE search = FindFirstFileA(child, &found);
+    if (search == INVALID_HANDLE_VALUE)
+        return;
+    do
+    {
+        if (!strcmp(found.cFileName, ".") || !strcmp(found.cFileName, ".."))
+            continue;
+        snprintf(child, sizeof(child), "%s/%s", path, found.cFileName);
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            AddDirectory(child);
+        else if (IsImage(found.cFileName))
+            AddFile(child, 0, 0);
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+#else
+    DIR *directory = opendir(path);
+    if (!directory)
+        return;
+    struct dirent *found;
+    while ((found = readdir(directory)))
+    {
+        if (!strcmp(found->d_name, ".") || !strcmp(found->d_name, ".."))
+            continue;
+        snprintf(child, sizeof(child), "%s/%s", path, found->d_name);
+        struct stat info;
+        if (stat(child, &info) != 0)
+            continue;
+        if (S_ISDIR(info.st_mode))
+            AddDirectory(child);
+        else if (IsImage(found->d_name))
+            AddFile(child, 0, 0);
+    }
+    closedir(directory);
+#endif
+}
+
+static bool IsDirectory(const char *path)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+static int CompareInputs(const void *a, const void *b)
+{
+    return strcmp(((const PakInput *)a)->name, ((const PakInput *)b)->name);
+}
+
+// Pads the file with zeros up to the next multiple of LUNO_ALIGNMENT.
+static uint64_t Align(FILE *file, uint64_t offset)
+{
+    static const unsigned char zeros[LUNO_ALIGNMENT];
+    uint64_t padding = (LUNO_ALIGNMENT - offset % LUNO_ALIGNMENT) % LUNO_ALIGNMENT;
+    fwrite(zeros, 1, (size_t)padding, file);
+    return offset + padding;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: lunopak OUTPUT.lunopak [--font COLUMNSxROWS] INPUT...\n");
+        return EXIT_FAILURE;
+    }
+
+    int columns = 0, rows = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--font"))
+        {
+            if (i + 1 >= argc || sscanf(argv[i + 1], "%dx%d", &columns, &rows) != 2 || columns <= 0 || rows <= 0)
+            {
+                fprintf(stderr, "--font expects COLUMNSxROWS, e.g. --font 16x16\n");
+                FreeInputs();
+                return EXIT_FAILURE;
+            }
+            i++;
+            continue;
+        }
+
+        if (IsDirectory(argv[i]))
+            AddDirectory(argv[i]);
+        else
+            AddFile(argv[i], columns, rows);
+        columns = rows = 0;
+    }
+
+    // Luno_OpenPak finds paths by binary search. A file named on its own (e.g. with --font) and again through its
+    // directory is packed once, with the font layout it was given.
+    qsort(inputs, inputCount, sizeof(PakInput), CompareInputs);
+    int unique = 0;
+    for (int i = 0; i < inputCount; i++)
+    {
+        PakInput *last = unique > 0 ? &inputs[unique - 1] : NULL;
+        if (!last || strcmp(last->name, inputs[i].name))
+        {
+            inputs[unique++] = inputs[i];
+            continue;
+        }
+
+        if (last->columns > 0 && inputs[i].columns > 0 && (last->columns != inputs[i].columns || last->rows != inputs[i].rows))
+        {
+            fprintf(stderr, "%s is packed with two glyph layouts\n", inputs[i].name);
+            for (int j = i; j < inputCount; j++) // Names not yet kept or freed
+                free(inputs[j].name);
+            inputCount = unique;
+            FreeInputs();
+            return EXIT_FAILURE;
+        }
+        if (inputs[i].columns > 0)
+        {
+            last->columns = inputs[i].columns;
+            last->rows = inputs[i].rows;
+        }
+        free(inputs[i].name);
+    }
+    inputCount = unique;
+
+    FILE *file = fopen(argv[1], "wb");
+    if (!file)
+    {
+        perror("Failed to open output file");
+        FreeInputs();
+        return EXIT_FAILURE;
+    }
+
+    // Header and entries are written once all payload offsets are known; names follow them
+    _LunoPakEntry *entries = (_LunoPakEntry *)calloc(inputCount > 0 ? inputCount : 1, sizeof(_LunoPakEntry));
+    uint64_t offset = sizeof(_LunoPakHeader) + (uint64_t)inputCount * sizeof(_LunoPakEntry);
+    fseek(file, (long)offset, SEEK_SET);
+    for (int i = 0; i < inputCount; i++)
+    {
+        size_t length = strlen(inputs[i].name) + 1;
+        entries[i].nameOffset = (uint32_t)offset;
+        fwrite(inputs[i].name, 1, length, file);
+        offset += length;
+    }
+
+    // One image in memory at a time, however large the set is
+    uint64_t pixelBytes = 0;
+    for (int i = 0; i < inputCount; i++)
+    {
+        LunoImage *image = Luno_LoadImage(inputs[i].name);
+        offset = Align(file, offset);
+        entries[i].width = (uint32_t)image->width;
+        entries[i].height = (uint32_t)image->height;
+        entries[i].alphaClass = (uint32_t)image->alphaClass;
+        entries[i].pixelOffset = offset;
+        size_t bytes = (size_t)image->width * image->height * sizeof(LunoColor);
+        fwrite(image->pixels, 1, bytes, file);
+        offset += bytes;
+        pixelBytes += bytes;
+
+        if (inputs[i].columns > 0)
+        {
+            LunoFont *font = Luno_FontFromImage(image, inputs[i].columns, inputs[i].rows);
+            if (!font)
+            {
+                fprintf(stderr, "%s cannot be split into %dx%d glyphs\n", inputs[i].name, inputs[i].columns, inputs[i].rows);
+                Luno_DestroyImage(image);
+                free(entries);
+                FreeInputs();
+                fclose(file);
+                remove(argv[1]); // Not a valid bundle
+                return EXIT_FAILURE;
+            }
+
+            _LunoPakFont record;
+            record.columns = (uint32_t)inputs[i].columns;
+            record.rows = (uint32_t)inputs[i].rows;
+            record.maskBits = (uint32_t)font->maskBits;
+            record.maskSize = 0;
+            for (int g = 0; g < 256; g++)
+            {
+                const LunoGlyph *glyph = &font->glyphs[g];
+                uint32_t end = (uint32_t)(glyph->maskOffset + glyph->maskPitch * glyph->bounds.h);
+                if (end > record.maskSize)
+                    record.maskSize = end;
+            }
+            memcpy(record.glyphs, font->glyphs, sizeof(record.glyphs));
+
+            offset = Align(file, offset);
+            entries[i].fontOffset = offset;
+            fwrite(&record, 1, sizeof(record), file);
+            fwrite(font->mask, 1, record.maskSize, file);
+            offset += sizeof(record) + record.maskSize;
+            Luno_DestroyFont(font);
+        }
+
+        printf("%-48s %5dx%-5d%s\n", inputs[i].name, image->width, image->height, inputs[i].columns > 0 ? " font" : "");
+        Luno_DestroyImage(image);
+    }
+
+    _LunoPakHeader header = {LUNO_PAK_MAGIC, LUNO_PAK_VERSION, 0, (uint32_t)inputCount, sizeof(_LunoPakEntry), offset, {0}};
+#ifdef LUNO_PREMULTIPLIED
+    header.flags |= LUNO_PAK_PREMULTIPLIED;
+#endif
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, 1, sizeof(header), file);
+    fwrite(entries, sizeof(_LunoPakEntry), inputCount, file);
+    free(entries);
+    int packed = inputCount;
+    FreeInputs();
+    if (ferror(file) | fclose(file))
+    {
+        fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    printf("Packed %d images (%.1f MB of pixels) into %s\n", packed, pixelBytes / (1024.0 * 1024.0), argv[1]);
+    return 0;
+}
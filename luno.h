@@ -1,9 +1,13 @@
 #ifndef LUNO_H
 #define LUNO_H
 
+#ifndef LUNO_HEADLESS
 #include <windows.h>
 #include <windowsx.h>
+#endif
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -14,7 +18,7 @@ extern "C"
 {
 #endif
 
-#ifdef _MSC_VER
+#if defined(_MSC_VER) && !defined(LUNO_HEADLESS)
 #pragma comment(lib, "gdi32.lib")
 #pragma comment(lib, "user32.lib")
 #pragma comment(lib, "winmm.lib")
@@ -71,11 +75,36 @@ extern "C"
         unsigned char r, g, b, a;
     } LunoColor; // Represents an RGBA color.
 
-    typedef struct
+    typedef enum
+    {
+        LUNO_ALPHA_TRANSLUCENT = 0, // Any alpha values, pixels are blended.
+        LUNO_ALPHA_BINARY,          // Only alpha 0 or 255, pixels are either skipped or copied.
+        LUNO_ALPHA_OPAQUE,          // Only alpha 255, rows are copied.
+    } LunoAlphaClass;               // Selects the fastest correct way to draw an image.
+
+    typedef enum
+    {
+        LUNO_FORMAT_BGRA32 = 0, // 4 bytes per pixel: blue, green, red, alpha (native storage).
+        LUNO_FORMAT_RGBA32,     // 4 bytes per pixel: red, green, blue, alpha (LunoColor order).
+        LUNO_FORMAT_BGR24,      // 3 bytes per pixel: blue, green, red (24-bit TGA order).
+        LUNO_FORMAT_RGB24,      // 3 bytes per pixel: red, green, blue.
+    } LunoPixelFormat;          // Memory layout of pixel data.
+
+#define LUNO_FORMAT_NATIVE LUNO_FORMAT_BGRA32 // Layout of all LunoImage pixels and the backbuffer.
+
+    typedef struct LunoImageArena LunoImageArena; // Block allocator for images that are freed together.
+    typedef struct LunoPak LunoPak;               // Mapped bundle of pre-decoded images and fonts.
+
+    typedef struct LunoImage
     {
         LunoColor *pixels;
         int width, height;
-    } LunoImage; // Represents an image or a buffer.
+        LunoAlphaClass alphaClass; // Computed on load, call Luno_UpdateImageAlpha after writing pixels.
+        LunoPixelFormat format;    // Layout of `pixels`, always LUNO_FORMAT_NATIVE for drawable images.
+        LunoImageArena *arena;     // Arena the image lives in, NULL if it was allocated on its own.
+        int pitch;                 // Pixels from the start of one row to the next, 0 for rows of exactly `width`.
+        struct LunoImage *parent;  // Image a view shows part of, NULL if the image owns its pixels.
+    } LunoImage;                   // Represents an image, a view into one or a buffer.
 
     typedef struct
     {
@@ -90,16 +119,62 @@ extern "C"
 
     typedef struct
     {
-        LunoRect rect; // Portion of the image representing the glyph.
-        int xadv;      // Horizontal advance after drawing the glyph.
-    } LunoGlyph;       // Represents a single character in a font.
+        LunoRect rect;   // Portion of the image representing the glyph.
+        int xadv;        // Horizontal advance after drawing the glyph.
+        LunoRect bounds; // Covered pixels relative to `rect` (empty for blank glyphs).
+        int maskOffset;  // Byte offset of the glyph's coverage mask in the font's `mask`.
+        int maskPitch;   // Bytes per coverage mask row.
+        int covered;     // Pixels with nonzero coverage.
+    } LunoGlyph;         // Represents a single character in a font.
 
     typedef struct
     {
         LunoImage *image;      // Image containing all glyphs.
         LunoGlyph glyphs[256]; // Glyphs for ASCII characters.
+        unsigned char *mask;   // Coverage masks of all glyphs, cropped to their bounds.
+        int maskBits;          // 1 (binary alpha, most significant bit first) or 8 bits of coverage per pixel.
+        bool ownsImage;        // The image was loaded with the font and is destroyed with it.
     } LunoFont;                // Represents a bitmap font.
 
+    typedef enum
+    {
+        LUNO_LOAD_NONE = 0, // Unknown handle, or the load was taken or cancelled.
+        LUNO_LOAD_PENDING,  // Queued or loading; finished loads stay pending until the next Luno_Update.
+        LUNO_LOAD_DONE,     // Loaded, the result waits for Luno_TakeLoadedImage or Luno_TakeLoadedFont.
+        LUNO_LOAD_FAILED,   // Not loaded, Luno_GetLoadError tells why.
+    } LunoLoadState;        // Progress of a load started with Luno_LoadImageAsync or Luno_LoadFontAsync.
+
+    typedef struct LunoCommandBuffer LunoCommandBuffer; // Recorded draw calls that can be submitted any number of times.
+
+    typedef enum
+    {
+        LUNO_PRIMITIVE_CLEAR = 0,
+        LUNO_PRIMITIVE_PIXEL,
+        LUNO_PRIMITIVE_LINE,
+        LUNO_PRIMITIVE_RECT,
+        LUNO_PRIMITIVE_CIRCLE,
+        LUNO_PRIMITIVE_ELLIPSE,
+        LUNO_PRIMITIVE_IMAGE,
+        LUNO_PRIMITIVE_TEXT,
+        LUNO_PRIMITIVE_COUNT,
+    } LunoPrimitive; // Kinds of draw calls counted in LunoFrameStats.
+
+#define LUNO_STATS_BUCKETS 32 // Histogram buckets of LunoFrameStats, one per millisecond.
+
+    typedef struct
+    {
+        double frameTime;                       // Seconds from the end of the previous Luno_Update to the end of this one.
+        double drawTime;                        // Seconds spent rasterizing draw calls.
+        double presentTime;                     // Seconds spent presenting (or queueing the frame for the present thread).
+        double sleepTime;                       // Seconds slept to hold the target frame rate.
+        double pumpTime;                        // Seconds spent processing window messages.
+        int draws[LUNO_PRIMITIVE_COUNT];        // Draw calls per primitive, fully clipped ones are not counted.
+        long long pixels[LUNO_PRIMITIVE_COUNT]; // Pixels written per primitive, counted by the rasterizers.
+        int frames;                             // Frames in the rolling window the figures below are taken over.
+        double minFrameTime, avgFrameTime, p99FrameTime, maxFrameTime;
+        int histogram[LUNO_STATS_BUCKETS]; // Frames per millisecond of frame time, the last bucket holds all slower ones.
+    } LunoFrameStats;                      // Timings and draw counts of a frame.
+
     double lunoDT;  // Delta time in seconds since the last frame.
     double lunoFPS; // Current frames per second.
     int lunoMS;     // Milliseconds since the application started.
@@ -136,33 +211,121 @@ extern "C"
     // Creates a blank image with the given dimensions.
     LunoImage *Luno_CreateImage(int width, int height);
 
-    // Loads an image from a file.
+    // Loads an image from a file (TGA or QOI, told apart by their content).
     LunoImage *Luno_LoadImage(const char *filePath);
 
-    // Loads an image from memory.
+    // Loads an image from memory (TGA or QOI).
     LunoImage *Luno_LoadImageMem(unsigned char *buffer, int bufferLen);
 
+    // Writes an image to a QOI file. Returns false if it could not be written.
+    bool Luno_SaveImage(LunoImage *image, const char *filePath);
+
     // Fills an image with a specified color.
     void Luno_FillImage(LunoImage *image, LunoColor color);
 
+    // Recomputes the alpha class of an image after its pixels were written directly.
+    void Luno_UpdateImageAlpha(LunoImage *image);
+
+    // Converts `count` pixels between two pixel formats (24-bit sources get alpha 255).
+    void Luno_ConvertPixels(void *dst, LunoPixelFormat dstFormat, const void *src, LunoPixelFormat srcFormat, int count);
+
     // Draws an image at the specified position.
     void Luno_DrawImage(LunoImage *image, int x, int y);
 
     // Draws a portion of an image at the specified position.
     void Luno_DrawImageRect(LunoImage *image, int x, int y, LunoRect srcRect);
 
-    // Frees the memory associated with an image.
+    // Frees the memory associated with an image. Images of an arena are freed with the arena.
     void Luno_DestroyImage(LunoImage *image);
 
+    // Creates a view of `rect` (clipped to the image) that shares the pixels of `image` instead of copying them.
+    // Views are drawn, filled and read like images. Destroying a view leaves its parent alone; destroy views first.
+    LunoImage *Luno_CreateImageView(LunoImage *image, LunoRect rect);
+
+    // Cuts a sprite sheet into views of `frameWidth` x `frameHeight`, row by row, and stores up to `maxViews` of
+    // them in `views`. Returns the number of frames the sheet holds.
+    int Luno_SliceImage(LunoImage *image, int frameWidth, int frameHeight, LunoImage **views, int maxViews);
+
     // Draws a rectangle (filled or outlined).
     void Luno_DrawRect(LunoRect rect, LunoColor color, bool fill);
 
     // Draws a circle (filled or outlined).
     void Luno_DrawCircle(int x, int y, int radius, LunoColor color, bool fill);
 
+    // Draws an ellipse (filled or outlined) with the given horizontal and vertical radius.
+    void Luno_DrawEllipse(int x, int y, int radiusX, int radiusY, LunoColor color, bool fill);
+
     // Draws a line between two points.
     void Luno_DrawLine(int x1, int y1, int x2, int y2, LunoColor color);
 
+    /** Image Arenas **/
+
+    // Creates an arena that carves images out of blocks of `blockSize` bytes (0 for 4 MB), without a heap
+    // allocation per image. Images larger than a quarter block get a block of their own.
+    LunoImageArena *Luno_CreateImageArena(int blockSize);
+
+    // Makes images created or loaded from now on (including font images) come from `arena`, NULL for the heap.
+    void Luno_SetImageArena(LunoImageArena *arena);
+
+    // Frees all images of an arena at once and keeps one block for the next images.
+    void Luno_ResetImageArena(LunoImageArena *arena);
+
+    // Frees an arena with all its images. Destroy fonts made from its images first.
+    void Luno_DestroyImageArena(LunoImageArena *arena);
+
+    /** Asset Bundles **/
+
+    // Maps a .lunopak bundle of pre-decoded images and fonts (built with examples/lunopak.c) and mounts it:
+    // Luno_LoadImage and Luno_LoadFont look paths up in mounted bundles first and return views of the pixels in the
+    // mapping without decoding anything. Bundles opened later shadow earlier ones.
+    LunoPak *Luno_OpenPak(const char *filePath);
+
+    // Unmounts and unmaps a bundle. Destroy the images and fonts loaded from it first.
+    void Luno_ClosePak(LunoPak *pak);
+
+    /** Async Loading **/
+
+    // Queues an image file (or bundle entry) to be loaded on a background thread and returns its handle right away,
+    // 0 if out of memory. Higher `priority` loads start first, equal ones in request order. Finished loads are
+    // dispatched in Luno_Update: `callback` is called with the handle, without a callback the handle is listed by
+    // Luno_GetFinishedLoads. Failing loads report an error instead of exiting. Async images never come from an arena.
+    int Luno_LoadImageAsync(const char *filePath, int priority, void (*callback)(int load, void *user), void *user);
+
+    // Queues an image in memory to be decoded in the background, like Luno_LoadImageAsync. `buffer` is not copied
+    // and has to stay valid until the load finished or was cancelled.
+    int Luno_LoadImageMemAsync(unsigned char *buffer, int bufferLen, int priority, void (*callback)(int load, void *user), void *user);
+
+    // Queues a font to be loaded in the background, like Luno_LoadImageAsync.
+    int Luno_LoadFontAsync(const char *filePath, int glyphWidth, int glyphHeight, int priority, void (*callback)(int load, void *user), void *user);
+
+    // Returns the progress of a load.
+    LunoLoadState Luno_GetLoadState(int load);
+
+    // Returns why a load failed, NULL if it did not (yet).
+    const char *Luno_GetLoadError(int load);
+
+    // Returns the image of a finished image load and releases the handle. Returns NULL (and also releases the
+    // handle) if the load failed, NULL if it is still pending or not an image load.
+    LunoImage *Luno_TakeLoadedImage(int load);
+
+    // Returns the font of a finished font load and releases the handle, like Luno_TakeLoadedImage.
+    LunoFont *Luno_TakeLoadedFont(int load);
+
+    // Releases a load: a queued one never starts, a running one is discarded once it finished (one from memory is
+    // waited for), a finished one is destroyed. Returns false if the handle is unknown.
+    bool Luno_CancelLoad(int load);
+
+    // Moves a queued load up or down the queue. Returns false if it already started.
+    bool Luno_SetLoadPriority(int load, int priority);
+
+    // Blocks until a load finished (a load no thread took yet is run on the calling thread) and dispatches it right
+    // away: its callback is called before this returns. Returns true if it succeeded.
+    bool Luno_WaitLoad(int load);
+
+    // Copies up to `maxLoads` handles of the callback-less loads that finished in the last Luno_Update into `loads`
+    // and returns how many finished.
+    int Luno_GetFinishedLoads(int *loads, int maxLoads);
+
     /** Update Loop **/
 
     // Processes input and updates the frame.
@@ -219,6 +382,34 @@ extern "C"
     // Returns the elapsed time in milliseconds since the timer was created.
     int Luno_TimerElapsed(LunoTimer *timer);
 
+    // Starts a timer that expires `delay` milliseconds after the current frame, then every `interval` milliseconds
+    // (0 expires once). Expired timers are dispatched in Luno_Update: `callback` is called with the timer's handle,
+    // without a callback the handle is listed by Luno_GetExpiredTimers. Returns the handle, 0 if out of memory.
+    int Luno_StartTimer(int delay, int interval, void (*callback)(int timer, void *user), void *user);
+
+    // Stops a timer started with Luno_StartTimer. Returns false if it already expired or was cancelled.
+    bool Luno_CancelTimer(int timer);
+
+    // Checks if a timer started with Luno_StartTimer is still waiting to expire.
+    bool Luno_IsTimerPending(int timer);
+
+    // Copies up to `maxTimers` handles of the callback-less timers that expired in the last Luno_Update into
+    // `timers` (a repeating timer once per interval that passed) and returns how many expired.
+    int Luno_GetExpiredTimers(int *timers, int maxTimers);
+
+    // Returns the nanoseconds since Luno_Create on the monotonic clock frames are paced with.
+    long long Luno_GetTimeNs();
+
+    // Runs the simulation at a fixed step of `seconds` (0 turns it off): every frame adds its time to an
+    // accumulator that Luno_StepFixed drains.
+    void Luno_SetFixedTimestep(double seconds);
+
+    // Takes one fixed step off the accumulator, false once less than a step is left: while (Luno_StepFixed()) Step();
+    bool Luno_StepFixed();
+
+    // Returns the fraction of a fixed step left in the accumulator (0 to 1), to blend the last two simulation states.
+    double Luno_GetInterpolationAlpha();
+
     /** Font Handling **/
 
     // Creates a font from an image.
@@ -265,6 +456,112 @@ extern "C"
     // Checks if two circles overlap.
     bool Luno_CirclesOverlaps(int cx1, int cy1, float circle1Radius, int cx2, int cy2, float circle2Radius);
 
+    /** Frame Readback **/
+
+    // Returns the backbuffer the drawing functions render into (pixels are stored as BGRA). With frame
+    // buffering the pixels pointer changes every frame, so fetch it again after Luno_Update.
+    LunoImage *Luno_GetBackbuffer();
+
+    // Copies the current frame into `pixels` as RGBA (must hold width * height colors).
+    void Luno_ReadFrame(LunoColor *pixels);
+
+    /** Dirty Rectangles **/
+
+    // Marks a backbuffer region as changed. Drawing functions do this themselves; call it after
+    // writing to the pixels of Luno_GetBackbuffer directly.
+    void Luno_MarkDirty(LunoRect rect);
+
+    // Copies up to `maxRects` regions changed since the last present into `rects` and returns the total count.
+    int Luno_GetDirtyRects(LunoRect *rects, int maxRects);
+
+    // Enables or disables presenting only the changed regions (enabled by default).
+    void Luno_SetPartialPresent(bool enabled);
+
+    /** Frame Statistics **/
+
+    // Enables or disables collecting frame statistics (disabled by default, then draw calls are not timed).
+    void Luno_SetFrameStats(bool enabled);
+
+    // Copies the statistics of the last finished frame into `stats`.
+    void Luno_GetFrameStats(LunoFrameStats *stats);
+
+    // Shows or hides an overlay with the statistics in the top left corner. Showing it enables the statistics.
+    void Luno_SetStatsOverlay(bool visible);
+
+    /** Pipelined Present **/
+
+    // Sets the number of frame buffers (1 to 3). With 1, the default, Luno_Update presents before returning.
+    // With 2 or 3 a present thread shows each finished frame while the next one is drawn into another buffer;
+    // drawing only waits when no buffer is free. Frames are presented in order and never dropped.
+    void Luno_SetFrameBuffering(int count);
+
+    // Calls `callback` with every finished frame (BGRA pixels), e.g. to capture or encode it. It runs on the
+    // present thread with frame buffering and inside Luno_Update otherwise, and must not call other Luno functions.
+    void Luno_SetPresentCallback(void (*callback)(const LunoImage *frame, void *user), void *user);
+
+    /** Multithreading **/
+
+    // Sets the number of threads used for parallel work, including the calling thread (0 = one per CPU core, the default).
+    void Luno_SetThreadCount(int count);
+
+    // Returns the number of threads used for parallel work.
+    int Luno_GetThreadCount();
+
+    // Calls fn(data, begin, end) for consecutive bands of [0, count) on all threads and returns when all are done.
+    // Bands hold `grain` items (the last one may hold fewer) and `begin` is a multiple of `grain`; a single band
+    // runs on the calling thread. Calls made from inside `fn` run serially.
+    void Luno_ParallelFor(int count, int grain, void (*fn)(void *data, int begin, int end), void *data);
+
+    // Enables or disables tiled rendering. Draw calls are then recorded and rasterized tile by tile on all
+    // threads when the frame is presented; the result is identical to drawing immediately. Images and fonts
+    // must stay alive and unchanged until then (Luno_FillImage, Luno_Destroy* and readbacks flush first).
+    void Luno_SetTiledRendering(bool enabled);
+
+    /** Command Buffers **/
+
+    // Creates an empty command buffer.
+    LunoCommandBuffer *Luno_CreateCommandBuffer();
+
+    // Empties `buffer` and records all following draw calls into it instead of drawing them.
+    void Luno_BeginCommandBuffer(LunoCommandBuffer *buffer);
+
+    // Stops recording, draw calls draw again.
+    void Luno_EndCommandBuffer();
+
+    // Draws the recorded commands. A buffer can be submitted any number of times (e.g. every frame for a static
+    // scene); the images and fonts it uses must stay alive. Submitting while recording appends to the recording.
+    void Luno_SubmitCommandBuffer(LunoCommandBuffer *buffer);
+
+    // Returns the number of recorded commands. Fully clipped draws are dropped and adjacent pieces of the same
+    // image are merged into one blit while recording.
+    int Luno_GetCommandCount(LunoCommandBuffer *buffer);
+
+    // Frees a command buffer.
+    void Luno_DestroyCommandBuffer(LunoCommandBuffer *buffer);
+
+#ifdef LUNO_HEADLESS
+    /** Headless Backend **/
+
+    // Installs a time source returning seconds. Pass NULL to use the built-in virtual clock,
+    // which advances exactly one frame step per Luno_Update.
+    void Luno_SetTimeSource(double (*timeSource)(void));
+
+    // Injects a key state change, as if the key was pressed or released.
+    void Luno_InjectKey(int key, bool down);
+
+    // Injects a mouse button state change (0 = left, 1 = right, 2 = middle).
+    void Luno_InjectMouseButton(int button, bool down);
+
+    // Injects a mouse move to the given backbuffer position.
+    void Luno_InjectMouseMove(int x, int y);
+
+    // Injects mouse wheel movement in notches.
+    void Luno_InjectMouseWheel(int delta);
+
+    // Makes the next Luno_Update return false.
+    void Luno_InjectQuit();
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -274,6 +571,92 @@ extern "C"
 #define LUNO_IMPL
 #ifdef LUNO_IMPL
 
+#include <stdint.h>
+#include <limits.h>
+
+// SIMD kernels are picked at compile time; define LUNO_NO_SIMD to force the scalar paths.
+#ifndef LUNO_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LUNO_SSE2
+#endif
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <tmmintrin.h>
+#define LUNO_SSSE3
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LUNO_AVX2
+#endif
+#endif
+
+// Alignment in bytes of all pixel storage Luno allocates, a cache line and the widest SIMD register.
+#ifndef LUNO_ALIGNMENT
+#define LUNO_ALIGNMENT 64
+#endif
+
+// Fills larger than this (in bytes) bypass the cache with non-temporal stores.
+#ifndef LUNO_STREAM_THRESHOLD
+#define LUNO_STREAM_THRESHOLD (4 * 1024 * 1024)
+#endif
+
+// Changed regions tracked per frame before they are merged into each other.
+#ifndef LUNO_MAX_DIRTY_RECTS
+#define LUNO_MAX_DIRTY_RECTS 16
+#endif
+
+// Edge length in pixels of the screen tiles used by tiled rendering.
+#ifndef LUNO_TILE_SIZE
+#define LUNO_TILE_SIZE 64
+#endif
+
+// Fixed steps the accumulator holds at most; time beyond it is dropped so a slow simulation cannot fall further
+// and further behind.
+#ifndef LUNO_MAX_FIXED_STEPS
+#define LUNO_MAX_FIXED_STEPS 8
+#endif
+
+// Frames the rolling frame time figures of LunoFrameStats are taken over.
+#ifndef LUNO_STATS_WINDOW
+#define LUNO_STATS_WINDOW 240
+#endif
+
+// Upper bound for the number of threads (including the calling thread).
+#ifndef LUNO_MAX_THREADS
+#define LUNO_MAX_THREADS 64
+#endif
+
+// Background threads started for Luno_LoadImageAsync and Luno_LoadFontAsync.
+#ifndef LUNO_LOAD_THREADS
+#define LUNO_LOAD_THREADS 2
+#endif
+
+// Bulk pixel operations smaller than this (in pixels) stay on the calling thread; larger ones are split into
+// bands of about this size.
+#ifndef LUNO_PARALLEL_THRESHOLD
+#define LUNO_PARALLEL_THRESHOLD 65536
+#endif
+
+// Allocator for all memory Luno owns. Define all four before including luno.h to replace it (e.g. to count or
+// track allocations); memory is never passed between these and the standard functions.
+#ifndef LUNO_MALLOC
+#define LUNO_MALLOC(size) malloc(size)
+#define LUNO_CALLOC(count, size) calloc(count, size)
+#define LUNO_REALLOC(pointer, size) realloc(pointer, size)
+#define LUNO_FREE(pointer) free(pointer)
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -284,15 +667,110 @@ extern "C"
     static int _lunoFontImageDataSize;
     static int _lunoFontWidth;
     static int _lunoFontHeight;
-    static unsigned char *rc_load_tga_mem(unsigned char *data, size_t size, int *width, int *height);
-    static unsigned char *rc_load_tga(const char *filename, int *width, int *height);
 
     // --- Types ---
+    typedef enum // Same order as LunoPrimitive
+    {
+        _LUNO_DRAW_CLEAR,
+        _LUNO_DRAW_PIXEL,
+        _LUNO_DRAW_LINE,
+        _LUNO_DRAW_RECT,
+        _LUNO_DRAW_CIRCLE,
+        _LUNO_DRAW_ELLIPSE,
+        _LUNO_DRAW_IMAGE,
+        _LUNO_DRAW_TEXT,
+    } _LunoDrawType;
+
+    typedef struct
+    {
+        unsigned char type;  // _LunoDrawType
+        unsigned char fill;
+        unsigned short size; // Encoded size in 8 byte units, payload included
+        LunoColor pixel;     // Color converted with _Luno_ToPixel
+        LunoRect bounds;     // Pixels the command may touch, clipped to the backbuffer
+    } _LunoCommand;          // Header of an encoded draw call, followed by the payload of its type.
+
+    typedef struct
+    {
+        int x, y, a, b;
+    } _LunoShapeArgs; // Line end points, outline rectangle, or center and radii. Pixels and filled rects only need the bounds.
+
+    typedef struct
+    {
+        LunoImage *image;
+        int srcX, srcY; // Source pixel drawn at the top left of the bounds
+    } _LunoImageArgs;
+
+    typedef struct
+    {
+        LunoFont *font;
+        int x, y;
+    } _LunoTextArgs; // Followed by the zero-terminated text.
+
+    struct LunoCommandBuffer
+    {
+        unsigned char *data; // Encoded commands, each 8 byte aligned
+        int size, capacity;  // In bytes
+        int count;
+        int last; // Offset of the last command
+    };
+
+#ifdef _WIN32
+    typedef HANDLE _LunoThread;
+    typedef CRITICAL_SECTION _LunoMutex;
+    typedef CONDITION_VARIABLE _LunoCond;
+    typedef DWORD(WINAPI *_LunoThreadMain)(LPVOID arg);
+#else
+    typedef pthread_t _LunoThread;
+    typedef pthread_mutex_t _LunoMutex;
+    typedef pthread_cond_t _LunoCond;
+    typedef void *(*_LunoThreadMain)(void *arg);
+#endif
+
+    typedef void (*_LunoJob)(void *data, int index);
+
+    typedef struct
+    {
+        _LunoMutex lock;
+        int next, end;    // Indices of the current batch this thread still owns
+        int seen;         // Generation a worker was started in
+        char padding[64]; // Keeps the slots of different threads on separate cache lines
+    } _LunoRange;
+
+    typedef struct
+    {
+        bool initialized;
+        _LunoMutex mutex;
+        _LunoCond wake; // A batch was posted or the workers should quit
+        _LunoCond done; // The last worker left the batch
+        _LunoThread threads[LUNO_MAX_THREADS];
+        int threadCount; // Requested threads including the caller, 0 = one per CPU core
+        int running;     // Worker threads started
+        int generation;  // Incremented for every batch
+        int busy;        // Workers still inside the current batch
+        bool quit;
+        bool active; // A batch is running, parallel calls made from inside it run serially
+        _LunoJob job;
+        void *data;
+        _LunoRange ranges[LUNO_MAX_THREADS]; // Slot 0 is the calling thread, slot i + 1 worker i
+    } _LunoPool; // Worker threads that run the indices of a batch in any order.
+
     typedef struct
     {
         const char *title;
+#ifndef LUNO_HEADLESS
         HWND hwnd;
         HDC hdc;
+        LunoRect presentRects[LUNO_MAX_DIRTY_RECTS]; // Regions invalidated for the next WM_PAINT
+        int presentCount;
+        bool presentFull;
+        double sleepMean, sleepVariance, sleepEstimate; // Seconds a Sleep(1) takes: running mean, variance and bound
+        int sleepSamples;
+#else
+        double (*timeSource)(void);
+        double virtualTime;
+        bool quitRequested;
+#endif
         LunoImage backbuffer;
         LunoColor clearColor;
         bool keys[256];
@@ -309,229 +787,4278 @@ extern "C"
         double stepTime;
         double prevTime;
         double startTime;
+        double fixedStep;   // Fixed simulation step in seconds, 0 if off
+        double accumulator; // Frame time not yet taken off by Luno_StepFixed
         LunoFont *currentFont;
         LunoFont *defaultFont;
+        LunoRect dirtyRects[LUNO_MAX_DIRTY_RECTS];
+        int dirtyCount;
+        bool dirtyFull; // The whole backbuffer changed (or partial presents are disabled)
+        bool partialPresent;
+        bool tiledRendering;
+        LunoCommandBuffer frame;       // Draws recorded for tiled rendering
+        LunoCommandBuffer scratch;     // Encoding of the current draw call
+        LunoCommandBuffer *recording;  // Buffer draw calls are recorded into, NULL to draw
+        LunoImageArena *imageArena;    // Arena new images are allocated from, NULL for the heap
+        LunoPak *paks;                 // Mounted bundles, newest first
+        int *tileStart; // Per tile: first entry in tileDraws (tiles + 1 entries)
+        int *tileDraws; // Offsets of the commands in `frame`, grouped by tile in submission order
+        long long *tilePixels; // Pixels written per tile and draw type while statistics are collected
+        int tileCapacity, tileDrawCapacity, tilePixelCapacity;
     } _LunoContext;
 
+    typedef struct
+    {
+        LunoImage image;
+        LunoRect dirtyRects[LUNO_MAX_DIRTY_RECTS]; // Changes since the previous frame, copied when queued
+        int dirtyCount;
+        bool dirtyFull;
+        LunoRect behind; // Area later frames changed that this buffer does not hold yet
+    } _LunoFrame;
+
+    typedef struct
+    {
+        bool initialized;
+        int count;   // Frame buffers, 0 or 1 = present synchronously in Luno_Update
+        int current; // Buffer drawn into
+        _LunoFrame frames[3];
+        _LunoThread thread;
+        bool running;
+        bool quit;
+        _LunoMutex mutex;
+        _LunoCond wake;      // A frame was queued or the thread should quit
+        _LunoCond done;      // A buffer was picked up or released
+        volatile long state;    // Queued buffer + 1 in bits 0-7, buffer being presented + 1 in bits 8-15
+        volatile long sleepers; // Threads waiting on wake or done, changes of state only lock the mutex while > 0
+#ifndef LUNO_HEADLESS
+        volatile long repaint; // The window needs a full repaint, set by WM_PAINT / WM_SIZE
+#endif
+        bool restore; // The current buffer must be brought up to date from restoreSource
+        LunoRect restoreRect;
+        const LunoColor *restoreSource;
+        void (*callback)(const LunoImage *frame, void *user);
+        void *user;
+    } _LunoPresent; // Swap chain of frames handed to the present thread.
+
+    typedef struct
+    {
+        bool enabled;
+        bool overlay;
+        bool paused;                     // Draws of the overlay itself are not counted
+        LunoFrameStats current;          // Frame being collected
+        LunoFrameStats last;             // Last finished frame
+        double frameEnd;                 // End of the previous Luno_Update
+        float window[LUNO_STATS_WINDOW]; // Recent frame times, the oldest is overwritten first
+        int windowCount, windowNext;
+    } _LunoStats;
+
+#define LUNO_WHEEL_LEVELS 5                          // Levels of the timer wheel: 64^5 ms, about 12 days ahead
+#define LUNO_WHEEL_PENDING (LUNO_WHEEL_LEVELS * 64) // List of the timers being dispatched
+
+    typedef struct
+    {
+        long long expires; // Milliseconds since Luno_Create
+        int interval;      // Repeat interval in milliseconds, 0 for one-shot timers
+        void (*callback)(int timer, void *user);
+        void *user;
+        int list;       // Wheel slot (level * 64 + slot) or LUNO_WHEEL_PENDING the timer is linked into, -1 if free
+        int prev, next; // Neighbours in the list (next also chains free timers), -1 ends
+        int generation; // Incremented whenever the timer is freed, so stale handles miss
+    } _LunoWheelTimer;
+
+    typedef struct
+    {
+        bool initialized;
+        long long now; // Millisecond the wheel has advanced to
+        _LunoWheelTimer *timers;
+        int count, capacity; // Timers ever allocated / room in `timers`
+        int freeList;
+        int heads[LUNO_WHEEL_PENDING + 1];
+        uint64_t occupied[LUNO_WHEEL_LEVELS]; // One bit per slot holding timers
+        int *expired; // Handles of the callback-less timers that expired in the last advance
+        int expiredCount, expiredCapacity;
+    } _LunoWheel; // Hierarchical timing wheel behind Luno_StartTimer.
+
+    typedef struct _LunoArenaBlock
+    {
+        struct _LunoArenaBlock *next;
+        size_t size; // Bytes available for images
+        size_t used;
+    } _LunoArenaBlock; // Block of an image arena, the images follow the header at the next LUNO_ALIGNMENT boundary.
+
+    struct LunoImageArena
+    {
+        _LunoArenaBlock *blocks; // The block being filled first, then full and oversized ones
+        size_t blockSize;
+    };
+
+    typedef struct
+    {
+        const unsigned char *data;
+        size_t size;
+        bool mapped;
+    } _LunoFileView; // Whole file: a mapping of it where the file allows one, a heap copy otherwise.
+
+    // A .lunopak bundle is a little-endian file: the header, the entries sorted by name, the names, then every
+    // payload at a LUNO_ALIGNMENT boundary so it can be used in place from the mapping.
+#define LUNO_PAK_MAGIC "LUNOPAK"
+#define LUNO_PAK_VERSION 2
+#define LUNO_PAK_PREMULTIPLIED 1 // Header flag: the pixels were premultiplied by a LUNO_PREMULTIPLIED packer
+
+    typedef struct
+    {
+        char magic[8];      // LUNO_PAK_MAGIC
+        uint32_t version;   // LUNO_PAK_VERSION
+        uint32_t flags;     // LUNO_PAK_PREMULTIPLIED
+        uint32_t count;     // Entries following the header
+        uint32_t entrySize; // sizeof(_LunoPakEntry), catches layout changes
+        uint64_t fileSize;  // Catches truncated files
+        uint64_t reserved[4];
+    } _LunoPakHeader;
+
+    typedef struct
+    {
+        uint32_t nameOffset; // Zero-terminated path with '/' separators
+        uint32_t width, height;
+        uint32_t alphaClass;
+        uint64_t pixelOffset; // width * height pixels in LUNO_FORMAT_NATIVE
+        uint64_t fontOffset;  // _LunoPakFont of the image, 0 if it was not packed as a font
+    } _LunoPakEntry;
+
+    typedef struct
+    {
+        uint32_t columns, rows; // glyphWidth and glyphHeight of Luno_LoadFont the glyphs were built for
+        uint32_t maskBits;
+        uint32_t maskSize; // Bytes of coverage masks following the record
+        LunoGlyph glyphs[256];
+    } _LunoPakFont;
+
+    struct LunoPak
+    {
+        _LunoFileView file;
+        const _LunoPakEntry *entries;
+        int count;
+        LunoImage *images;    // Parents of the views handed out, their pixels point into the mapping
+        struct LunoPak *next; // Bundle mounted before this one
+    };
+
+    typedef enum
+    {
+        _LUNO_LOAD_QUEUED = 0, // In the queue heap
+        _LUNO_LOAD_RUNNING,    // Taken by a thread
+        _LUNO_LOAD_FINISHED,   // Result stored, in the finished list until it is dispatched
+    } _LunoLoadStage;
+
+    typedef struct
+    {
+        LunoLoadState state; // LUNO_LOAD_NONE while the slot is free
+        _LunoLoadStage stage;
+        bool cancelled;  // Released while running, freed when it is dispatched
+        int generation;  // Incremented whenever the slot is freed, so stale handles miss
+        int priority;
+        unsigned sequence; // Request order among equal priorities
+        int heapIndex;     // Position in the queue heap while queued
+        char *path;        // Own copy, NULL for loads from memory
+        const unsigned char *buffer;
+        int bufferLen;
+        int glyphWidth, glyphHeight; // Font loads only, 0 for images
+        LunoImage *image;
+        LunoFont *font;
+        const char *error; // Static message of a failed load
+        void (*callback)(int load, void *user);
+        void *user;
+        int next; // Next finished load, or next free slot; -1 ends
+    } _LunoLoad;
+
+    typedef struct
+    {
+        bool initialized;
+        _LunoMutex mutex; // Guards the queue, the finished list, the stages and the mounted bundle list
+        _LunoCond wake;   // A load was queued or the threads should quit
+        _LunoCond done;   // A load finished
+        _LunoThread threads[LUNO_LOAD_THREADS];
+        int running; // Threads started
+        bool quit;
+        _LunoLoad *loads;
+        int count, capacity; // Slots ever allocated / room in `loads`
+        int freeList;
+        int *heap; // Queued slots, a binary max-heap on priority, then earliest request
+        int heapCount;
+        unsigned sequence;
+        int finishedHead, finishedTail; // Loads finished by a thread and not dispatched yet, in finishing order
+        int *dispatched; // Handles of the callback-less loads dispatched in the last Luno_Update
+        int dispatchedCount, dispatchedCapacity;
+    } _LunoLoader; // Background threads behind Luno_LoadImageAsync and Luno_LoadFontAsync.
+
     // --- Global Variables ---
     static _LunoContext _lunoContext = {0};
+    static _LunoPool _lunoPool = {0};
+    static _LunoPresent _lunoPresent = {0};
+    static _LunoStats _lunoStats = {0};
+    static _LunoWheel _lunoWheel = {0};
+    static _LunoLoader _lunoLoader = {0};
 
     // --- Private Helpers ---
 
-    static double _Luno_Now(void)
+    static inline int _Luno_Min(int a, int b)
     {
-        return clock() / 1000.0;
+        return a < b ? a : b;
     }
 
-    static inline LunoColor _Luno_BlendPixel(LunoColor dst, LunoColor src)
+    static inline int _Luno_Max(int a, int b)
     {
-        LunoColor res;
-        res.r = dst.r + (((src.r - dst.r) * src.a) >> 8);
-        res.g = dst.g + (((src.g - dst.g) * src.a) >> 8);
-        res.b = dst.b + (((src.b - dst.b) * src.a) >> 8);
-        res.a = dst.a; // Preserve destination alpha
-        return res;
+        return a > b ? a : b;
     }
 
-    static LunoRect _Luno_GetAdjustedWindowRect(_LunoContext *ctx)
+    // Rounds a size up to a multiple of LUNO_ALIGNMENT.
+    static inline size_t _Luno_AlignSize(size_t size)
     {
-        // work out maximum size to retain aspect ratio
-        float src_ar = (float)ctx->backbuffer.height / ctx->backbuffer.width;
-        float dst_ar = (float)ctx->windowHeight / ctx->windowWidth;
-        int w, h;
-        if (src_ar < dst_ar)
-        {
-            w = ctx->windowWidth;
-            h = ceil(w * src_ar);
-        }
-        else
-        {
-            h = ctx->windowHeight;
-            w = ceil(h / src_ar);
-        }
-        // return centered rect
-        return (LunoRect){(ctx->windowWidth - w) / 2, (ctx->windowHeight - h) / 2, w, h};
+        return (size + LUNO_ALIGNMENT - 1) & ~(size_t)(LUNO_ALIGNMENT - 1);
     }
 
-    LRESULT CALLBACK _LunoWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+    // Allocates `size` bytes aligned to LUNO_ALIGNMENT through LUNO_MALLOC. The pointer LUNO_MALLOC returned is kept
+    // right before the block for _Luno_AlignedFree.
+    static void *_Luno_AlignedAlloc(size_t size)
     {
-        switch (message)
-        {
-        case WM_PAINT:
-        {
-            BITMAPINFO bmi = {0};
-            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-            bmi.bmiHeader.biWidth = _lunoContext.backbuffer.width;
-            bmi.bmiHeader.biHeight = -_lunoContext.backbuffer.height; // Negative for top-down orientation
-            bmi.bmiHeader.biPlanes = 1;
-            bmi.bmiHeader.biBitCount = 32;
-            bmi.bmiHeader.biCompression = BI_RGB;
+        unsigned char *raw = (unsigned char *)LUNO_MALLOC(size + LUNO_ALIGNMENT + sizeof(void *));
+        if (!raw)
+            return NULL;
+        void **block = (void **)(((uintptr_t)raw + sizeof(void *) + LUNO_ALIGNMENT - 1) & ~(uintptr_t)(LUNO_ALIGNMENT - 1));
+        block[-1] = raw;
+        return block;
+    }
 
-            LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
+    static void _Luno_AlignedFree(void *block)
+    {
+        if (block)
+            LUNO_FREE(((void **)block)[-1]);
+    }
 
-            StretchDIBits(_lunoContext.hdc,
-                          wr.x, wr.y, wr.w, wr.h,
-                          0, 0, _lunoContext.backbuffer.width, _lunoContext.backbuffer.height,
-                          _lunoContext.backbuffer.pixels, &bmi, DIB_RGB_COLORS, SRCCOPY);
+    // Reads an open file to its end into a buffer released with LUNO_FREE, for pipes and other unmappable inputs.
+#ifdef _WIN32
+    static unsigned char *_Luno_ReadAll(HANDLE file, size_t *size)
+#else
+    static unsigned char *_Luno_ReadAll(int file, size_t *size)
+#endif
+    {
+        size_t capacity = 65536;
+        size_t used = 0;
+        unsigned char *data = (unsigned char *)LUNO_MALLOC(capacity);
+        while (data)
+        {
+            if (used == capacity)
+            {
+                unsigned char *grown = (unsigned char *)LUNO_REALLOC(data, capacity * 2);
+                if (!grown)
+                    break;
+                data = grown;
+                capacity *= 2;
+            }
 
-            ValidateRect(_lunoContext.hwnd, 0);
-            break;
-        }
-        case WM_KEYDOWN:
-        case WM_SYSKEYDOWN:
-            if (lParam & (1 << 30))
-            { // key repeat
+#ifdef _WIN32
+            DWORD chunk = 0;
+            DWORD request = (DWORD)((capacity - used < (1u << 30)) ? capacity - used : (1u << 30));
+            if (!ReadFile(file, data + used, request, &chunk, NULL) && GetLastError() != ERROR_BROKEN_PIPE)
+                break;
+#else
+            ssize_t chunk = read(file, data + used, capacity - used);
+            if (chunk < 0 && errno == EINTR)
+                continue;
+            if (chunk < 0)
                 break;
+#endif
+            if (chunk == 0)
+            {
+                *size = used;
+                return data;
             }
-            _lunoContext.keys[wParam] = true;
-            break;
+            used += (size_t)chunk;
+        }
 
-        case WM_KEYUP:
-        case WM_SYSKEYUP:
-            _lunoContext.keys[wParam] = false;
-            break;
-        case WM_LBUTTONDOWN:
-        case WM_LBUTTONUP:
-        case WM_RBUTTONDOWN:
-        case WM_RBUTTONUP:
-        case WM_MBUTTONDOWN:
-        case WM_MBUTTONUP:
+        fprintf(stderr, "Failed to read file\n");
+        LUNO_FREE(data);
+        return NULL;
+    }
+
+    // Maps a file read-only, or copy-on-write if `writable` is set, falling back to reading it when it cannot be
+    // mapped (pipes, devices, empty files). Returns false with a message on stderr on failure.
+    static bool _Luno_OpenFileView(const char *path, _LunoFileView *view, bool writable)
+    {
+        memset(view, 0, sizeof(_LunoFileView));
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
         {
-            int button = (message == WM_LBUTTONDOWN || message == WM_LBUTTONUP) ? 0 : (message == WM_RBUTTONDOWN || message == WM_RBUTTONUP) ? 1
-                                                                                                                                             : 2;
+            fprintf(stderr, "Failed to open file: %s\n", path);
+            return false;
+        }
 
-            if (message == WM_LBUTTONDOWN || message == WM_RBUTTONDOWN || message == WM_MBUTTONDOWN)
+        LARGE_INTEGER fileSize;
+        if (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 &&
+            (unsigned long long)fileSize.QuadPart <= (SIZE_MAX >> 1))
+        {
+            // The view keeps the mapping object alive, so its handle can go right away
+            HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+            if (mapping)
             {
-                SetCapture(hwnd);
-                _lunoContext.mouseButtons[button] = true;
+                view->data = (const unsigned char *)MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
             }
-            else
+            if (view->data)
             {
-                ReleaseCapture();
-                _lunoContext.mouseButtons[button] = false;
+                view->size = (size_t)fileSize.QuadPart;
+                view->mapped = true;
+                CloseHandle(file);
+                return true;
             }
-            break;
         }
-        case WM_MOUSEMOVE:
+
+        view->data = _Luno_ReadAll(file, &view->size);
+        CloseHandle(file);
+#else
+        int file = open(path, O_RDONLY);
+        if (file < 0)
+        {
+            fprintf(stderr, "Failed to open file: %s\n", path);
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+            void *data = mmap(NULL, (size_t)info.st_size, protection, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                view->data = (const unsigned char *)data;
+                view->size = (size_t)info.st_size;
+                view->mapped = true;
+                close(file);
+                return true;
+            }
+        }
+
+        view->data = _Luno_ReadAll(file, &view->size);
+        close(file);
+#endif
+        return view->data != NULL;
+    }
+
+    static void _Luno_CloseFileView(_LunoFileView *view)
+    {
+        if (view->mapped)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(view->data);
+#else
+            munmap((void *)view->data, view->size);
+#endif
+        }
+        else
+        {
+            LUNO_FREE((void *)view->data);
+        }
+        memset(view, 0, sizeof(_LunoFileView));
+    }
+
+    // Monotonic clock in nanoseconds: QueryPerformanceCounter on Windows, CLOCK_MONOTONIC elsewhere.
+    static long long _Luno_ClockNs(void)
+    {
+#ifdef _WIN32
+        static LARGE_INTEGER frequency;
+        LARGE_INTEGER counter;
+        if (frequency.QuadPart == 0)
+            QueryPerformanceFrequency(&frequency);
+        QueryPerformanceCounter(&counter);
+        // Whole seconds and remainder apart, counter * 1e9 would overflow after a few days of uptime
+        long long seconds = counter.QuadPart / frequency.QuadPart;
+        long long rest = counter.QuadPart % frequency.QuadPart;
+        return seconds * 1000000000LL + rest * 1000000000LL / frequency.QuadPart;
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+    }
+
+    // Monotonic time in seconds since its first call, used for measurements. Counting from the first call keeps
+    // the double well below a nanosecond of rounding.
+    static double _Luno_PerfNow(void)
+    {
+        static long long origin;
+        if (origin == 0)
+            origin = _Luno_ClockNs();
+        return (_Luno_ClockNs() - origin) * 1e-9;
+    }
+
+#ifndef LUNO_HEADLESS
+    static double _Luno_Now(void)
+    {
+        return _Luno_PerfNow();
+    }
+#else
+    static double _Luno_Now(void)
+    {
+        if (_lunoContext.timeSource)
+            return _lunoContext.timeSource();
+        return _lunoContext.virtualTime;
+    }
+#endif
+
+    // x / 255 rounded to nearest, exact for 0 <= x <= 255 * 255.
+    static inline int _Luno_Div255(int x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+#ifndef LUNO_PREMULTIPLIED
+    // dst + (src - dst) * a / 256, with alpha 255 weighted 256 so that it replaces the destination color.
+    static inline LunoColor _Luno_BlendPixel(LunoColor dst, LunoColor src)
+    {
+        int a = src.a + (src.a == 255);
+        LunoColor res;
+        res.r = dst.r + (((src.r - dst.r) * a) >> 8);
+        res.g = dst.g + (((src.g - dst.g) * a) >> 8);
+        res.b = dst.b + (((src.b - dst.b) * a) >> 8);
+        res.a = dst.a; // Preserve destination alpha
+        return res;
+    }
+#else
+    // Source-over for premultiplied pixels: src + dst * (255 - a) / 255 on all four channels.
+    // Alpha 255 replaces the destination and alpha 0 leaves it untouched.
+    static inline LunoColor _Luno_BlendPixel(LunoColor dst, LunoColor src)
+    {
+        int inv = 255 - src.a;
+        LunoColor res;
+        res.r = (unsigned char)_Luno_Min(src.r + _Luno_Div255(dst.r * inv), 255);
+        res.g = (unsigned char)_Luno_Min(src.g + _Luno_Div255(dst.g * inv), 255);
+        res.b = (unsigned char)_Luno_Min(src.b + _Luno_Div255(dst.b * inv), 255);
+        res.a = (unsigned char)_Luno_Min(src.a + _Luno_Div255(dst.a * inv), 255);
+        return res;
+    }
+#endif
+
+    // Converts an API color (RGBA) to the pixel layout stored in images (BGRA, premultiplied with LUNO_PREMULTIPLIED).
+    // This is the only place colors change format: drawing code converts once per call, never per pixel.
+    static inline LunoColor _Luno_ToPixel(LunoColor color)
+    {
+#ifdef LUNO_PREMULTIPLIED
+        return (LunoColor){_Luno_Div255(color.b * color.a), _Luno_Div255(color.g * color.a), _Luno_Div255(color.r * color.a), color.a};
+#else
+        return (LunoColor){color.b, color.g, color.r, color.a};
+#endif
+    }
+
+    // Inverse of _Luno_ToPixel.
+    static inline LunoColor _Luno_FromPixel(LunoColor pixel)
+    {
+#ifdef LUNO_PREMULTIPLIED
+        if (pixel.a == 0)
+            return (LunoColor){0, 0, 0, 0};
+        int half = pixel.a / 2;
+        return (LunoColor){_Luno_Min((pixel.b * 255 + half) / pixel.a, 255), _Luno_Min((pixel.g * 255 + half) / pixel.a, 255),
+                           _Luno_Min((pixel.r * 255 + half) / pixel.a, 255), pixel.a};
+#else
+        return (LunoColor){pixel.b, pixel.g, pixel.r, pixel.a};
+#endif
+    }
+
+    static inline void _Luno_PremultiplyPixels(LunoColor *pixels, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            LunoColor *p = &pixels[i];
+            p->r = _Luno_Div255(p->r * p->a);
+            p->g = _Luno_Div255(p->g * p->a);
+            p->b = _Luno_Div255(p->b * p->a);
+        }
+    }
+
+    // --- Pixel Format Conversion ---
+
+    static inline int _Luno_FormatBytes(LunoPixelFormat format)
+    {
+        return (format == LUNO_FORMAT_BGR24 || format == LUNO_FORMAT_RGB24) ? 3 : 4;
+    }
+
+    static inline bool _Luno_FormatIsRedFirst(LunoPixelFormat format)
+    {
+        return format == LUNO_FORMAT_RGBA32 || format == LUNO_FORMAT_RGB24;
+    }
+
+    // Swaps the first and third byte of each 32-bit pixel (RGBA <-> BGRA).
+    static void _Luno_SwapRB32(uint32_t *dst, const uint32_t *src, int count)
+    {
+        int i = 0;
+#ifdef LUNO_AVX2
+        __m256i ga8 = _mm256_set1_epi32((int)0xFF00FF00);
+        __m256i low8 = _mm256_set1_epi32(0xFF);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(v, 16), low8), _mm256_slli_epi32(_mm256_and_si256(v, low8), 16));
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(_mm256_and_si256(v, ga8), r));
+        }
+#endif
+#ifdef LUNO_SSE2
+        __m128i ga = _mm_set1_epi32((int)0xFF00FF00);
+        __m128i low = _mm_set1_epi32(0xFF);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i r = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), low), _mm_slli_epi32(_mm_and_si128(v, low), 16));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(v, ga), r));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            uint32_t v = src[i];
+            dst[i] = (v & 0xFF00FF00u) | ((v >> 16) & 0xFFu) | ((v & 0xFFu) << 16);
+        }
+    }
+
+    // Expands 24-bit pixels to 32 bits with alpha 255, optionally swapping the first and third byte.
+    static void _Luno_Expand24To32(unsigned char *dst, const unsigned char *src, int count, bool swap)
+    {
+        int i = 0;
+#ifdef LUNO_SSSE3
+        // 4 pixels per step; 16 bytes are loaded for 12 used, so stop 2 pixels early.
+        __m128i shuffle = swap ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+                               : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        for (; i + 6 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 3));
+            _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+        }
+#elif defined(LUNO_SSE2)
+        // Without a byte shuffle, pixel k is moved into lane k by shifting the register left by k bytes, and the
+        // four shifted copies are merged with lane masks. Same 2 pixel early stop as above.
+        __m128i lane0 = _mm_setr_epi32(0xFFFFFF, 0, 0, 0);
+        __m128i lane1 = _mm_setr_epi32(0, 0xFFFFFF, 0, 0);
+        __m128i lane2 = _mm_setr_epi32(0, 0, 0xFFFFFF, 0);
+        __m128i lane3 = _mm_setr_epi32(0, 0, 0, 0xFFFFFF);
+        __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+        __m128i ga = _mm_set1_epi32((int)0xFF00FF00);
+        __m128i low = _mm_set1_epi32(0xFF);
+        for (; i + 6 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 3));
+            __m128i p = _mm_or_si128(_mm_and_si128(v, lane0), _mm_and_si128(_mm_slli_si128(v, 1), lane1));
+            p = _mm_or_si128(p, _mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 2), lane2), _mm_and_si128(_mm_slli_si128(v, 3), lane3)));
+            if (swap)
+                p = _mm_or_si128(_mm_and_si128(p, ga), _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_slli_epi32(_mm_and_si128(p, low), 16)));
+            _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(p, alpha));
+        }
+#endif
+        int first = swap ? 2 : 0;
+        for (; i < count; i++)
+        {
+            dst[i * 4 + 0] = src[i * 3 + first];
+            dst[i * 4 + 1] = src[i * 3 + 1];
+            dst[i * 4 + 2] = src[i * 3 + 2 - first];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    static inline uint32_t _Luno_PackPixel(LunoColor color)
+    {
+        uint32_t value;
+        memcpy(&value, &color, sizeof(value));
+        return value;
+    }
+
+    // Writes `pixel` into `count` consecutive pixels starting at `dst`. `stream` bypasses the cache, for fills
+    // too large for it (including bands of such a fill split across threads).
+    static void _Luno_FillPixelRange(LunoColor *dst, size_t count, LunoColor pixel, bool stream)
+    {
+        if (pixel.r == pixel.g && pixel.g == pixel.b && pixel.b == pixel.a)
+        {
+            memset(dst, pixel.r, count * sizeof(LunoColor)); // All four bytes match
+            return;
+        }
+
+        uint32_t value = _Luno_PackPixel(pixel);
+        uint32_t *out = (uint32_t *)dst;
+
+#if defined(LUNO_AVX2)
+        while (count > 0 && ((uintptr_t)out & 31) != 0)
+        {
+            *out++ = value;
+            count--;
+        }
+
+        __m256i wide = _mm256_set1_epi32((int)value);
+        size_t blocks = count / 32;
+        if (stream)
+        {
+            for (size_t i = 0; i < blocks; i++, out += 32)
+            {
+                _mm256_stream_si256((__m256i *)out + 0, wide);
+                _mm256_stream_si256((__m256i *)out + 1, wide);
+                _mm256_stream_si256((__m256i *)out + 2, wide);
+                _mm256_stream_si256((__m256i *)out + 3, wide);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for (size_t i = 0; i < blocks; i++, out += 32)
+            {
+                _mm256_store_si256((__m256i *)out + 0, wide);
+                _mm256_store_si256((__m256i *)out + 1, wide);
+                _mm256_store_si256((__m256i *)out + 2, wide);
+                _mm256_store_si256((__m256i *)out + 3, wide);
+            }
+        }
+        count -= blocks * 32;
+#elif defined(LUNO_SSE2)
+        while (count > 0 && ((uintptr_t)out & 15) != 0)
+        {
+            *out++ = value;
+            count--;
+        }
+
+        __m128i wide = _mm_set1_epi32((int)value);
+        size_t blocks = count / 16;
+        if (stream)
+        {
+            for (size_t i = 0; i < blocks; i++, out += 16)
+            {
+                _mm_stream_si128((__m128i *)out + 0, wide);
+                _mm_stream_si128((__m128i *)out + 1, wide);
+                _mm_stream_si128((__m128i *)out + 2, wide);
+                _mm_stream_si128((__m128i *)out + 3, wide);
+            }
+            _mm_sfence();
+        }
+        else
+        {
+            for (size_t i = 0; i < blocks; i++, out += 16)
+            {
+                _mm_store_si128((__m128i *)out + 0, wide);
+                _mm_store_si128((__m128i *)out + 1, wide);
+                _mm_store_si128((__m128i *)out + 2, wide);
+                _mm_store_si128((__m128i *)out + 3, wide);
+            }
+        }
+        count -= blocks * 16;
+#endif
+
+        for (size_t i = 0; i < count; i++)
+        {
+            out[i] = value;
+        }
+#if !defined(LUNO_AVX2) && !defined(LUNO_SSE2)
+        (void)stream;
+#endif
+    }
+
+    static void _Luno_FillPixels(LunoColor *dst, size_t count, LunoColor pixel)
+    {
+        _Luno_FillPixelRange(dst, count, pixel, count * sizeof(LunoColor) >= LUNO_STREAM_THRESHOLD);
+    }
+
+#if defined(LUNO_SSE2) && !defined(LUNO_PREMULTIPLIED)
+    // Blends 4 source pixels over 4 destination pixels, bit-identical to _Luno_BlendPixel.
+    // (s - d) * a >> 8 does not fit in 16 bits, so it is evaluated as (s * a >> 8) - (d * a >> 8)
+    // minus a borrow when the low byte of s * a is smaller than the low byte of d * a. Alpha 255 is raised to 256,
+    // s * 256 still fits.
+    static inline __m128i _Luno_BlendHalfSSE2(__m128i d, __m128i s)
+    {
+        __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm_sub_epi16(a, _mm_cmpeq_epi16(a, _mm_set1_epi16(255)));
+        __m128i sa = _mm_mullo_epi16(s, a);
+        __m128i da = _mm_mullo_epi16(d, a);
+        __m128i lowMask = _mm_set1_epi16(0xFF);
+        __m128i borrow = _mm_cmplt_epi16(_mm_and_si128(sa, lowMask), _mm_and_si128(da, lowMask));
+        __m128i res = _mm_sub_epi16(_mm_add_epi16(d, _mm_srli_epi16(sa, 8)), _mm_srli_epi16(da, 8));
+        return _mm_add_epi16(res, borrow);
+    }
+
+    static inline __m128i _Luno_BlendSSE2(__m128i dst, __m128i src)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = _Luno_BlendHalfSSE2(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(src, zero));
+        __m128i hi = _Luno_BlendHalfSSE2(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(src, zero));
+        __m128i res = _mm_packus_epi16(lo, hi);
+        __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+        return _mm_or_si128(_mm_andnot_si128(alphaMask, res), _mm_and_si128(alphaMask, dst)); // Preserve destination alpha
+    }
+#elif defined(LUNO_SSE2)
+    // Premultiplied source-over for 4 pixels, bit-identical to _Luno_BlendPixel.
+    static inline __m128i _Luno_BlendHalfSSE2(__m128i d, __m128i inv)
+    {
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(d, inv), _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8); // Exact x / 255
+    }
+
+    static inline __m128i _Luno_BlendSSE2(__m128i dst, __m128i src)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i a = _mm_srli_epi32(src, 24);
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 8));
+        a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+        __m128i inv = _mm_xor_si128(a, _mm_set1_epi32(-1)); // 255 - a in every byte
+        __m128i lo = _Luno_BlendHalfSSE2(_mm_unpacklo_epi8(dst, zero), _mm_unpacklo_epi8(inv, zero));
+        __m128i hi = _Luno_BlendHalfSSE2(_mm_unpackhi_epi8(dst, zero), _mm_unpackhi_epi8(inv, zero));
+        return _mm_adds_epu8(src, _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+#if defined(LUNO_AVX2) && !defined(LUNO_PREMULTIPLIED)
+    // 8-pixel version of _Luno_BlendSSE2 (unpack and pack work per 128-bit lane, so pixel order is kept).
+    static inline __m256i _Luno_BlendHalfAVX2(__m256i d, __m256i s)
+    {
+        __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        a = _mm256_sub_epi16(a, _mm256_cmpeq_epi16(a, _mm256_set1_epi16(255)));
+        __m256i sa = _mm256_mullo_epi16(s, a);
+        __m256i da = _mm256_mullo_epi16(d, a);
+        __m256i lowMask = _mm256_set1_epi16(0xFF);
+        __m256i borrow = _mm256_cmpgt_epi16(_mm256_and_si256(da, lowMask), _mm256_and_si256(sa, lowMask));
+        __m256i res = _mm256_sub_epi16(_mm256_add_epi16(d, _mm256_srli_epi16(sa, 8)), _mm256_srli_epi16(da, 8));
+        return _mm256_add_epi16(res, borrow);
+    }
+
+    static inline __m256i _Luno_BlendAVX2(__m256i dst, __m256i src)
+    {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i lo = _Luno_BlendHalfAVX2(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(src, zero));
+        __m256i hi = _Luno_BlendHalfAVX2(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(src, zero));
+        __m256i res = _mm256_packus_epi16(lo, hi);
+        __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000);
+        return _mm256_blendv_epi8(res, dst, alphaMask); // Preserve destination alpha
+    }
+#elif defined(LUNO_AVX2)
+    // 8-pixel version of the premultiplied _Luno_BlendSSE2.
+    static inline __m256i _Luno_BlendHalfAVX2(__m256i d, __m256i inv)
+    {
+        __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d, inv), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    }
+
+    static inline __m256i _Luno_BlendAVX2(__m256i dst, __m256i src)
+    {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i a = _mm256_srli_epi32(src, 24);
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 8));
+        a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+        __m256i inv = _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+        __m256i lo = _Luno_BlendHalfAVX2(_mm256_unpacklo_epi8(dst, zero), _mm256_unpacklo_epi8(inv, zero));
+        __m256i hi = _Luno_BlendHalfAVX2(_mm256_unpackhi_epi8(dst, zero), _mm256_unpackhi_epi8(inv, zero));
+        return _mm256_adds_epu8(src, _mm256_packus_epi16(lo, hi));
+    }
+#endif
+
+    // Copies the source pixels with alpha 255 and skips the others (for binary alpha images).
+    static void _Luno_MaskedCopyRow(LunoColor *dst, const LunoColor *src, int count)
+    {
+        int i = 0;
+#ifdef LUNO_AVX2
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+            __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i mask = _mm256_srai_epi32(s, 31); // Alpha is either 0 or 255, so its top bit decides
+            _mm256_storeu_si256((__m256i *)(dst + i), _mm256_blendv_epi8(d, s, mask));
+        }
+#endif
+#ifdef LUNO_SSE2
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i mask = _mm_srai_epi32(s, 31);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(mask, s), _mm_andnot_si128(mask, d)));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            if (src[i].a)
+                dst[i] = src[i];
+        }
+    }
+
+    // Pixels from one row of an image to the next.
+    static inline int _Luno_Pitch(const LunoImage *image)
+    {
+        return image->pitch ? image->pitch : image->width;
+    }
+
+    // Scans the alpha channel and returns the cheapest class that draws `pixels` correctly.
+    static LunoAlphaClass _Luno_ClassifyAlpha(const LunoColor *pixels, size_t count)
+    {
+        bool opaque = true;
+        size_t i = 0;
+#ifdef LUNO_SSE2
+        __m128i ones = _mm_set1_epi32(-1);
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(pixels + i));
+            int full = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ones)) & 0x8888; // Alpha bytes only
+            int empty = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0x8888;
+            if ((full | empty) != 0x8888)
+                return LUNO_ALPHA_TRANSLUCENT;
+            if (full != 0x8888)
+                opaque = false;
+        }
+#endif
+        for (; i < count; i++)
+        {
+            unsigned char a = pixels[i].a;
+            if (a != 0 && a != 255)
+                return LUNO_ALPHA_TRANSLUCENT;
+            if (a != 255)
+                opaque = false;
+        }
+        return opaque ? LUNO_ALPHA_OPAQUE : LUNO_ALPHA_BINARY;
+    }
+
+    // Classifies the pixels of an image row by row, so views only look at their own part of the parent.
+    static LunoAlphaClass _Luno_ClassifyImage(const LunoImage *image)
+    {
+        int pitch = _Luno_Pitch(image);
+        if (pitch == image->width)
+            return _Luno_ClassifyAlpha(image->pixels, (size_t)image->width * image->height);
+
+        LunoAlphaClass alphaClass = LUNO_ALPHA_OPAQUE;
+        for (int y = 0; y < image->height && alphaClass != LUNO_ALPHA_TRANSLUCENT; y++)
+        {
+            LunoAlphaClass row = _Luno_ClassifyAlpha(image->pixels + (size_t)y * pitch, image->width);
+            if (row < alphaClass)
+                alphaClass = row;
+        }
+        return alphaClass;
+    }
+
+    // Blends `count` source pixels over `count` destination pixels (16, 8 or 4 at a time where available).
+    static void _Luno_BlendRow(LunoColor *dst, const LunoColor *src, int count)
+    {
+        int i = 0;
+#ifdef LUNO_AVX2
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256i d0 = _mm256_loadu_si256((const __m256i *)(dst + i));
+            __m256i d1 = _mm256_loadu_si256((const __m256i *)(dst + i + 8));
+            __m256i s0 = _mm256_loadu_si256((const __m256i *)(src + i));
+            __m256i s1 = _mm256_loadu_si256((const __m256i *)(src + i + 8));
+            _mm256_storeu_si256((__m256i *)(dst + i), _Luno_BlendAVX2(d0, s0));
+            _mm256_storeu_si256((__m256i *)(dst + i + 8), _Luno_BlendAVX2(d1, s1));
+        }
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+            __m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+            _mm256_storeu_si256((__m256i *)(dst + i), _Luno_BlendAVX2(d, s));
+        }
+#endif
+#ifdef LUNO_SSE2
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(dst + i), _Luno_BlendSSE2(d, s));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = _Luno_BlendPixel(dst[i], src[i]);
+        }
+    }
+
+    // Blends the constant pixel `src` over `count` consecutive pixels starting at `dst`.
+    static void _Luno_BlendSpan(LunoColor *dst, int count, LunoColor src)
+    {
+        int i = 0;
+#ifdef LUNO_AVX2
+        __m256i wide8 = _mm256_set1_epi32((int)_Luno_PackPixel(src));
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+            _mm256_storeu_si256((__m256i *)(dst + i), _Luno_BlendAVX2(d, wide8));
+        }
+#endif
+#ifdef LUNO_SSE2
+        __m128i wide = _mm_set1_epi32((int)_Luno_PackPixel(src));
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+            _mm_storeu_si128((__m128i *)(dst + i), _Luno_BlendSSE2(d, wide));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = _Luno_BlendPixel(dst[i], src);
+        }
+    }
+
+    // Draws a horizontal span of `count` pixels: opaque colors are stored, translucent ones blended.
+    static inline void _Luno_DrawSpan(LunoColor *dst, int count, LunoColor pixel)
+    {
+        if (pixel.a == 255)
+            _Luno_FillPixels(dst, count, pixel);
+        else if (pixel.a > 0)
+            _Luno_BlendSpan(dst, count, pixel);
+    }
+
+    // Intersects `rect` with `clip`. Returns false if nothing is left.
+    static inline bool _Luno_IntersectRect(LunoRect *rect, LunoRect clip)
+    {
+        int x0 = _Luno_Max(rect->x, clip.x);
+        int y0 = _Luno_Max(rect->y, clip.y);
+        int x1 = _Luno_Min(rect->x + rect->w, clip.x + clip.w);
+        int y1 = _Luno_Min(rect->y + rect->h, clip.y + clip.h);
+        if (x0 >= x1 || y0 >= y1)
+            return false;
+
+        *rect = (LunoRect){x0, y0, x1 - x0, y1 - y0};
+        return true;
+    }
+
+    // Clips `rect` against a width x height target. Returns false if nothing is left.
+    static inline bool _Luno_ClipRect(LunoRect *rect, int width, int height)
+    {
+        return _Luno_IntersectRect(rect, (LunoRect){0, 0, width, height});
+    }
+
+    // Draws line[x0, x1) clipped to [left, right) and returns the pixels drawn. The bounds are 64-bit so huge radii
+    // cannot overflow them.
+    static inline int _Luno_DrawClippedSpan(LunoColor *line, long long x0, long long x1, int left, int right, LunoColor pixel)
+    {
+        if (x0 < left)
+            x0 = left;
+        if (x1 > right)
+            x1 = right;
+        if (x0 >= x1)
+            return 0;
+        _Luno_DrawSpan(line + x0, (int)(x1 - x0), pixel);
+        return (int)(x1 - x0);
+    }
+
+    // Draws the rows cy - r and cy + r (r = 0..rows - 1) from cx - outer[r] to cx - inner[r] and
+    // from cx + inner[r] to cx + outer[r], clipped to `clip`. An inner value of 0 draws the whole row
+    // as one span, so each covered pixel is written exactly once. The arrays start at row `first`:
+    // outer[0] is row first, and every row inside `clip` must be at least `first`. Returns the pixels drawn.
+    static long long _Luno_DrawSymmetricSpans(LunoImage *dst, LunoRect clip, int cx, int cy, const int *outer, const int *inner, int first, int rows, LunoColor pixel)
+    {
+        int rFirst = _Luno_Max(-(rows - 1), clip.y - cy);
+        int rLast = _Luno_Min(rows - 1, clip.y + clip.h - 1 - cy);
+        int left = clip.x;
+        int right = clip.x + clip.w;
+        long long drawn = 0;
+
+        for (int r = rFirst; r <= rLast; r++)
+        {
+            int row = abs(r) - first;
+            long long o = outer[row];
+            long long i = inner ? inner[row] : 0;
+            LunoColor *line = &dst->pixels[(cy + r) * _Luno_Pitch(dst)];
+
+            if (i <= 0)
+            {
+                drawn += _Luno_DrawClippedSpan(line, cx - o, cx + o + 1, left, right, pixel);
+                continue;
+            }
+
+            drawn += _Luno_DrawClippedSpan(line, cx - o, cx - i + 1, left, right, pixel);
+            drawn += _Luno_DrawClippedSpan(line, cx + i, cx + o + 1, left, right, pixel);
+        }
+        return drawn;
+    }
+
+    // Smallest rectangle containing both `a` and `b`.
+    static inline LunoRect _Luno_UnionRect(LunoRect a, LunoRect b)
+    {
+        int x0 = _Luno_Min(a.x, b.x);
+        int y0 = _Luno_Min(a.y, b.y);
+        int x1 = _Luno_Max(a.x + a.w, b.x + b.w);
+        int y1 = _Luno_Max(a.y + a.h, b.y + b.h);
+        return (LunoRect){x0, y0, x1 - x0, y1 - y0};
+    }
+
+    // Adds `rect` to the backbuffer damage. Rectangles whose union costs no extra pixels (containment, overlap,
+    // adjacent spans of a row of glyphs) are merged; a full list grows the entry that costs the fewest extra pixels.
+    // Damage covering half the backbuffer turns into a full present, which is cheaper than many small copies.
+    static void _Luno_MarkDirty(LunoRect rect)
+    {
+        LunoImage *bb = &_lunoContext.backbuffer;
+        if (_lunoContext.dirtyFull || !_Luno_ClipRect(&rect, bb->width, bb->height))
+            return;
+
+        for (int i = 0; i < _lunoContext.dirtyCount;)
+        {
+            LunoRect other = _lunoContext.dirtyRects[i];
+            LunoRect merged = _Luno_UnionRect(other, rect);
+            if (merged.w * merged.h > other.w * other.h + rect.w * rect.h)
+            {
+                i++;
+                continue;
+            }
+            if (merged.w * merged.h == other.w * other.h)
+                return; // Already covered
+
+            // The merged rect may now touch others, so start over
+            rect = merged;
+            _lunoContext.dirtyRects[i] = _lunoContext.dirtyRects[--_lunoContext.dirtyCount];
+            i = 0;
+        }
+
+        if (_lunoContext.dirtyCount == LUNO_MAX_DIRTY_RECTS)
+        {
+            int best = 0;
+            int bestCost = INT_MAX;
+            for (int i = 0; i < _lunoContext.dirtyCount; i++)
+            {
+                LunoRect merged = _Luno_UnionRect(_lunoContext.dirtyRects[i], rect);
+                int cost = merged.w * merged.h - _lunoContext.dirtyRects[i].w * _lunoContext.dirtyRects[i].h;
+                if (cost < bestCost)
+                {
+                    best = i;
+                    bestCost = cost;
+                }
+            }
+            rect = _Luno_UnionRect(_lunoContext.dirtyRects[best], rect);
+            _lunoContext.dirtyRects[best] = _lunoContext.dirtyRects[--_lunoContext.dirtyCount];
+        }
+        _lunoContext.dirtyRects[_lunoContext.dirtyCount++] = rect;
+
+        long long area = 0;
+        for (int i = 0; i < _lunoContext.dirtyCount; i++)
+            area += (long long)_lunoContext.dirtyRects[i].w * _lunoContext.dirtyRects[i].h;
+        if (area * 2 >= (long long)bb->width * bb->height)
+            _lunoContext.dirtyFull = true;
+    }
+
+    // Marks the whole backbuffer as changed.
+    static inline void _Luno_MarkAllDirty(void)
+    {
+        _lunoContext.dirtyFull = true;
+        _lunoContext.dirtyCount = 0;
+    }
+
+    // Blends one already converted pixel into `dst` if it lies inside `clip`. Returns 1 if it did, 0 otherwise.
+    static inline int _Luno_PlotPixel(LunoImage *dst, LunoRect clip, int x, int y, LunoColor pixel)
+    {
+        if (x < clip.x || y < clip.y || x >= clip.x + clip.w || y >= clip.y + clip.h)
+            return 0;
+
+        LunoColor *out = &dst->pixels[x + y * _Luno_Pitch(dst)];
+        *out = _Luno_BlendPixel(*out, pixel);
+        return 1;
+    }
+
+    // Scales `pixel` by a coverage value: straight colors scale their alpha, premultiplied ones every channel.
+    static inline LunoColor _Luno_ApplyCoverage(LunoColor pixel, int coverage)
+    {
+#ifdef LUNO_PREMULTIPLIED
+        return (LunoColor){_Luno_Div255(pixel.r * coverage), _Luno_Div255(pixel.g * coverage),
+                           _Luno_Div255(pixel.b * coverage), _Luno_Div255(pixel.a * coverage)};
+#else
+        pixel.a = _Luno_Div255(pixel.a * coverage);
+        return pixel;
+#endif
+    }
+
+    // Writes `pixel` scaled by each coverage byte of `mask` into `dst` (4 pixels at a time where available).
+    static void _Luno_ExpandCoverage(LunoColor *dst, const unsigned char *mask, int count, LunoColor pixel)
+    {
+        int i = 0;
+#ifdef LUNO_SSE2
+        __m128i zero = _mm_setzero_si128();
+        __m128i wide = _mm_set1_epi32((int)_Luno_PackPixel(pixel));
+        __m128i color = _mm_unpacklo_epi8(wide, zero);
+        __m128i bias = _mm_set1_epi16(128);
+#ifndef LUNO_PREMULTIPLIED
+        __m128i keep = _mm_and_si128(wide, _mm_set1_epi32(0x00FFFFFF)); // Only alpha is scaled
+        __m128i alphaMask = _mm_set1_epi32((int)0xFF000000);
+#endif
+        for (; i + 4 <= count; i += 4)
+        {
+            int bytes;
+            memcpy(&bytes, mask + i, sizeof(bytes));
+            __m128i cov = _mm_cvtsi32_si128(bytes);
+            cov = _mm_unpacklo_epi8(cov, cov);
+            cov = _mm_unpacklo_epi16(cov, cov); // Each coverage byte repeated over its pixel
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(cov, zero), color), bias);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(cov, zero), color), bias);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8); // Exact x / 255
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            __m128i scaled = _mm_packus_epi16(lo, hi);
+#ifndef LUNO_PREMULTIPLIED
+            scaled = _mm_or_si128(_mm_and_si128(scaled, alphaMask), keep);
+#endif
+            _mm_storeu_si128((__m128i *)(dst + i), scaled);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = _Luno_ApplyCoverage(pixel, mask[i]);
+        }
+    }
+
+    // Blends `pixel` over `count` pixels, weighted by one coverage byte per pixel.
+    static void _Luno_BlendMaskRow(LunoColor *dst, const unsigned char *mask, int count, LunoColor pixel)
+    {
+        LunoColor src[64];
+        for (int start = 0; start < count; start += 64)
+        {
+            int n = _Luno_Min(count - start, 64);
+            _Luno_ExpandCoverage(src, mask + start, n, pixel);
+            _Luno_BlendRow(dst + start, src, n);
+        }
+    }
+
+    // Draws `pixel` where bits first .. first + count - 1 of a 1bpp mask row are set. Each mask byte
+    // (or nibble) selects 8 (or 4) pixels at once; opaque colors are stored, translucent ones blended.
+    static void _Luno_DrawMaskBits(LunoColor *dst, const unsigned char *bits, int first, int count, LunoColor pixel)
+    {
+        bool opaque = pixel.a == 255;
+        int i = 0;
+#ifdef LUNO_AVX2
+        if ((first & 7) == 0)
+        {
+            __m256i wide8 = _mm256_set1_epi32((int)_Luno_PackPixel(pixel));
+            __m256i select8 = _mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+            for (; i + 8 <= count; i += 8)
+            {
+                int byte = bits[(first + i) >> 3];
+                if (byte == 0)
+                    continue;
+                __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), select8), select8);
+                __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+                __m256i s = opaque ? wide8 : _Luno_BlendAVX2(d, wide8);
+                _mm256_storeu_si256((__m256i *)(dst + i), _mm256_blendv_epi8(d, s, mask));
+            }
+        }
+#endif
+#ifdef LUNO_SSE2
+        if ((first & 3) == 0)
+        {
+            __m128i wide = _mm_set1_epi32((int)_Luno_PackPixel(pixel));
+            __m128i select = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+            for (; i + 4 <= count; i += 4)
+            {
+                int bit = first + i;
+                int nibble = (bits[bit >> 3] << (bit & 7)) & 0xF0;
+                if (nibble == 0)
+                    continue;
+                __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(nibble), select), select);
+                __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+                __m128i s = opaque ? wide : _Luno_BlendSSE2(d, wide);
+                _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(mask, s), _mm_andnot_si128(mask, d)));
+            }
+        }
+#endif
+        for (; i < count; i++)
+        {
+            int bit = first + i;
+            if (!((bits[bit >> 3] << (bit & 7)) & 0x80))
+                continue;
+            dst[i] = opaque ? pixel : _Luno_BlendPixel(dst[i], pixel);
+        }
+    }
+
+#ifndef LUNO_HEADLESS
+    static LunoRect _Luno_GetAdjustedWindowRect(_LunoContext *ctx)
+    {
+        // work out maximum size to retain aspect ratio
+        float src_ar = (float)ctx->backbuffer.height / ctx->backbuffer.width;
+        float dst_ar = (float)ctx->windowHeight / ctx->windowWidth;
+        int w, h;
+        if (src_ar < dst_ar)
+        {
+            w = ctx->windowWidth;
+            h = ceil(w * src_ar);
+        }
+        else
+        {
+            h = ctx->windowHeight;
+            w = ceil(h / src_ar);
+        }
+        // return centered rect
+        return (LunoRect){(ctx->windowWidth - w) / 2, (ctx->windowHeight - h) / 2, w, h};
+    }
+
+    // Maps a backbuffer region to window coordinates. Only used with integral window scales.
+    static LunoRect _Luno_WindowRegion(LunoRect rect, LunoRect wr)
+    {
+        int scaleX = wr.w / _lunoContext.backbuffer.width;
+        int scaleY = wr.h / _lunoContext.backbuffer.height;
+        return (LunoRect){wr.x + rect.x * scaleX, wr.y + rect.y * scaleY, rect.w * scaleX, rect.h * scaleY};
+    }
+
+    // Sub-rectangles only line up with a full stretch at integral scales.
+    static bool _Luno_IsIntegralScale(LunoRect wr)
+    {
+        return wr.w >= _lunoContext.backbuffer.width && wr.h >= _lunoContext.backbuffer.height &&
+               wr.w % _lunoContext.backbuffer.width == 0 && wr.h % _lunoContext.backbuffer.height == 0;
+    }
+
+    // Copies the region `src` of a frame to the window region `dst`.
+    static void _Luno_PaintRegion(HDC hdc, const LunoImage *frame, LunoRect src, LunoRect dst)
+    {
+        // The bitmap starts at the first source row, so the source rectangle is always top-aligned
+        BITMAPINFO bmi = {0};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = _Luno_Pitch(frame);
+        bmi.bmiHeader.biHeight = -src.h; // Negative for top-down orientation
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        StretchDIBits(hdc,
+                      dst.x, dst.y, dst.w, dst.h,
+                      src.x, 0, src.w, src.h,
+                      &frame->pixels[src.y * _Luno_Pitch(frame)], &bmi, DIB_RGB_COLORS, SRCCOPY);
+    }
+
+    LRESULT CALLBACK _LunoWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        switch (message)
+        {
+        case WM_PAINT:
+        {
+            if (_lunoPresent.count > 1)
+            {
+                // The present thread paints, it repaints the whole window with its next frame
+                InterlockedExchange(&_lunoPresent.repaint, 1);
+                ValidateRect(hwnd, 0);
+                break;
+            }
+
+            LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
+            LunoRect full = {0, 0, _lunoContext.backbuffer.width, _lunoContext.backbuffer.height};
+
+            // Anything the system invalidated (first show, uncovering) outside our own regions needs a full present
+            RECT update;
+            if (!_lunoContext.presentFull && GetUpdateRect(hwnd, &update, FALSE))
+            {
+                LunoRect bounds = {0, 0, 0, 0};
+                for (int i = 0; i < _lunoContext.presentCount; i++)
+                {
+                    LunoRect dst = _Luno_WindowRegion(_lunoContext.presentRects[i], wr);
+                    bounds = (i == 0) ? dst : _Luno_UnionRect(bounds, dst);
+                }
+                if (update.left < bounds.x || update.top < bounds.y ||
+                    update.right > bounds.x + bounds.w || update.bottom > bounds.y + bounds.h)
+                {
+                    _lunoContext.presentFull = true;
+                }
+            }
+
+            if (_lunoContext.presentFull)
+            {
+                _Luno_PaintRegion(_lunoContext.hdc, &_lunoContext.backbuffer, full, wr);
+            }
+            else
+            {
+                for (int i = 0; i < _lunoContext.presentCount; i++)
+                {
+                    _Luno_PaintRegion(_lunoContext.hdc, &_lunoContext.backbuffer, _lunoContext.presentRects[i],
+                                      _Luno_WindowRegion(_lunoContext.presentRects[i], wr));
+                }
+            }
+            _lunoContext.presentCount = 0;
+            _lunoContext.presentFull = false;
+
+            ValidateRect(_lunoContext.hwnd, 0);
+            break;
+        }
+        case WM_KEYDOWN:
+        case WM_SYSKEYDOWN:
+            if (lParam & (1 << 30))
+            { // key repeat
+                break;
+            }
+            _lunoContext.keys[wParam] = true;
+            break;
+
+        case WM_KEYUP:
+        case WM_SYSKEYUP:
+            _lunoContext.keys[wParam] = false;
+            break;
+        case WM_LBUTTONDOWN:
+        case WM_LBUTTONUP:
+        case WM_RBUTTONDOWN:
+        case WM_RBUTTONUP:
+        case WM_MBUTTONDOWN:
+        case WM_MBUTTONUP:
+        {
+            int button = (message == WM_LBUTTONDOWN || message == WM_LBUTTONUP) ? 0 : (message == WM_RBUTTONDOWN || message == WM_RBUTTONUP) ? 1
+                                                                                                                                             : 2;
+
+            if (message == WM_LBUTTONDOWN || message == WM_RBUTTONDOWN || message == WM_MBUTTONDOWN)
+            {
+                SetCapture(hwnd);
+                _lunoContext.mouseButtons[button] = true;
+            }
+            else
+            {
+                ReleaseCapture();
+                _lunoContext.mouseButtons[button] = false;
+            }
+            break;
+        }
+        case WM_MOUSEMOVE:
+        {
+            LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
+            int prevx = _lunoContext.mousePos.x;
+            int prevy = _lunoContext.mousePos.y;
+
+            // Calculate the unclamped mouse position
+            int unclampedX = (GET_X_LPARAM(lParam) - wr.x) * _lunoContext.backbuffer.width / wr.w;
+            int unclampedY = (GET_Y_LPARAM(lParam) - wr.y) * _lunoContext.backbuffer.height / wr.h;
+
+            // Clamp the mouse position to the backbuffer dimensions
+            _lunoContext.mousePos.x = max(0, min(unclampedX, _lunoContext.backbuffer.width - 1));
+            _lunoContext.mousePos.y = max(0, min(unclampedY, _lunoContext.backbuffer.height - 1));
+
+            // Calculate the delta
+            _lunoContext.mouseDelta.x += _lunoContext.mousePos.x - prevx;
+            _lunoContext.mouseDelta.y += _lunoContext.mousePos.y - prevy;
+
+            break;
+        }
+
+        case WM_MOUSEWHEEL:
+        {
+            _lunoContext.mouseWheelDelta += GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
+            break;
+        }
+
+        case WM_SETCURSOR:
+            if (_lunoContext.isCursorHidden && LOWORD(lParam) == HTCLIENT)
+            {
+                SetCursor(0);
+                break;
+            }
+            goto unhandled;
+        case WM_SIZE:
+        {
+            if (wParam != SIZE_MINIMIZED)
+            {
+                // Update window dimensions
+                _lunoContext.windowWidth = LOWORD(lParam);
+                _lunoContext.windowHeight = HIWORD(lParam);
+                _lunoContext.presentFull = true; // The image moved and was rescaled
+                InterlockedExchange(&_lunoPresent.repaint, 1);
+
+                // Clear the window
+                RECT clientRect;
+                GetClientRect(hwnd, &clientRect);
+                HBRUSH brush = CreateSolidBrush(RGB(_lunoContext.clearColor.r, _lunoContext.clearColor.g, _lunoContext.clearColor.b));
+                FillRect(_lunoContext.hdc, &clientRect, brush);
+                DeleteObject(brush);
+
+                // Redraw the window with the updated size
+                RedrawWindow(hwnd, NULL, NULL, RDW_INVALIDATE | RDW_UPDATENOW);
+            }
+            break;
+        }
+
+        case WM_CLOSE:
+        case WM_QUIT:
+            PostQuitMessage(0);
+            break;
+        default:
+        unhandled:
+            return DefWindowProc(hwnd, message, wParam, lParam);
+        }
+        return 0;
+    }
+
+    // --- Platform: Win32 ---
+
+    static bool _Luno_PlatformCreate(const char *title, int width, int height)
+    {
+        WNDCLASSA wc = {0};
+        wc.lpfnWndProc = _LunoWindowProc;
+        wc.hInstance = GetModuleHandle(NULL);
+        wc.lpszClassName = title;
+
+        if (!RegisterClassA(&wc))
+        {
+            return false;
+        }
+
+        _lunoContext.hwnd = CreateWindowA(
+            title,
+            title,
+            WS_OVERLAPPEDWINDOW | WS_VISIBLE,
+            CW_USEDEFAULT, CW_USEDEFAULT, width, height,
+            NULL, NULL, GetModuleHandle(NULL), NULL);
+
+        if (!_lunoContext.hwnd)
+        {
+            return false;
+        }
+
+        _lunoContext.hdc = GetDC(_lunoContext.hwnd);
+
+        // Sleep() granularity follows the system timer, which defaults to 15.6 ms
+        timeBeginPeriod(1);
+        _lunoContext.sleepEstimate = 0.005;
+        _lunoContext.sleepSamples = 0;
+        return true;
+    }
+
+    static void _Luno_PlatformClose(void)
+    {
+        if (_lunoContext.hdc)
+        {
+            ReleaseDC(_lunoContext.hwnd, _lunoContext.hdc);
+            _lunoContext.hdc = NULL;
+        }
+        if (_lunoContext.hwnd)
+        {
+            DestroyWindow(_lunoContext.hwnd);
+            _lunoContext.hwnd = NULL;
+        }
+        timeEndPeriod(1);
+        UnregisterClassA(_lunoContext.title, GetModuleHandle(NULL));
+    }
+
+    static void _Luno_PlatformSetWindowSize(int width, int height)
+    {
+        SetWindowPos(
+            _lunoContext.hwnd,
+            NULL,
+            0, 0,
+            width,
+            height,
+            SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+    }
+
+    static void _Luno_PlatformSetCursorVisibility(bool visible)
+    {
+        if (visible)
+        {
+            SetCursor(LoadCursor(NULL, IDC_ARROW)); // Restore default cursor
+        }
+        else
+        {
+            SetCursor(NULL); // Hide the cursor
+        }
+
+        // Force cursor re-evaluation for the client area
+        if (_lunoContext.hwnd)
+        {
+            PostMessage(_lunoContext.hwnd, WM_SETCURSOR, 0, HTCLIENT);
+        }
+    }
+
+    static void _Luno_PlatformPresent(void)
+    {
+        LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
+        if (_lunoContext.dirtyFull || !_Luno_IsIntegralScale(wr) ||
+            _lunoContext.presentCount + _lunoContext.dirtyCount > LUNO_MAX_DIRTY_RECTS)
+        {
+            _lunoContext.presentFull = true;
+            InvalidateRect(_lunoContext.hwnd, NULL, FALSE);
+            return;
+        }
+
+        // Regions not painted yet (e.g. while minimized) stay queued until the next WM_PAINT
+        for (int i = 0; i < _lunoContext.dirtyCount; i++)
+        {
+            LunoRect dst = _Luno_WindowRegion(_lunoContext.dirtyRects[i], wr);
+            RECT rc = {dst.x, dst.y, dst.x + dst.w, dst.y + dst.h};
+            _lunoContext.presentRects[_lunoContext.presentCount++] = _lunoContext.dirtyRects[i];
+            InvalidateRect(_lunoContext.hwnd, &rc, FALSE);
+        }
+    }
+
+    // Paints a queued frame from the present thread. It draws directly through its own DC instead of WM_PAINT,
+    // which is dispatched on the thread that owns the window.
+    static void _Luno_PlatformPresentFrame(const _LunoFrame *frame)
+    {
+        HDC hdc = GetDC(_lunoContext.hwnd);
+        if (!hdc)
+            return;
+
+        LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
+        bool repaint = InterlockedExchange(&_lunoPresent.repaint, 0) != 0;
+        if (frame->dirtyFull || repaint || !_Luno_IsIntegralScale(wr))
+        {
+            _Luno_PaintRegion(hdc, &frame->image, (LunoRect){0, 0, frame->image.width, frame->image.height}, wr);
+        }
+        else
+        {
+            for (int i = 0; i < frame->dirtyCount; i++)
+            {
+                _Luno_PaintRegion(hdc, &frame->image, frame->dirtyRects[i], _Luno_WindowRegion(frame->dirtyRects[i], wr));
+            }
+        }
+        ReleaseDC(_lunoContext.hwnd, hdc);
+    }
+
+    // Adds how long a Sleep(1) took to its running mean and variance and bounds the next one by mean + standard
+    // deviation. Past the first 64 samples older ones fade out, so the bound follows changes in system load.
+    static void _Luno_TrackSleep(double seconds)
+    {
+        if (_lunoContext.sleepSamples < 64)
+            _lunoContext.sleepSamples++;
+        double weight = 1.0 / _lunoContext.sleepSamples;
+        double delta = seconds - _lunoContext.sleepMean;
+        _lunoContext.sleepMean += weight * delta;
+        _lunoContext.sleepVariance = (1 - weight) * (_lunoContext.sleepVariance + weight * delta * delta);
+        _lunoContext.sleepEstimate = _lunoContext.sleepMean + sqrt(_lunoContext.sleepVariance);
+    }
+
+    static void _Luno_PlatformSleepUntil(double deadline)
+    {
+        // Sleep in 1 ms steps while a step surely ends before the deadline, then spin the last stretch
+        double now = _Luno_Now();
+        while (deadline - now > _lunoContext.sleepEstimate)
+        {
+            Sleep(1);
+            double after = _Luno_Now();
+            _Luno_TrackSleep(after - now);
+            now = after;
+        }
+        while (_Luno_Now() < deadline)
+            YieldProcessor();
+    }
+
+    static bool _Luno_PlatformPumpMessages(void)
+    {
+        MSG msg;
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            if (msg.message == WM_QUIT)
+            {
+                return false;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        return true;
+    }
+#else
+    // --- Platform: Headless ---
+    // No window is created; the backbuffer lives in memory only and is read back with Luno_ReadFrame.
+    // Time comes from the installed time source (or a virtual clock) and input from the Luno_Inject* calls.
+
+    static bool _Luno_PlatformCreate(const char *title, int width, int height)
+    {
+        (void)title;
+        (void)width;
+        (void)height;
+        _lunoContext.virtualTime = 0;
+        _lunoContext.quitRequested = false;
+        return true;
+    }
+
+    static void _Luno_PlatformClose(void)
+    {
+    }
+
+    static void _Luno_PlatformSetWindowSize(int width, int height)
+    {
+        (void)width;
+        (void)height;
+    }
+
+    static void _Luno_PlatformSetCursorVisibility(bool visible)
+    {
+        (void)visible;
+    }
+
+    static void _Luno_PlatformPresent(void)
+    {
+    }
+
+    static void _Luno_PlatformPresentFrame(const _LunoFrame *frame)
+    {
+        (void)frame;
+    }
+
+    static void _Luno_PlatformSleepUntil(double deadline)
+    {
+        // Never block: with a real time source the frame simply runs early,
+        // the virtual clock jumps straight to the next frame.
+        if (!_lunoContext.timeSource)
+            _lunoContext.virtualTime = deadline;
+    }
+
+    static bool _Luno_PlatformPumpMessages(void)
+    {
+        if (_lunoContext.quitRequested)
+        {
+            _lunoContext.quitRequested = false;
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    // Blends `srcRect` of `src` onto `dst` at x, y. The source rect is clipped against the source image
+    // and the destination once up front, so the row loop only touches visible pixels. Returns the pixels of the
+    // clipped rect, transparent ones included.
+    static long long _Luno_BlitRect(LunoImage *dst, LunoRect clip, LunoImage *src, int x, int y, LunoRect srcRect)
+    {
+        // Clip the source rect to the source image, moving the destination along with it
+        LunoRect clipped = srcRect;
+        if (!_Luno_ClipRect(&clipped, src->width, src->height))
+            return 0;
+        x += clipped.x - srcRect.x;
+        y += clipped.y - srcRect.y;
+
+        // Intersect with the destination clip
+        LunoRect dstRect = {x, y, clipped.w, clipped.h};
+        if (!_Luno_IntersectRect(&dstRect, clip))
+            return 0;
+        int srcX = clipped.x + (dstRect.x - x);
+        int srcY = clipped.y + (dstRect.y - y);
+
+        int dstPitch = _Luno_Pitch(dst);
+        int srcPitch = _Luno_Pitch(src);
+        LunoColor *dstRow = &dst->pixels[dstRect.x + dstRect.y * dstPitch];
+        const LunoColor *srcRow = &src->pixels[srcX + srcY * srcPitch];
+        for (int j = 0; j < dstRect.h; j++, dstRow += dstPitch, srcRow += srcPitch)
+        {
+            switch (src->alphaClass)
+            {
+            case LUNO_ALPHA_OPAQUE:
+                memcpy(dstRow, srcRow, dstRect.w * sizeof(LunoColor));
+                break;
+            case LUNO_ALPHA_BINARY:
+                _Luno_MaskedCopyRow(dstRow, srcRow, dstRect.w);
+                break;
+            default:
+                _Luno_BlendRow(dstRow, srcRow, dstRect.w);
+                break;
+            }
+        }
+        return (long long)dstRect.w * dstRect.h;
+    }
+
+    // --- Threads ---
+    // Win32 threads (also for headless builds on Windows), pthreads elsewhere.
+
+#ifdef _WIN32
+    static bool _Luno_ThreadStart(_LunoThread *thread, _LunoThreadMain main, void *arg)
+    {
+        *thread = CreateThread(NULL, 0, main, arg, 0, NULL);
+        return *thread != NULL;
+    }
+
+    static void _Luno_ThreadJoin(_LunoThread thread)
+    {
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+
+    static void _Luno_MutexInit(_LunoMutex *mutex)
+    {
+        InitializeCriticalSection(mutex);
+    }
+
+    static void _Luno_MutexLock(_LunoMutex *mutex)
+    {
+        EnterCriticalSection(mutex);
+    }
+
+    static void _Luno_MutexUnlock(_LunoMutex *mutex)
+    {
+        LeaveCriticalSection(mutex);
+    }
+
+    static void _Luno_CondInit(_LunoCond *cond)
+    {
+        InitializeConditionVariable(cond);
+    }
+
+    static void _Luno_CondWait(_LunoCond *cond, _LunoMutex *mutex)
+    {
+        SleepConditionVariableCS(cond, mutex, INFINITE);
+    }
+
+    static void _Luno_CondBroadcast(_LunoCond *cond)
+    {
+        WakeAllConditionVariable(cond);
+    }
+
+    static long _Luno_AtomicLoad(volatile long *value)
+    {
+        return InterlockedCompareExchange(value, 0, 0);
+    }
+
+    // Replaces *value with `desired` if it still holds `expected`.
+    static bool _Luno_AtomicCompareExchange(volatile long *value, long expected, long desired)
+    {
+        return InterlockedCompareExchange(value, desired, expected) == expected;
+    }
+
+    // Adds `amount` to *value and returns the result.
+    static long _Luno_AtomicAdd(volatile long *value, long amount)
+    {
+        return InterlockedExchangeAdd(value, amount) + amount;
+    }
+
+    static int _Luno_CpuCount(void)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int)info.dwNumberOfProcessors;
+    }
+#else
+    static bool _Luno_ThreadStart(_LunoThread *thread, _LunoThreadMain main, void *arg)
+    {
+        return pthread_create(thread, NULL, main, arg) == 0;
+    }
+
+    static void _Luno_ThreadJoin(_LunoThread thread)
+    {
+        pthread_join(thread, NULL);
+    }
+
+    static void _Luno_MutexInit(_LunoMutex *mutex)
+    {
+        pthread_mutex_init(mutex, NULL);
+    }
+
+    static void _Luno_MutexLock(_LunoMutex *mutex)
+    {
+        pthread_mutex_lock(mutex);
+    }
+
+    static void _Luno_MutexUnlock(_LunoMutex *mutex)
+    {
+        pthread_mutex_unlock(mutex);
+    }
+
+    static void _Luno_CondInit(_LunoCond *cond)
+    {
+        pthread_cond_init(cond, NULL);
+    }
+
+    static void _Luno_CondWait(_LunoCond *cond, _LunoMutex *mutex)
+    {
+        pthread_cond_wait(cond, mutex);
+    }
+
+    static void _Luno_CondBroadcast(_LunoCond *cond)
+    {
+        pthread_cond_broadcast(cond);
+    }
+
+    // The atomics are sequentially consistent, like the Interlocked functions they stand in for
+    static long _Luno_AtomicLoad(volatile long *value)
+    {
+        return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+    }
+
+    // Replaces *value with `desired` if it still holds `expected`.
+    static bool _Luno_AtomicCompareExchange(volatile long *value, long expected, long desired)
+    {
+        return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    // Adds `amount` to *value and returns the result.
+    static long _Luno_AtomicAdd(volatile long *value, long amount)
+    {
+        return __atomic_add_fetch(value, amount, __ATOMIC_SEQ_CST);
+    }
+
+    static int _Luno_CpuCount(void)
+    {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        return count > 0 ? (int)count : 1;
+    }
+#endif
+
+    // Threads used for parallel work, including the calling thread.
+    static int _Luno_ThreadCount(void)
+    {
+        int count = _lunoPool.threadCount > 0 ? _lunoPool.threadCount : _Luno_CpuCount();
+        return _Luno_Max(1, _Luno_Min(count, LUNO_MAX_THREADS));
+    }
+
+    // Moves the back half of another thread's remaining indices into `slot`. Returns false once every slot is empty.
+    static bool _Luno_StealRange(int slot)
+    {
+        int slots = _lunoPool.running + 1;
+        for (int i = 1; i < slots; i++)
+        {
+            _LunoRange *victim = &_lunoPool.ranges[(slot + i) % slots];
+            _Luno_MutexLock(&victim->lock);
+            int end = victim->end;
+            int begin = end - (end - victim->next + 1) / 2;
+            if (begin < end)
+                victim->end = begin;
+            _Luno_MutexUnlock(&victim->lock);
+
+            if (begin < end)
+            {
+                _LunoRange *own = &_lunoPool.ranges[slot];
+                _Luno_MutexLock(&own->lock);
+                own->next = begin;
+                own->end = end;
+                _Luno_MutexUnlock(&own->lock);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs the indices of the current batch owned by `slot` front to back, then steals from the others.
+    static void _Luno_PoolDrain(int slot)
+    {
+        _LunoRange *own = &_lunoPool.ranges[slot];
+        for (;;)
+        {
+            _Luno_MutexLock(&own->lock);
+            int index = (own->next < own->end) ? own->next++ : -1;
+            _Luno_MutexUnlock(&own->lock);
+
+            if (index >= 0)
+                _lunoPool.job(_lunoPool.data, index);
+            else if (!_Luno_StealRange(slot))
+                break;
+        }
+    }
+
+    static void _Luno_WorkerLoop(int slot)
+    {
+        int seen = _lunoPool.ranges[slot].seen;
+        _Luno_MutexLock(&_lunoPool.mutex);
+        for (;;)
+        {
+            while (!_lunoPool.quit && _lunoPool.generation == seen)
+                _Luno_CondWait(&_lunoPool.wake, &_lunoPool.mutex);
+            if (_lunoPool.quit)
+                break;
+            seen = _lunoPool.generation;
+
+            _Luno_MutexUnlock(&_lunoPool.mutex);
+            _Luno_PoolDrain(slot);
+            _Luno_MutexLock(&_lunoPool.mutex);
+
+            if (--_lunoPool.busy == 0)
+                _Luno_CondBroadcast(&_lunoPool.done);
+        }
+        _Luno_MutexUnlock(&_lunoPool.mutex);
+    }
+
+    // Workers start between batches and receive their slot, which holds the current generation, so they never
+    // miss the next batch.
+#ifdef _WIN32
+    static DWORD WINAPI _Luno_WorkerMain(LPVOID arg)
+    {
+        _Luno_WorkerLoop((int)(intptr_t)arg);
+        return 0;
+    }
+#else
+    static void *_Luno_WorkerMain(void *arg)
+    {
+        _Luno_WorkerLoop((int)(intptr_t)arg);
+        return NULL;
+    }
+#endif
+
+    static void _Luno_PoolStop(void)
+    {
+        if (!_lunoPool.initialized || _lunoPool.running == 0)
+            return;
+
+        _Luno_MutexLock(&_lunoPool.mutex);
+        _lunoPool.quit = true;
+        _Luno_CondBroadcast(&_lunoPool.wake);
+        _Luno_MutexUnlock(&_lunoPool.mutex);
+
+        for (int i = 0; i < _lunoPool.running; i++)
+            _Luno_ThreadJoin(_lunoPool.threads[i]);
+        _lunoPool.running = 0;
+        _lunoPool.quit = false;
+    }
+
+    // Starts the worker threads (one less than the thread count, the caller is the last one).
+    static void _Luno_PoolStart(void)
+    {
+        if (!_lunoPool.initialized)
+        {
+            _Luno_MutexInit(&_lunoPool.mutex);
+            _Luno_CondInit(&_lunoPool.wake);
+            _Luno_CondInit(&_lunoPool.done);
+            for (int i = 0; i < LUNO_MAX_THREADS; i++)
+                _Luno_MutexInit(&_lunoPool.ranges[i].lock);
+            _lunoPool.initialized = true;
+        }
+
+        int workers = _Luno_ThreadCount() - 1;
+        while (_lunoPool.running < workers)
+        {
+            int slot = _lunoPool.running + 1;
+            _lunoPool.ranges[slot].seen = _lunoPool.generation;
+            if (!_Luno_ThreadStart(&_lunoPool.threads[_lunoPool.running], _Luno_WorkerMain, (void *)(intptr_t)slot))
+                break; // Run with the threads we got
+            _lunoPool.running++;
+        }
+    }
+
+    // Calls job(data, i) for i = 0..count - 1 on all threads and returns when every call finished.
+    // Every thread starts on its own contiguous share of the indices and steals half of another thread's
+    // remainder when it runs out, so neighbouring indices mostly stay on one thread while uneven jobs still balance.
+    static void _Luno_RunParallel(_LunoJob job, void *data, int count)
+    {
+        if (count <= 0)
+            return;
+
+        if (!_lunoPool.active && count > 1)
+            _Luno_PoolStart();
+        if (_lunoPool.active || _lunoPool.running == 0 || count == 1)
+        {
+            for (int i = 0; i < count; i++)
+                job(data, i);
+            return;
+        }
+
+        int slots = _lunoPool.running + 1;
+        for (int i = 0; i < slots; i++)
+        {
+            _lunoPool.ranges[i].next = (int)((long long)count * i / slots);
+            _lunoPool.ranges[i].end = (int)((long long)count * (i + 1) / slots);
+        }
+
+        _Luno_MutexLock(&_lunoPool.mutex);
+        _lunoPool.job = job;
+        _lunoPool.data = data;
+        _lunoPool.active = true;
+        _lunoPool.busy = _lunoPool.running;
+        _lunoPool.generation++;
+        _Luno_CondBroadcast(&_lunoPool.wake);
+        _Luno_MutexUnlock(&_lunoPool.mutex);
+
+        _Luno_PoolDrain(0);
+
+        _Luno_MutexLock(&_lunoPool.mutex);
+        while (_lunoPool.busy > 0)
+            _Luno_CondWait(&_lunoPool.done, &_lunoPool.mutex);
+        _lunoPool.active = false;
+        _Luno_MutexUnlock(&_lunoPool.mutex);
+    }
+
+    typedef struct
+    {
+        void (*fn)(void *data, int begin, int end);
+        void *data;
+        int count, grain;
+    } _LunoParallelFor;
+
+    static void _Luno_ParallelBand(void *data, int band)
+    {
+        const _LunoParallelFor *loop = (const _LunoParallelFor *)data;
+        int begin = band * loop->grain;
+        int end = (loop->count - begin > loop->grain) ? begin + loop->grain : loop->count;
+        loop->fn(loop->data, begin, end);
+    }
+
+    // Rows per band for row-wise work on images `width` pixels wide.
+    static int _Luno_RowGrain(int width)
+    {
+        return _Luno_Max(1, LUNO_PARALLEL_THRESHOLD / _Luno_Max(width, 1));
+    }
+
+    // --- Present Thread ---
+    // With 2 or 3 frame buffers Luno_Update queues the finished frame and goes on drawing into a free buffer while
+    // a dedicated thread presents it. Buffers change hands by compare-exchange on one atomic word holding the queued
+    // and the presenting buffer. The mutex and condition variables are only taken by a side that has to sleep and by
+    // a side that changed the state while the other one sleeps.
+
+    static int _Luno_QueuedFrame(long state)
+    {
+        return (int)(state & 0xFF) - 1;
+    }
+
+    static int _Luno_PresentingFrame(long state)
+    {
+        return (int)((state >> 8) & 0xFF) - 1;
+    }
+
+    static long _Luno_PresentState(int queued, int presenting)
+    {
+        return (long)((queued + 1) | ((presenting + 1) << 8));
+    }
+
+    // Sleeps on `cond` until the state is no longer `seen`. Returns false if the present thread is told to quit first.
+    static bool _Luno_PresentSleep(_LunoCond *cond, long seen)
+    {
+        _Luno_MutexLock(&_lunoPresent.mutex);
+        _Luno_AtomicAdd(&_lunoPresent.sleepers, 1);
+        bool changed;
+        while (!(changed = _Luno_AtomicLoad(&_lunoPresent.state) != seen) && !_lunoPresent.quit)
+            _Luno_CondWait(cond, &_lunoPresent.mutex);
+        _Luno_AtomicAdd(&_lunoPresent.sleepers, -1);
+        _Luno_MutexUnlock(&_lunoPresent.mutex);
+        return changed;
+    }
+
+    // Wakes the other side after a change of the state. A sleeper registers before it checks the state for the last
+    // time, so either it sees the change or this sees the sleeper.
+    static void _Luno_PresentSignal(_LunoCond *cond)
+    {
+        if (_Luno_AtomicLoad(&_lunoPresent.sleepers) == 0)
+            return;
+        _Luno_MutexLock(&_lunoPresent.mutex);
+        _Luno_CondBroadcast(cond);
+        _Luno_MutexUnlock(&_lunoPresent.mutex);
+    }
+
+    static void _Luno_PresentLoop(void)
+    {
+        for (;;)
+        {
+            long state = _Luno_AtomicLoad(&_lunoPresent.state);
+            int queued = _Luno_QueuedFrame(state);
+            if (queued < 0)
+            {
+                // Frames queued before a quit are still presented
+                if (!_Luno_PresentSleep(&_lunoPresent.wake, state))
+                    break;
+                continue;
+            }
+
+            // Nothing else changes the state while a frame is queued and none is presenting, so this cannot fail
+            _Luno_AtomicCompareExchange(&_lunoPresent.state, state, _Luno_PresentState(-1, queued));
+            _Luno_PresentSignal(&_lunoPresent.done);
+
+            _LunoFrame *frame = &_lunoPresent.frames[queued];
+            _Luno_PlatformPresentFrame(frame);
+            if (_lunoPresent.callback)
+                _lunoPresent.callback(&frame->image, _lunoPresent.user);
+
+            // The next frame may have been queued meanwhile
+            do
+                state = _Luno_AtomicLoad(&_lunoPresent.state);
+            while (!_Luno_AtomicCompareExchange(&_lunoPresent.state, state, _Luno_PresentState(_Luno_QueuedFrame(state), -1)));
+            _Luno_PresentSignal(&_lunoPresent.done);
+        }
+    }
+
+#ifdef _WIN32
+    static DWORD WINAPI _Luno_PresentMain(LPVOID arg)
+    {
+        (void)arg;
+        _Luno_PresentLoop();
+        return 0;
+    }
+#else
+    static void *_Luno_PresentMain(void *arg)
+    {
+        (void)arg;
+        _Luno_PresentLoop();
+        return NULL;
+    }
+#endif
+
+    static void _Luno_PresentStart(void)
+    {
+        if (_lunoPresent.running || _lunoPresent.count < 2)
+            return;
+        if (!_Luno_ThreadStart(&_lunoPresent.thread, _Luno_PresentMain, NULL))
+        {
+            printf("ERROR <Luno_SetFrameBuffering>: Failed to start the present thread!");
+            exit(0);
+        }
+        _lunoPresent.running = true;
+    }
+
+    // Stops the present thread once every queued frame was presented.
+    static void _Luno_PresentStop(void)
+    {
+        if (!_lunoPresent.running)
+            return;
+
+        _Luno_MutexLock(&_lunoPresent.mutex);
+        _lunoPresent.quit = true;
+        _Luno_CondBroadcast(&_lunoPresent.wake);
+        _Luno_MutexUnlock(&_lunoPresent.mutex);
+
+        _Luno_ThreadJoin(_lunoPresent.thread);
+        _lunoPresent.running = false;
+        _lunoPresent.quit = false;
+    }
+
+    static void _Luno_RestoreBand(void *data, int begin, int end)
+    {
+        (void)data;
+        LunoImage *backbuffer = &_lunoContext.backbuffer;
+        LunoRect r = _lunoPresent.restoreRect;
+        for (int y = r.y + begin; y < r.y + end; y++)
+        {
+            int offset = r.x + y * _Luno_Pitch(backbuffer);
+            memcpy(&backbuffer->pixels[offset], &_lunoPresent.restoreSource[offset], r.w * sizeof(LunoColor));
+        }
+    }
+
+    // Copies what later frames changed into the buffer being drawn, before the first draw call or readback touches
+    // it. A clear of the whole buffer makes the copy unnecessary and just cancels it.
+    static void _Luno_RestoreBackbuffer(void)
+    {
+        if (!_lunoPresent.restore)
+            return;
+        _lunoPresent.restore = false;
+        Luno_ParallelFor(_lunoPresent.restoreRect.h, _Luno_RowGrain(_lunoPresent.restoreRect.w), _Luno_RestoreBand, NULL);
+    }
+
+    // Hands the finished frame to the present thread and switches drawing to a free buffer.
+    static void _Luno_QueueFrame(void)
+    {
+        int current = _lunoPresent.current;
+        _LunoFrame *frame = &_lunoPresent.frames[current];
+        LunoRect full = {0, 0, _lunoContext.backbuffer.width, _lunoContext.backbuffer.height};
+
+        // The frame keeps its own copy of the changes, the context starts collecting the next frame's
+        memcpy(frame->dirtyRects, _lunoContext.dirtyRects, _lunoContext.dirtyCount * sizeof(LunoRect));
+        frame->dirtyCount = _lunoContext.dirtyCount;
+        frame->dirtyFull = _lunoContext.dirtyFull;
+
+        LunoRect changed = _lunoContext.dirtyFull ? full : (LunoRect){0, 0, 0, 0};
+        for (int i = 0; !_lunoContext.dirtyFull && i < _lunoContext.dirtyCount; i++)
+            changed = (i == 0) ? _lunoContext.dirtyRects[i] : _Luno_UnionRect(changed, _lunoContext.dirtyRects[i]);
+        for (int i = 0; i < _lunoPresent.count && changed.w > 0; i++)
+        {
+            if (i == current)
+                continue;
+            LunoRect *behind = &_lunoPresent.frames[i].behind;
+            *behind = (behind->w > 0) ? _Luno_UnionRect(*behind, changed) : changed;
+        }
+
+        // One frame can wait in the queue, frames are never dropped
+        long state = _Luno_AtomicLoad(&_lunoPresent.state);
+        for (;;)
+        {
+            if (_Luno_QueuedFrame(state) >= 0)
+                _Luno_PresentSleep(&_lunoPresent.done, state);
+            else if (_Luno_AtomicCompareExchange(&_lunoPresent.state, state, _Luno_PresentState(current, _Luno_PresentingFrame(state))))
+                break;
+            state = _Luno_AtomicLoad(&_lunoPresent.state);
+        }
+        _Luno_PresentSignal(&_lunoPresent.wake);
+
+        // Continue in a buffer that is neither queued nor being presented; with two buffers this waits for the
+        // present of the previous frame to finish
+        int next = -1;
+        for (;;)
+        {
+            state = _Luno_AtomicLoad(&_lunoPresent.state);
+            for (int i = 0; i < _lunoPresent.count && next < 0; i++)
+            {
+                if (i != current && i != _Luno_PresentingFrame(state))
+                    next = i;
+            }
+            if (next >= 0)
+                break;
+            _Luno_PresentSleep(&_lunoPresent.done, state);
+        }
+
+        _LunoFrame *target = &_lunoPresent.frames[next];
+        _lunoPresent.current = next;
+        _lunoContext.backbuffer.pixels = target->image.pixels;
+        if (target->behind.w > 0)
+        {
+            _lunoPresent.restore = true;
+            _lunoPresent.restoreRect = target->behind;
+            _lunoPresent.restoreSource = frame->image.pixels;
+            target->behind = (LunoRect){0, 0, 0, 0};
+        }
+    }
+
+    // --- Rasterizers ---
+    // Every primitive draws into `dst` restricted to `clip`, so a tile of the backbuffer can be rasterized
+    // on its own and produces exactly the pixels a full-frame draw would. Each returns the pixels it wrote
+    // inside `clip`, a pixel written twice (the corners of an outline) counting twice.
+
+    static long long _Luno_RasterLine(LunoImage *dst, LunoRect clip, int x1, int y1, int x2, int y2, LunoColor pixel)
+    {
+        int dx = abs(x2 - x1);
+        int dy = abs(y2 - y1);
+        int sx = x1 < x2 ? 1 : -1;
+        int sy = y1 < y2 ? 1 : -1;
+        int err = dx - dy;
+        long long drawn = 0;
+
+        while (true)
+        {
+            drawn += _Luno_PlotPixel(dst, clip, x1, y1, pixel);
+            if (x1 == x2 && y1 == y2)
+                break;
+            int e2 = 2 * err;
+            if (e2 > -dy)
+            {
+                err -= dy;
+                x1 += sx;
+            }
+            if (e2 < dx)
+            {
+                err += dx;
+                y1 += sy;
+            }
+        }
+        return drawn;
+    }
+
+    static long long _Luno_RasterRect(LunoImage *dst, LunoRect clip, LunoRect rect, LunoColor pixel, bool fill)
+    {
+        if (!fill)
+        {
+            long long drawn = 0;
+            drawn += _Luno_RasterLine(dst, clip, rect.x, rect.y, rect.x + rect.w - 1, rect.y, pixel);                           // Top border
+            drawn += _Luno_RasterLine(dst, clip, rect.x, rect.y + rect.h - 1, rect.x + rect.w - 1, rect.y + rect.h - 1, pixel); // Bottom border
+            drawn += _Luno_RasterLine(dst, clip, rect.x, rect.y, rect.x, rect.y + rect.h - 1, pixel);                           // Left border
+            drawn += _Luno_RasterLine(dst, clip, rect.x + rect.w - 1, rect.y, rect.x + rect.w - 1, rect.y + rect.h - 1, pixel); // Right border
+            return drawn;
+        }
+
+        if (!_Luno_IntersectRect(&rect, clip))
+            return 0;
+
+        int pitch = _Luno_Pitch(dst);
+        LunoColor *row = &dst->pixels[rect.x + rect.y * pitch];
+        if (pixel.a == 255 && rect.x == 0 && rect.w == pitch)
+        {
+            _Luno_FillPixels(row, (size_t)rect.w * rect.h, pixel); // Whole rows are one contiguous fill
+            return (long long)rect.w * rect.h;
+        }
+        for (int y = 0; y < rect.h; y++, row += pitch)
+        {
+            _Luno_DrawSpan(row, rect.w, pixel);
+        }
+        return (long long)rect.w * rect.h;
+    }
+
+    static long long _Luno_RasterCircle(LunoImage *dst, LunoRect clip, int x, int y, int radius, LunoColor pixel, bool fill)
+    {
+        if (fill)
+        {
+            if (radius < 0)
+                return 0;
+
+            int stackHalf[256];
+            int *half = (radius < 256) ? stackHalf : (int *)LUNO_MALLOC((radius + 1) * sizeof(int));
+            if (!half)
+                return 0;
+
+            // The midpoint octants cover |dx| <= px on rows |dy| <= py and |dx| <= py on rows |dy| <= px.
+            // Record the widest run ending on each row, a suffix max then gives each row's half width.
+            memset(half, 0, (radius + 1) * sizeof(int));
+            int px = 0;
+            int py = radius;
+            int d = 1 - radius;
+            while (px <= py)
+            {
+                half[py] = _Luno_Max(half[py], px);
+                half[px] = _Luno_Max(half[px], py);
+                if (d < 0)
+                {
+                    d += 2 * px + 3;
+                }
+                else
+                {
+                    d += 2 * (px - py) + 5;
+                    py--;
+                }
+                px++;
+            }
+            for (int r = radius - 1; r >= 0; r--)
+            {
+                half[r] = _Luno_Max(half[r], half[r + 1]);
+            }
+
+            long long drawn = _Luno_DrawSymmetricSpans(dst, clip, x, y, half, NULL, 0, radius + 1, pixel);
+
+            if (half != stackHalf)
+                LUNO_FREE(half);
+            return drawn;
+        }
+
+        int px = 0;
+        int py = radius;
+        int d = 1 - radius;
+        long long drawn = 0;
+
+        while (px <= py)
+        {
+            // Draw only border pixels
+            drawn += _Luno_PlotPixel(dst, clip, x + px, y + py, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x - px, y + py, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x + px, y - py, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x - px, y - py, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x + py, y + px, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x - py, y + px, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x + py, y - px, pixel);
+            drawn += _Luno_PlotPixel(dst, clip, x - py, y - px, pixel);
+
+            // Update the decision parameter and pixel positions
+            if (d < 0)
+            {
+                d += 2 * px + 3;
+            }
+            else
+            {
+                d += 2 * (px - py) + 5;
+                py--;
+            }
+            px++;
+        }
+        return drawn;
+    }
+
+    // Full 128-bit product of two 64-bit values, computed from 32-bit halves.
+    static void _Luno_MulWide(uint64_t a, uint64_t b, uint64_t *high, uint64_t *low)
+    {
+        uint64_t ll = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+        uint64_t hl = (a >> 32) * (b & 0xFFFFFFFF);
+        uint64_t lh = (a & 0xFFFFFFFF) * (b >> 32);
+        uint64_t carry = ((ll >> 32) + (hl & 0xFFFFFFFF) + (lh & 0xFFFFFFFF)) >> 32;
+        *high = (a >> 32) * (b >> 32) + (hl >> 32) + (lh >> 32) + carry;
+        *low = ll + (hl << 32) + (lh << 32);
+    }
+
+    // a * a <= b * c, exact for any 64-bit operands.
+    static bool _Luno_SquareAtMost(uint64_t a, uint64_t b, uint64_t c)
+    {
+        uint64_t squareHigh, squareLow, productHigh, productLow;
+        _Luno_MulWide(a, a, &squareHigh, &squareLow);
+        _Luno_MulWide(b, c, &productHigh, &productLow);
+        return squareHigh < productHigh || (squareHigh == productHigh && squareLow <= productLow);
+    }
+
+    static long long _Luno_RasterEllipse(LunoImage *dst, LunoRect clip, int x, int y, int radiusX, int radiusY, LunoColor pixel, bool fill)
+    {
+        if (radiusX < 0 || radiusY < 0)
+            return 0;
+
+        // Only rows inside `clip` are computed: first..last are their distances from the center row
+        int rFirst = _Luno_Max(-radiusY, clip.y - y);
+        int rLast = _Luno_Min(radiusY, clip.y + clip.h - 1 - y);
+        if (rFirst > rLast)
+            return 0;
+        int first = (rFirst > 0) ? rFirst : (rLast < 0) ? -rLast : 0;
+        int last = _Luno_Max(abs(rFirst), abs(rLast));
+        int count = _Luno_Min(last + 1, radiusY) - first + 1; // Outlines also need the row after `last`
+
+        int stackHalf[512];
+        int *half = (count <= 256) ? stackHalf : (int *)LUNO_MALLOC(2 * (size_t)count * sizeof(int));
+        if (!half)
+            return 0;
+        int *inner = half + count;
+
+        // Widest |dx| per row inside the ellipse with radii rx + 0.5 and ry + 0.5:
+        // (2dx)^2 (2ry+1)^2 + (2dy)^2 (2rx+1)^2 <= (2rx+1)^2 (2ry+1)^2, tested as (2dx ay)^2 <= ax^2 (ay^2 - (2dy)^2).
+        // Large radii need 128-bit products, so a double square root gives the estimate and exact comparisons fix it up.
+        uint64_t ax = 2ULL * radiusX + 1;
+        uint64_t ay = 2ULL * radiusY + 1;
+        uint64_t ax2 = ax * ax;
+        for (int k = 0; k < count; k++)
+        {
+            uint64_t r2 = 2ULL * (first + k);
+            uint64_t rest = ay * ay - r2 * r2;
+            long long h = (long long)(0.5 * (double)ax * sqrt((double)rest) / (double)ay);
+            h = (h < 0) ? 0 : (h > radiusX) ? radiusX : h;
+            while (h > 0 && !_Luno_SquareAtMost(2 * (uint64_t)h * ay, ax2, rest))
+                h--;
+            while (h < radiusX && _Luno_SquareAtMost(2 * (uint64_t)(h + 1) * ay, ax2, rest))
+                h++;
+            half[k] = (int)h;
+        }
+
+        // Outline rows cover the columns the next row outwards does not reach (at least one pixel per side)
+        for (int k = 0; k < count; k++)
+        {
+            int next = (k + 1 < count) ? half[k + 1] + 1 : 0;
+            inner[k] = fill ? 0 : _Luno_Min(next, half[k]);
+        }
+
+        long long drawn = _Luno_DrawSymmetricSpans(dst, clip, x, y, half, inner, first, radiusY + 1, pixel);
+
+        if (half != stackHalf)
+            LUNO_FREE(half);
+        return drawn;
+    }
+
+    // Pixels with nonzero coverage in columns first .. first + count - 1 of a mask row.
+    static int _Luno_CountCoverage(const unsigned char *mask, int maskBits, int first, int count)
+    {
+        int covered = 0;
+        for (int i = first; i < first + count; i++)
+            covered += (maskBits == 1) ? (mask[i >> 3] >> (7 - (i & 7))) & 1 : mask[i] != 0;
+        return covered;
+    }
+
+    static long long _Luno_RasterText(LunoImage *dst, LunoRect clip, LunoFont *font, const char *text, int x, int y, LunoColor pixel)
+    {
+        long long drawn = 0;
+        for (const char *p = text; *p; p++)
+        {
+            unsigned char c = *p;
+            LunoGlyph *glyph = &font->glyphs[c];
+
+            // Only the glyph's covered pixels are visited, clipped once per glyph
+            int left = x + glyph->bounds.x;
+            int top = y + glyph->bounds.y;
+            LunoRect area = {left, top, glyph->bounds.w, glyph->bounds.h};
+            if (_Luno_IntersectRect(&area, clip))
+            {
+                int maskX = area.x - left;
+                bool whole = area.w == glyph->bounds.w && area.h == glyph->bounds.h;
+                const unsigned char *mask = font->mask + glyph->maskOffset + (area.y - top) * glyph->maskPitch;
+                for (int j = 0; j < area.h; j++, mask += glyph->maskPitch)
+                {
+                    LunoColor *row = &dst->pixels[area.x + (area.y + j) * _Luno_Pitch(dst)];
+                    if (font->maskBits == 1)
+                        _Luno_DrawMaskBits(row, mask, maskX, area.w, pixel);
+                    else
+                        _Luno_BlendMaskRow(row, mask + maskX, area.w, pixel);
+                    if (!whole)
+                        drawn += _Luno_CountCoverage(mask, font->maskBits, maskX, area.w);
+                }
+                if (whole)
+                    drawn += glyph->covered;
+            }
+
+            x += glyph->xadv; // Advance the x position
+        }
+        return drawn;
+    }
+
+    // Union of the covered glyph pixels of the first `length` characters of `text` drawn at x, y.
+    static LunoRect _Luno_TextBounds(LunoFont *font, const char *text, size_t length, int x, int y)
+    {
+        LunoRect bounds = {0, 0, 0, 0};
+        for (size_t i = 0; i < length; i++)
+        {
+            LunoGlyph *glyph = &font->glyphs[(unsigned char)text[i]];
+            if (glyph->bounds.w > 0)
+            {
+                LunoRect area = {x + glyph->bounds.x, y + glyph->bounds.y, glyph->bounds.w, glyph->bounds.h};
+                bounds = (bounds.w > 0) ? _Luno_UnionRect(bounds, area) : area;
+            }
+            x += glyph->xadv;
+        }
+        return bounds;
+    }
+
+    // --- Frame Statistics ---
+
+    // Adds a draw call and the pixels it wrote to the statistics of the frame. Tiled rendering adds the pixels
+    // when the frame is rasterized.
+    static void _Luno_CountDraw(const _LunoCommand *cmd, long long pixels)
+    {
+        _lunoStats.current.draws[cmd->type]++;
+        _lunoStats.current.pixels[cmd->type] += pixels;
+    }
+
+    static int _Luno_CompareFloats(const void *a, const void *b)
+    {
+        float x = *(const float *)a, y = *(const float *)b;
+        return (x > y) - (x < y);
+    }
+
+    // Completes the statistics of a frame. The time spent in Luno_Update is split at the given points.
+    static void _Luno_FinishFrameStats(double presentStart, double sleepStart, double pumpStart)
+    {
+        double end = _Luno_PerfNow();
+        LunoFrameStats *frame = &_lunoStats.current;
+        frame->frameTime = end - _lunoStats.frameEnd;
+        frame->presentTime = sleepStart - presentStart;
+        frame->sleepTime = pumpStart - sleepStart;
+        frame->pumpTime = end - pumpStart;
+        _lunoStats.frameEnd = end;
+
+        _lunoStats.window[_lunoStats.windowNext] = (float)frame->frameTime;
+        _lunoStats.windowNext = (_lunoStats.windowNext + 1) % LUNO_STATS_WINDOW;
+        _lunoStats.windowCount = _Luno_Min(_lunoStats.windowCount + 1, LUNO_STATS_WINDOW);
+
+        // The window is small enough to sort every frame
+        int count = _lunoStats.windowCount;
+        float sorted[LUNO_STATS_WINDOW];
+        memcpy(sorted, _lunoStats.window, count * sizeof(float));
+        qsort(sorted, count, sizeof(float), _Luno_CompareFloats);
+
+        double sum = 0;
+        for (int i = 0; i < count; i++)
+        {
+            sum += sorted[i];
+            frame->histogram[_Luno_Min((int)(sorted[i] * 1000), LUNO_STATS_BUCKETS - 1)]++;
+        }
+        frame->frames = count;
+        frame->minFrameTime = sorted[0];
+        frame->maxFrameTime = sorted[count - 1];
+        frame->avgFrameTime = sum / count;
+        frame->p99FrameTime = sorted[(int)ceil(count * 0.99) - 1];
+
+        _lunoStats.last = *frame;
+        memset(frame, 0, sizeof(*frame));
+    }
+
+    // Draws the statistics of the last frame and a graph of the recent frame times into the top left corner.
+    static void _Luno_DrawStatsOverlay(void)
+    {
+        LunoFont *font = _lunoContext.defaultFont;
+        if (!font)
+            return;
+
+        // Draw with the default font straight into the frame, after the tiled draws of the frame are flushed,
+        // and leave the draws out of the statistics
+        LunoCommandBuffer *recording = _lunoContext.recording;
+        LunoFont *currentFont = _lunoContext.currentFont;
+        bool tiledRendering = _lunoContext.tiledRendering;
+        _lunoContext.recording = NULL;
+        _lunoContext.tiledRendering = false;
+        _lunoContext.currentFont = font;
+        _lunoStats.paused = true;
+
+        const LunoFrameStats *s = &_lunoStats.last;
+        int draws = 0;
+        long long pixels = 0;
+        for (int i = 0; i < LUNO_PRIMITIVE_COUNT; i++)
+        {
+            draws += s->draws[i];
+            pixels += s->pixels[i];
+        }
+
+        // Times in milliseconds
+        char lines[6][64];
+        snprintf(lines[0], sizeof(lines[0]), "%.2f ms %.0f fps", s->frameTime * 1000, s->frameTime > 0 ? 1.0 / s->frameTime : 0.0);
+        snprintf(lines[1], sizeof(lines[1]), "min %.1f max %.1f", s->minFrameTime * 1000, s->maxFrameTime * 1000);
+        snprintf(lines[2], sizeof(lines[2]), "avg %.1f p99 %.1f", s->avgFrameTime * 1000, s->p99FrameTime * 1000);
+        snprintf(lines[3], sizeof(lines[3]), "draw %.1f pres %.1f", s->drawTime * 1000, s->presentTime * 1000);
+        snprintf(lines[4], sizeof(lines[4]), "sleep %.1f pump %.1f", s->sleepTime * 1000, s->pumpTime * 1000);
+        snprintf(lines[5], sizeof(lines[5]), "%d draws %.2f Mpix", draws, pixels / 1e6);
+
+        int lineCount = (int)(sizeof(lines) / sizeof(lines[0]));
+        int lineHeight = font->glyphs['A'].rect.h + 2;
+        int width = 0;
+        for (int i = 0; i < lineCount; i++)
+        {
+            int lineWidth = 0;
+            for (const char *c = lines[i]; *c; c++)
+                lineWidth += font->glyphs[(unsigned char)*c].xadv;
+            width = _Luno_Max(width, lineWidth);
+        }
+        int graphHeight = 32;
+        int graphTop = 4 + lineCount * lineHeight;
+        Luno_DrawRect((LunoRect){0, 0, width + 8, graphTop + graphHeight + 4}, (LunoColor){0, 0, 0, 192}, true);
+        for (int i = 0; i < lineCount; i++)
+            Luno_DrawText(lines[i], 4, 4 + i * lineHeight, LUNO_WHITE);
+
+        // One column per frame, the newest on the right; the graph spans twice the frame budget
+        double budget = _lunoContext.stepTime > 0 ? _lunoContext.stepTime : 1.0 / 60;
+        int bottom = graphTop + graphHeight - 1;
+        int columns = _Luno_Min(_lunoStats.windowCount, width);
+        for (int i = 0; i < columns; i++)
+        {
+            int index = (_lunoStats.windowNext - columns + i + LUNO_STATS_WINDOW) % LUNO_STATS_WINDOW;
+            double time = _lunoStats.window[index];
+            int height = _Luno_Max(1, _Luno_Min(graphHeight, (int)(time / (2 * budget) * graphHeight)));
+            LunoColor color = time <= budget * 1.05 ? LUNO_GREEN : (time <= budget * 2 ? LUNO_YELLOW : LUNO_RED);
+            Luno_DrawLine(4 + width - columns + i, bottom, 4 + width - columns + i, bottom - height + 1, color);
+        }
+        Luno_DrawLine(4, bottom - graphHeight / 2, 4 + width - 1, bottom - graphHeight / 2, (LunoColor){255, 255, 255, 96});
+
+        _lunoStats.paused = false;
+        _lunoContext.tiledRendering = tiledRendering;
+        _lunoContext.currentFont = currentFont;
+        _lunoContext.recording = recording;
+    }
+
+    // --- Command Encoding ---
+    // Every draw call is encoded once into a command: a _LunoCommand header holding the converted color and the
+    // clipped bounds, followed by a small payload of its type. Immediate mode executes it right away, tiled
+    // rendering appends it to the frame, and command buffers keep it to be replayed without redoing that work.
+
+#define _LUNO_MAX_COMMAND_SIZE (65535 * 8)
+
+    // Runs a command restricted to `clip` and returns the pixels it wrote.
+    static long long _Luno_ExecuteCommand(const _LunoCommand *cmd, LunoImage *dst, LunoRect clip)
+    {
+        const _LunoShapeArgs *shape = (const _LunoShapeArgs *)(cmd + 1);
+        switch (cmd->type)
+        {
+        case _LUNO_DRAW_CLEAR:
+        {
+            // Clearing overwrites, whatever the alpha of the clear color
+            int pitch = _Luno_Pitch(dst);
+            LunoColor *row = &dst->pixels[clip.x + clip.y * pitch];
+            if (clip.w == pitch)
+            {
+                // Bands of a large clear stream like the whole clear would
+                size_t frameBytes = (size_t)dst->width * dst->height * sizeof(LunoColor);
+                _Luno_FillPixelRange(row, (size_t)clip.w * clip.h, cmd->pixel, frameBytes >= LUNO_STREAM_THRESHOLD);
+                return (long long)clip.w * clip.h;
+            }
+            for (int y = 0; y < clip.h; y++, row += pitch)
+                _Luno_FillPixels(row, clip.w, cmd->pixel);
+            return (long long)clip.w * clip.h;
+        }
+        case _LUNO_DRAW_PIXEL:
+            return _Luno_PlotPixel(dst, clip, cmd->bounds.x, cmd->bounds.y, cmd->pixel);
+        case _LUNO_DRAW_LINE:
+            return _Luno_RasterLine(dst, clip, shape->x, shape->y, shape->a, shape->b, cmd->pixel);
+        case _LUNO_DRAW_RECT:
+            if (cmd->fill)
+                return _Luno_RasterRect(dst, clip, cmd->bounds, cmd->pixel, true);
+            return _Luno_RasterRect(dst, clip, (LunoRect){shape->x, shape->y, shape->a, shape->b}, cmd->pixel, false);
+        case _LUNO_DRAW_CIRCLE:
+            return _Luno_RasterCircle(dst, clip, shape->x, shape->y, shape->a, cmd->pixel, cmd->fill);
+        case _LUNO_DRAW_ELLIPSE:
+            return _Luno_RasterEllipse(dst, clip, shape->x, shape->y, shape->a, shape->b, cmd->pixel, cmd->fill);
+        case _LUNO_DRAW_IMAGE:
+        {
+            const _LunoImageArgs *args = (const _LunoImageArgs *)(cmd + 1);
+            LunoRect srcRect = {args->srcX, args->srcY, cmd->bounds.w, cmd->bounds.h};
+            return _Luno_BlitRect(dst, clip, args->image, cmd->bounds.x, cmd->bounds.y, srcRect);
+        }
+        case _LUNO_DRAW_TEXT:
+        {
+            const _LunoTextArgs *args = (const _LunoTextArgs *)(cmd + 1);
+            return _Luno_RasterText(dst, clip, args->font, (const char *)(args + 1), args->x, args->y, cmd->pixel);
+        }
+        }
+        return 0;
+    }
+
+    // Grows `*buffer` to hold at least `needed` elements of `size` bytes.
+    static void _Luno_Reserve(void **buffer, int *capacity, int needed, size_t size)
+    {
+        if (needed <= *capacity)
+            return;
+
+        int newCapacity = _Luno_Max(needed, *capacity * 2);
+        void *grown = LUNO_REALLOC(*buffer, (size_t)newCapacity * size);
+        if (!grown)
+        {
+            printf("ERROR <Luno>: Out of memory while recording draws!");
+            exit(0);
+        }
+        *buffer = grown;
+        *capacity = newCapacity;
+    }
+
+    // Encodes a draw call into the scratch buffer and returns its payload, or NULL if the draw is clipped away.
+    // The command is then submitted with _Luno_SubmitCommand(_lunoContext.scratch.data).
+    static void *_Luno_EncodeCommand(_LunoDrawType type, LunoRect bounds, LunoColor pixel, bool fill, size_t payloadSize)
+    {
+        LunoImage *bb = &_lunoContext.backbuffer;
+        if (!_Luno_ClipRect(&bounds, bb->width, bb->height))
+            return NULL;
+
+        int size = (int)((sizeof(_LunoCommand) + payloadSize + 7) & ~(size_t)7);
+        LunoCommandBuffer *scratch = &_lunoContext.scratch;
+        _Luno_Reserve((void **)&scratch->data, &scratch->capacity, size, 1);
+
+        _LunoCommand *cmd = (_LunoCommand *)scratch->data;
+        cmd->type = (unsigned char)type;
+        cmd->fill = fill;
+        cmd->size = (unsigned short)(size / 8);
+        cmd->pixel = pixel;
+        cmd->bounds = bounds;
+        return cmd + 1;
+    }
+
+    // Grows the previous blit by `cmd` when both draw adjacent pieces of the same image that form one rectangle
+    // in the source and the destination, as tile maps and sliced images do.
+    static bool _Luno_MergeBlit(_LunoCommand *prev, const _LunoCommand *cmd, LunoRect bounds)
+    {
+        if (prev->type != _LUNO_DRAW_IMAGE || cmd->type != _LUNO_DRAW_IMAGE)
+            return false;
+
+        const _LunoImageArgs *a = (const _LunoImageArgs *)(prev + 1);
+        const _LunoImageArgs *b = (const _LunoImageArgs *)(cmd + 1);
+        LunoRect p = prev->bounds;
+        if (a->image != b->image || b->srcX - a->srcX != bounds.x - p.x || b->srcY - a->srcY != bounds.y - p.y)
+            return false;
+
+        if (bounds.y == p.y && bounds.h == p.h && bounds.x == p.x + p.w)
+            prev->bounds.w += bounds.w; // Next in the row
+        else if (bounds.x == p.x && bounds.w == p.w && bounds.y == p.y + p.h)
+            prev->bounds.h += bounds.h; // Next in the column
+        else
+            return false;
+        return true;
+    }
+
+    static void _Luno_AppendCommand(LunoCommandBuffer *buffer, const _LunoCommand *cmd, LunoRect bounds)
+    {
+        if (cmd->type == _LUNO_DRAW_CLEAR)
+        {
+            // Everything recorded so far is overwritten
+            buffer->size = 0;
+            buffer->count = 0;
+        }
+        else if (buffer->count > 0 && _Luno_MergeBlit((_LunoCommand *)(buffer->data + buffer->last), cmd, bounds))
+        {
+            return;
+        }
+
+        int size = cmd->size * 8;
+        _Luno_Reserve((void **)&buffer->data, &buffer->capacity, buffer->size + size, 1);
+        _LunoCommand *copy = (_LunoCommand *)(buffer->data + buffer->size);
+        memcpy(copy, cmd, size);
+        copy->bounds = bounds;
+        buffer->last = buffer->size;
+        buffer->size += size;
+        buffer->count++;
+    }
+
+    typedef struct
+    {
+        const _LunoCommand *cmd;
+        LunoRect bounds;
+        volatile long drawn; // Pixels written by all bands, at most the backbuffer
+    } _LunoCommandBands;
+
+    static void _Luno_ExecuteBand(void *data, int begin, int end)
+    {
+        _LunoCommandBands *bands = (_LunoCommandBands *)data;
+        LunoRect clip = {bands->bounds.x, bands->bounds.y + begin, bands->bounds.w, end - begin};
+        _Luno_AtomicAdd(&bands->drawn, (long)_Luno_ExecuteCommand(bands->cmd, &_lunoContext.backbuffer, clip));
+    }
+
+    // Executes a command immediately and returns the pixels it wrote. Clears, blits and filled shapes are split
+    // into row bands across threads once they cover enough pixels, every band producing exactly the pixels of its rows.
+    static long long _Luno_ExecuteImmediate(const _LunoCommand *cmd, LunoRect bounds)
+    {
+        LunoImage *bb = &_lunoContext.backbuffer;
+        bool banded = cmd->type == _LUNO_DRAW_CLEAR || cmd->type == _LUNO_DRAW_IMAGE || cmd->fill;
+        if (!banded || (long long)bounds.w * bounds.h < LUNO_PARALLEL_THRESHOLD)
+            return _Luno_ExecuteCommand(cmd, bb, (LunoRect){0, 0, bb->width, bb->height});
+
+        _LunoCommandBands bands = {cmd, bounds, 0};
+        Luno_ParallelFor(bounds.h, _Luno_RowGrain(bounds.w), _Luno_ExecuteBand, &bands);
+        return bands.drawn;
+    }
+
+    static void _Luno_SubmitCommand(const _LunoCommand *cmd)
+    {
+        // Recorded bounds were clipped to the backbuffer of their time, clip again in case it shrank
+        LunoImage *bb = &_lunoContext.backbuffer;
+        LunoRect screen = {0, 0, bb->width, bb->height};
+        LunoRect bounds = (cmd->type == _LUNO_DRAW_CLEAR) ? screen : cmd->bounds;
+        if (!_Luno_IntersectRect(&bounds, screen))
+            return;
+
+        if (_lunoContext.recording)
+        {
+            _Luno_AppendCommand(_lunoContext.recording, cmd, bounds);
+            return;
+        }
+
+        double started = _lunoStats.enabled ? _Luno_PerfNow() : 0;
+        if (cmd->type == _LUNO_DRAW_CLEAR)
+        {
+            _lunoPresent.restore = false; // Everything is overwritten
+            _Luno_MarkAllDirty();
+        }
+        else
+        {
+            _Luno_RestoreBackbuffer();
+            _Luno_MarkDirty(bounds);
+        }
+
+        long long drawn = 0;
+        if (_lunoContext.tiledRendering)
+            _Luno_AppendCommand(&_lunoContext.frame, cmd, bounds);
+        else
+            drawn = _Luno_ExecuteImmediate(cmd, bounds);
+
+        if (_lunoStats.enabled)
+        {
+            _lunoStats.current.drawTime += _Luno_PerfNow() - started;
+            if (!_lunoStats.paused)
+                _Luno_CountDraw(cmd, drawn);
+        }
+    }
+
+    // Rasterizes the draws of a tile. `data` is NULL or receives the pixels written per draw type, LUNO_PRIMITIVE_COUNT
+    // counters per tile.
+    static void _Luno_RasterTile(void *data, int tile)
+    {
+        long long *drawn = data ? (long long *)data + (size_t)tile * LUNO_PRIMITIVE_COUNT : NULL;
+        LunoImage *bb = &_lunoContext.backbuffer;
+        int tilesX = (bb->width + LUNO_TILE_SIZE - 1) / LUNO_TILE_SIZE;
+        LunoRect clip = {(tile % tilesX) * LUNO_TILE_SIZE, (tile / tilesX) * LUNO_TILE_SIZE, LUNO_TILE_SIZE, LUNO_TILE_SIZE};
+        _Luno_ClipRect(&clip, bb->width, bb->height);
+
+        for (int i = _lunoContext.tileStart[tile]; i < _lunoContext.tileStart[tile + 1]; i++)
+        {
+            const _LunoCommand *cmd = (const _LunoCommand *)(_lunoContext.frame.data + _lunoContext.tileDraws[i]);
+            long long pixels = _Luno_ExecuteCommand(cmd, bb, clip);
+            if (drawn)
+                drawn[cmd->type] += pixels;
+        }
+    }
+
+    // Rasterizes all recorded draws. Each tile runs its draws in submission order, so the result matches
+    // drawing immediately.
+    static void _Luno_FlushDraws(void)
+    {
+        _Luno_RestoreBackbuffer();
+
+        LunoCommandBuffer *frame = &_lunoContext.frame;
+        if (frame->count == 0)
+            return;
+
+        double started = _lunoStats.enabled ? _Luno_PerfNow() : 0;
+        LunoImage *bb = &_lunoContext.backbuffer;
+        int tilesX = (bb->width + LUNO_TILE_SIZE - 1) / LUNO_TILE_SIZE;
+        int tilesY = (bb->height + LUNO_TILE_SIZE - 1) / LUNO_TILE_SIZE;
+        int tiles = tilesX * tilesY;
+
+        // Count the draws per tile, turn the counts into start offsets, then fill in draw order
+        _Luno_Reserve((void **)&_lunoContext.tileStart, &_lunoContext.tileCapacity, tiles + 1, sizeof(int));
+        int *start = _lunoContext.tileStart;
+        memset(start, 0, (tiles + 1) * sizeof(int));
+        for (int offset = 0; offset < frame->size;)
+        {
+            const _LunoCommand *cmd = (const _LunoCommand *)(frame->data + offset);
+            LunoRect b = cmd->bounds;
+            for (int ty = b.y / LUNO_TILE_SIZE; ty <= (b.y + b.h - 1) / LUNO_TILE_SIZE; ty++)
+                for (int tx = b.x / LUNO_TILE_SIZE; tx <= (b.x + b.w - 1) / LUNO_TILE_SIZE; tx++)
+                    start[ty * tilesX + tx + 1]++;
+            offset += cmd->size * 8;
+        }
+        for (int t = 0; t < tiles; t++)
+        {
+            start[t + 1] += start[t];
+        }
+
+        _Luno_Reserve((void **)&_lunoContext.tileDraws, &_lunoContext.tileDrawCapacity, start[tiles] + tiles, sizeof(int));
+        int *cursor = _lunoContext.tileDraws + start[tiles]; // Scratch space behind the index list
+        memcpy(cursor, start, tiles * sizeof(int));
+        for (int offset = 0; offset < frame->size;)
+        {
+            const _LunoCommand *cmd = (const _LunoCommand *)(frame->data + offset);
+            LunoRect b = cmd->bounds;
+            for (int ty = b.y / LUNO_TILE_SIZE; ty <= (b.y + b.h - 1) / LUNO_TILE_SIZE; ty++)
+                for (int tx = b.x / LUNO_TILE_SIZE; tx <= (b.x + b.w - 1) / LUNO_TILE_SIZE; tx++)
+                    _lunoContext.tileDraws[cursor[ty * tilesX + tx]++] = offset;
+            offset += cmd->size * 8;
+        }
+
+        // Each tile counts its pixels on its own, the totals are summed once all tiles are done
+        long long *drawn = NULL;
+        if (_lunoStats.enabled)
+        {
+            _Luno_Reserve((void **)&_lunoContext.tilePixels, &_lunoContext.tilePixelCapacity, tiles * LUNO_PRIMITIVE_COUNT, sizeof(long long));
+            drawn = _lunoContext.tilePixels;
+            memset(drawn, 0, (size_t)tiles * LUNO_PRIMITIVE_COUNT * sizeof(long long));
+        }
+
+        _Luno_RunParallel(_Luno_RasterTile, drawn, tiles);
+
+        for (int i = 0; drawn && i < tiles * LUNO_PRIMITIVE_COUNT; i++)
+            _lunoStats.current.pixels[i % LUNO_PRIMITIVE_COUNT] += drawn[i];
+
+        frame->size = 0;
+        frame->count = 0;
+        if (_lunoStats.enabled)
+            _lunoStats.current.drawTime += _Luno_PerfNow() - started;
+    }
+
+    // --- Bulk Pixel Jobs ---
+
+    static void _Luno_ConvertRange(void *dst, LunoPixelFormat dstFormat, const void *src, LunoPixelFormat srcFormat, int count)
+    {
+        int dstBytes = _Luno_FormatBytes(dstFormat);
+        int srcBytes = _Luno_FormatBytes(srcFormat);
+        bool swap = _Luno_FormatIsRedFirst(dstFormat) != _Luno_FormatIsRedFirst(srcFormat);
+
+        if (dstFormat == srcFormat)
+        {
+            memcpy(dst, src, (size_t)count * dstBytes);
+        }
+        else if (dstBytes == 4 && srcBytes == 4)
+        {
+            _Luno_SwapRB32((uint32_t *)dst, (const uint32_t *)src, count);
+        }
+        else if (dstBytes == 4)
+        {
+            _Luno_Expand24To32((unsigned char *)dst, (const unsigned char *)src, count, swap);
+        }
+        else
+        {
+            // To 24 bits: drop alpha
+            unsigned char *out = (unsigned char *)dst;
+            const unsigned char *in = (const unsigned char *)src;
+            int first = swap ? 2 : 0;
+            for (int i = 0; i < count; i++, out += 3, in += srcBytes)
+            {
+                unsigned char c0 = in[first], c1 = in[1], c2 = in[2 - first];
+                out[0] = c0;
+                out[1] = c1;
+                out[2] = c2;
+            }
+        }
+    }
+
+    typedef struct
+    {
+        void *dst;
+        LunoPixelFormat dstFormat;
+        const void *src;
+        LunoPixelFormat srcFormat;
+    } _LunoConvertJob;
+
+    static void _Luno_ConvertBand(void *data, int begin, int end)
+    {
+        const _LunoConvertJob *job = (const _LunoConvertJob *)data;
+        unsigned char *dst = (unsigned char *)job->dst + (size_t)begin * _Luno_FormatBytes(job->dstFormat);
+        const unsigned char *src = (const unsigned char *)job->src + (size_t)begin * _Luno_FormatBytes(job->srcFormat);
+        _Luno_ConvertRange(dst, job->dstFormat, src, job->srcFormat, end - begin);
+    }
+
+    typedef struct
+    {
+        LunoColor *pixels;
+        LunoColor pixel;
+        bool stream;
+        int width, pitch; // Row layout for _Luno_FillRowBand
+    } _LunoFillJob;
+
+    static void _Luno_FillBand(void *data, int begin, int end)
+    {
+        const _LunoFillJob *job = (const _LunoFillJob *)data;
+        _Luno_FillPixelRange(job->pixels + begin, end - begin, job->pixel, job->stream);
+    }
+
+    // Fills the rows of a band of an image whose rows are not contiguous.
+    static void _Luno_FillRowBand(void *data, int begin, int end)
+    {
+        const _LunoFillJob *job = (const _LunoFillJob *)data;
+        for (int y = begin; y < end; y++)
+            _Luno_FillPixelRange(job->pixels + (size_t)y * job->pitch, job->width, job->pixel, job->stream);
+    }
+
+    // --- Image Storage ---
+    // An image and its pixels share one allocation: the LunoImage sits in the first LUNO_ALIGNMENT bytes and the
+    // pixels follow aligned. It comes from the heap or, while one is set, from an image arena.
+
+    static _LunoArenaBlock *_Luno_ArenaNewBlock(size_t size)
+    {
+        _LunoArenaBlock *block = (_LunoArenaBlock *)_Luno_AlignedAlloc(_Luno_AlignSize(sizeof(_LunoArenaBlock)) + size);
+        if (!block)
+            return NULL;
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+        return block;
+    }
+
+    static void *_Luno_ArenaAlloc(LunoImageArena *arena, size_t size)
+    {
+        size = _Luno_AlignSize(size);
+        _LunoArenaBlock *block = arena->blocks;
+        if (!block || block->size - block->used < size)
+        {
+            if (size > arena->blockSize / 4)
+            {
+                // Oversized: a block of its own behind the current one, which keeps filling
+                block = _Luno_ArenaNewBlock(size);
+                if (!block)
+                    return NULL;
+                if (arena->blocks)
+                {
+                    block->next = arena->blocks->next;
+                    arena->blocks->next = block;
+                }
+                else
+                {
+                    arena->blocks = block;
+                }
+            }
+            else
+            {
+                block = _Luno_ArenaNewBlock(arena->blockSize);
+                if (!block)
+                    return NULL;
+                block->next = arena->blocks;
+                arena->blocks = block;
+            }
+        }
+        unsigned char *memory = (unsigned char *)block + _Luno_AlignSize(sizeof(_LunoArenaBlock)) + block->used;
+        block->used += size;
+        return memory;
+    }
+
+    // Allocates an image with room for its pixels (zeroed if `zero` is set) in `arena`, or on the heap if NULL.
+    static LunoImage *_Luno_AllocImageIn(LunoImageArena *arena, int width, int height, bool zero)
+    {
+        size_t header = _Luno_AlignSize(sizeof(LunoImage));
+        size_t bytes = (size_t)width * height * sizeof(LunoColor);
+        unsigned char *memory = (unsigned char *)(arena ? _Luno_ArenaAlloc(arena, header + bytes) : _Luno_AlignedAlloc(header + bytes));
+        if (!memory)
+            return NULL;
+
+        LunoImage *image = (LunoImage *)memory;
+        memset(image, 0, sizeof(LunoImage));
+        image->pixels = (LunoColor *)(memory + header);
+        image->width = width;
+        image->height = height;
+        image->format = LUNO_FORMAT_NATIVE;
+        image->arena = arena;
+        image->pitch = width;
+        if (zero)
+            memset(image->pixels, 0, bytes);
+        return image;
+    }
+
+    // Allocates an image in the current image arena.
+    static LunoImage *_Luno_AllocImage(int width, int height, bool zero)
+    {
+        return _Luno_AllocImageIn(_lunoContext.imageArena, width, height, zero);
+    }
+
+    // Frees an image nothing was drawn from yet, so no recorded draw can still read it.
+    static void _Luno_FreeNewImage(LunoImage *image)
+    {
+        if (image && !image->arena)
+            _Luno_AlignedFree(image);
+        else if (image)
+            image->pixels = NULL;
+    }
+
+    // --- TGA Decoding ---
+    // True-color TGAs (uncompressed or RLE, 24 or 32 bits) decode in one pass from the file data into the final
+    // pixels: rows are written straight to their flipped position, 24-bit pixels are expanded with SIMD and RLE runs
+    // go through the vectorized fill. No intermediate pixel buffer is allocated.
+
+    typedef struct
+    {
+        int width, height;
+        int bytes;                   // Bytes per stored pixel, 3 or 4
+        bool rle;                    // Run-length encoded (image type 10)
+        bool bottomUp;               // The first stored row is the bottom one
+        const unsigned char *pixels; // Pixel data behind the header and image ID
+        const unsigned char *end;
+    } _LunoTga;
+
+    typedef struct
+    {
+        const _LunoTga *tga;
+        LunoColor *pixels;
+        int pitch;
+        bool import;            // Premultiply and classify while decoding
+        int grain;              // Rows per band
+        unsigned char *classes; // LunoAlphaClass of every band
+    } _LunoTgaJob;
+
+    // Reads the header of a TGA. Returns false with a message on stderr if the data is no supported TGA.
+    static bool _Luno_ParseTga(const unsigned char *data, size_t size, _LunoTga *tga)
+    {
+        if (size < 18)
+        {
+            fprintf(stderr, "Invalid TGA data: insufficient size\n");
+            return false;
+        }
+
+        // Verify image type (uncompressed or RLE compressed true-color)
+        if (data[2] != 2 && data[2] != 10)
+        {
+            fprintf(stderr, "Unsupported TGA image type (only uncompressed or RLE true-color supported)\n");
+            return false;
+        }
+
+        if (data[16] != 32 && data[16] != 24)
+        {
+            fprintf(stderr, "Unsupported TGA pixel depth (only 24-bit and 32-bit supported)\n");
+            return false;
+        }
+
+        // The pixels follow the header and the optional image ID
+        size_t headerSize = 18 + data[0];
+        if (size < headerSize)
+        {
+            fprintf(stderr, "Invalid TGA data: insufficient size\n");
+            return false;
+        }
+
+        tga->width = data[12] | (data[13] << 8);
+        tga->height = data[14] | (data[15] << 8);
+        tga->bytes = data[16] / 8;
+        tga->rle = data[2] == 10;
+        tga->bottomUp = !(data[17] & 0x20);
+        tga->pixels = data + headerSize;
+        tga->end = data + size;
+
+        if (!tga->rle && (size_t)(tga->end - tga->pixels) < (size_t)tga->width * tga->height * tga->bytes)
+        {
+            fprintf(stderr, "Insufficient pixel data for uncompressed TGA\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Destination of stored row `row`, counted from the bottom for bottom-up files.
+    static LunoColor *_Luno_TgaRow(const _LunoTgaJob *job, int row)
+    {
+        int y = job->tga->bottomUp ? job->tga->height - 1 - row : row;
+        return job->pixels + (size_t)y * job->pitch;
+    }
+
+    // Stores `count` pixels of a row and, when importing, premultiplies and classifies them while they are in the cache.
+    static LunoAlphaClass _Luno_TgaSpan(const _LunoTgaJob *job, LunoColor *dst, const unsigned char *src, int count)
+    {
+        if (job->tga->bytes == 3)
+        {
+            _Luno_ConvertRange(dst, LUNO_FORMAT_NATIVE, src, LUNO_FORMAT_BGR24, count);
+            return LUNO_ALPHA_OPAQUE;
+        }
+
+        _Luno_ConvertRange(dst, LUNO_FORMAT_NATIVE, src, LUNO_FORMAT_BGRA32, count);
+        if (!job->import)
+            return LUNO_ALPHA_TRANSLUCENT;
+#ifdef LUNO_PREMULTIPLIED
+        _Luno_PremultiplyPixels(dst, count);
+#endif
+        return _Luno_ClassifyAlpha(dst, count);
+    }
+
+    static void _Luno_TgaRowBand(void *data, int begin, int end)
+    {
+        const _LunoTgaJob *job = (const _LunoTgaJob *)data;
+        const _LunoTga *tga = job->tga;
+        LunoAlphaClass alphaClass = LUNO_ALPHA_OPAQUE;
+        for (int row = begin; row < end; row++)
+        {
+            const unsigned char *src = tga->pixels + (size_t)row * tga->width * tga->bytes;
+            LunoAlphaClass rowClass = _Luno_TgaSpan(job, _Luno_TgaRow(job, row), src, tga->width);
+            if (rowClass < alphaClass)
+                alphaClass = rowClass;
+        }
+        job->classes[begin / job->grain] = (unsigned char)alphaClass;
+    }
+
+    // Packets may cross rows, so they are split at row ends to land every row at its flipped position.
+    static bool _Luno_DecodeTgaRle(const _LunoTgaJob *job, LunoAlphaClass *alphaClass)
+    {
+        const _LunoTga *tga = job->tga;
+        const unsigned char *ptr = tga->pixels;
+        int row = 0;
+        int x = 0;
+        LunoColor *rowPixels = _Luno_TgaRow(job, 0);
+
+        while (row < tga->height)
+        {
+            if (ptr >= tga->end)
+            {
+                fprintf(stderr, "Not enough pixel data for RLE-compressed TGA\n");
+                return false;
+            }
+
+            unsigned char packetHeader = *ptr++;
+            int count = (packetHeader & 0x7F) + 1;
+            bool run = (packetHeader & 0x80) != 0;
+            if (tga->end - ptr < (run ? 1 : count) * tga->bytes)
+            {
+                fprintf(stderr, run ? "Insufficient RLE pixel data\n" : "Insufficient raw pixel data\n");
+                return false;
+            }
+
+            LunoColor pixel = {0};
+            if (run)
+            {
+                // One BGR(A) value repeated, classified once for the whole run
+                pixel = (LunoColor){ptr[0], ptr[1], ptr[2], (unsigned char)((tga->bytes == 4) ? ptr[3] : 255)};
+                ptr += tga->bytes;
+                if (job->import)
+                {
+#ifdef LUNO_PREMULTIPLIED
+                    _Luno_PremultiplyPixels(&pixel, 1);
+#endif
+                    LunoAlphaClass runClass = _Luno_ClassifyAlpha(&pixel, 1);
+                    if (runClass < *alphaClass)
+                        *alphaClass = runClass;
+                }
+            }
+
+            while (count > 0 && row < tga->height)
+            {
+                int span = _Luno_Min(count, tga->width - x);
+                LunoColor *dst = rowPixels + x;
+                if (run && span < 16)
+                {
+                    // Short runs are cheaper to store directly than to set up the vector fill
+                    for (int i = 0; i < span; i++)
+                        dst[i] = pixel;
+                }
+                else if (run)
+                {
+                    _Luno_FillPixels(dst, span, pixel);
+                }
+                else
+                {
+                    LunoAlphaClass spanClass = _Luno_TgaSpan(job, dst, ptr, span);
+                    if (spanClass < *alphaClass)
+                        *alphaClass = spanClass;
+                    ptr += (size_t)span * tga->bytes;
+                }
+
+                count -= span;
+                x += span;
+                if (x == tga->width && ++row < tga->height)
+                {
+                    x = 0;
+                    rowPixels = _Luno_TgaRow(job, row);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Decodes a parsed TGA into `pixels`, whose rows are `pitch` pixels apart, top row first. With `import` set the
+    // pixels are premultiplied (LUNO_PREMULTIPLIED) and their alpha class is returned in `alphaClass`. Without
+    // `parallel` everything runs on the calling thread, which does not have to be the one owning the thread pool.
+    static bool _Luno_DecodeTga(const _LunoTga *tga, LunoColor *pixels, int pitch, bool import, bool parallel, LunoAlphaClass *alphaClass)
+    {
+        *alphaClass = import ? LUNO_ALPHA_OPAQUE : LUNO_ALPHA_TRANSLUCENT;
+        if (tga->width <= 0 || tga->height <= 0)
+            return true;
+
+        _LunoTgaJob job = {tga, pixels, pitch, import, parallel ? _Luno_RowGrain(tga->width) : tga->height, NULL};
+        if (tga->rle)
+            return _Luno_DecodeTgaRle(&job, alphaClass);
+
+        // Uncompressed rows are independent and split across threads for large images
+        int bands = (tga->height + job.grain - 1) / job.grain;
+        unsigned char stackClasses[256];
+        job.classes = (bands <= 256) ? stackClasses : (unsigned char *)LUNO_MALLOC(bands);
+        if (!job.classes)
+        {
+            fprintf(stderr, "Memory allocation failed for pixel data\n");
+            return false;
+        }
+
+        if (parallel)
+            Luno_ParallelFor(tga->height, job.grain, _Luno_TgaRowBand, &job);
+        else
+            _Luno_TgaRowBand(&job, 0, tga->height);
+
+        // The image needs the most general class of any band
+        if (import)
+        {
+            for (int i = 0; i < bands; i++)
+            {
+                if (job.classes[i] < *alphaClass)
+                    *alphaClass = (LunoAlphaClass)job.classes[i];
+            }
+        }
+
+        if (job.classes != stackClasses)
+            LUNO_FREE(job.classes);
+        return true;
+    }
+
+    // Allocates an image for a TGA in memory and decodes straight into its pixels. In the `background` the image
+    // comes from the heap and is decoded on the calling thread alone.
+    static LunoImage *_Luno_LoadTga(const unsigned char *data, size_t size, bool background)
+    {
+        _LunoTga tga;
+        if (!_Luno_ParseTga(data, size, &tga))
+            return NULL;
+
+        LunoImage *image = _Luno_AllocImageIn(background ? NULL : _lunoContext.imageArena, tga.width, tga.height, false);
+        if (!image)
+        {
+            fprintf(stderr, "Memory allocation failed for pixel data\n");
+            return NULL;
+        }
+
+        if (!_Luno_DecodeTga(&tga, image->pixels, image->pitch, true, !background, &image->alphaClass))
+        {
+            _Luno_FreeNewImage(image);
+            return NULL;
+        }
+        return image;
+    }
+
+    // --- QOI Codec ---
+    // QOI (https://qoiformat.org) codes every pixel relative to the previous one or a 64-entry hash table of recent
+    // colors. The stream is strictly sequential, so decoding runs on the calling thread: one switch per op, runs go
+    // through the fill, and the decoder works in the native BGRA layout so pixels are stored without conversion.
+    // A row is premultiplied and classified right after it was decoded, and only once an op introduced alpha.
+
+#define LUNO_QOI_HEADER 14
+#define LUNO_QOI_PADDING 8              // 7 zero bytes and a 1 close every stream
+#define LUNO_QOI_MAX_PIXELS 400000000u // Bounds the allocation a forged header can ask for
+
+    typedef struct
+    {
+        int width, height;
+        const unsigned char *chunks; // Ops behind the header
+        const unsigned char *end;    // Start of the padding
+    } _LunoQoi;
+
+    static uint32_t _Luno_ReadBigEndian(const unsigned char *data)
+    {
+        return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+    }
+
+    static void _Luno_WriteBigEndian(unsigned char *data, uint32_t value)
+    {
+        data[0] = (unsigned char)(value >> 24);
+        data[1] = (unsigned char)(value >> 16);
+        data[2] = (unsigned char)(value >> 8);
+        data[3] = (unsigned char)value;
+    }
+
+    static bool _Luno_IsQoi(const unsigned char *data, size_t size)
+    {
+        return size >= 4 && memcmp(data, "qoif", 4) == 0;
+    }
+
+    // Reads the header of a QOI. Returns false with a message on stderr if the data is no valid QOI.
+    static bool _Luno_ParseQoi(const unsigned char *data, size_t size, _LunoQoi *qoi)
+    {
+        if (size < LUNO_QOI_HEADER + LUNO_QOI_PADDING || !_Luno_IsQoi(data, size))
         {
-            LunoRect wr = _Luno_GetAdjustedWindowRect(&_lunoContext);
-            int prevx = _lunoContext.mousePos.x;
-            int prevy = _lunoContext.mousePos.y;
+            fprintf(stderr, "Invalid QOI data: insufficient size\n");
+            return false;
+        }
 
-            // Calculate the unclamped mouse position
-            int unclampedX = (GET_X_LPARAM(lParam) - wr.x) * _lunoContext.backbuffer.width / wr.w;
-            int unclampedY = (GET_Y_LPARAM(lParam) - wr.y) * _lunoContext.backbuffer.height / wr.h;
+        uint32_t width = _Luno_ReadBigEndian(data + 4);
+        uint32_t height = _Luno_ReadBigEndian(data + 8);
+        if (width == 0 || height == 0 || (data[12] != 3 && data[12] != 4) || data[13] > 1 ||
+            height > LUNO_QOI_MAX_PIXELS / width)
+        {
+            fprintf(stderr, "Invalid QOI header\n");
+            return false;
+        }
 
-            // Clamp the mouse position to the backbuffer dimensions
-            _lunoContext.mousePos.x = max(0, min(unclampedX, _lunoContext.backbuffer.width - 1));
-            _lunoContext.mousePos.y = max(0, min(unclampedY, _lunoContext.backbuffer.height - 1));
+        qoi->width = (int)width;
+        qoi->height = (int)height;
+        qoi->chunks = data + LUNO_QOI_HEADER;
+        qoi->end = data + size - LUNO_QOI_PADDING;
+        return true;
+    }
 
-            // Calculate the delta
-            _lunoContext.mouseDelta.x += _lunoContext.mousePos.x - prevx;
-            _lunoContext.mouseDelta.y += _lunoContext.mousePos.y - prevy;
+    // Hash of a native pixel on its red, green, blue and alpha values, as the format defines it.
+    static inline int _Luno_QoiHash(LunoColor pixel)
+    {
+        return (pixel.b * 3 + pixel.g * 5 + pixel.r * 7 + pixel.a * 11) & 63;
+    }
+
+    // Decodes a parsed QOI into `pixels`, whose rows are `pitch` pixels apart. With `import` set the pixels are
+    // premultiplied (LUNO_PREMULTIPLIED) and their alpha class is returned in `alphaClass`.
+    static bool _Luno_DecodeQoi(const _LunoQoi *qoi, LunoColor *pixels, int pitch, bool import, LunoAlphaClass *alphaClass)
+    {
+        *alphaClass = import ? LUNO_ALPHA_OPAQUE : LUNO_ALPHA_TRANSLUCENT;
+
+        LunoColor index[64];
+        memset(index, 0, sizeof(index));
+        LunoColor pixel = {0, 0, 0, 255};
+        const unsigned char *p = qoi->chunks;
+        int run = 0;
+        int alpha = 0; // Non-zero once a pixel with alpha below 255 may have been decoded
+
+        for (int y = 0; y < qoi->height; y++)
+        {
+            LunoColor *row = pixels + (size_t)y * pitch;
+            int x = 0;
+            while (x < qoi->width)
+            {
+                if (run > 0)
+                {
+                    int count = _Luno_Min(run, qoi->width - x);
+                    if (count < 16)
+                    {
+                        for (int i = 0; i < count; i++)
+                            row[x + i] = pixel;
+                    }
+                    else
+                    {
+                        _Luno_FillPixels(row + x, count, pixel);
+                    }
+                    run -= count;
+                    x += count;
+                    continue;
+                }
+
+                if (p >= qoi->end)
+                {
+                    fprintf(stderr, "Invalid QOI data: truncated pixel data\n");
+                    return false;
+                }
+
+                // The padding behind the ops guarantees the 4 bytes after `p` can be read
+                int op = *p++;
+                switch (op >> 6)
+                {
+                case 0: // QOI_OP_INDEX
+                    pixel = index[op];
+                    alpha |= pixel.a ^ 255;
+                    break;
+                case 1: // QOI_OP_DIFF: -2..1 per channel
+                    pixel.b = (unsigned char)(pixel.b + ((op >> 4) & 3) - 2);
+                    pixel.g = (unsigned char)(pixel.g + ((op >> 2) & 3) - 2);
+                    pixel.r = (unsigned char)(pixel.r + (op & 3) - 2);
+                    break;
+                case 2: // QOI_OP_LUMA: green -32..31, red and blue -8..7 relative to it
+                {
+                    int green = (op & 63) - 32;
+                    int second = *p++;
+                    pixel.b = (unsigned char)(pixel.b + green - 8 + (second >> 4));
+                    pixel.g = (unsigned char)(pixel.g + green);
+                    pixel.r = (unsigned char)(pixel.r + green - 8 + (second & 15));
+                    break;
+                }
+                default:
+                    if (op == 0xFE) // QOI_OP_RGB
+                    {
+                        pixel.b = p[0];
+                        pixel.g = p[1];
+                        pixel.r = p[2];
+                        p += 3;
+                    }
+                    else if (op == 0xFF) // QOI_OP_RGBA
+                    {
+                        pixel = (LunoColor){p[2], p[1], p[0], p[3]};
+                        alpha |= p[3] ^ 255;
+                        p += 4;
+                    }
+                    else // QOI_OP_RUN: 1..62 pixels
+                    {
+                        run = (op & 63) + 1;
+                        index[_Luno_QoiHash(pixel)] = pixel;
+                        continue;
+                    }
+                    break;
+                }
+                index[_Luno_QoiHash(pixel)] = pixel;
+                row[x++] = pixel;
+            }
+
+            // Rows before the first translucent pixel are known to be opaque
+            if (import && alpha)
+            {
+#ifdef LUNO_PREMULTIPLIED
+                _Luno_PremultiplyPixels(row, qoi->width);
+#endif
+                LunoAlphaClass rowClass = _Luno_ClassifyAlpha(row, qoi->width);
+                if (rowClass < *alphaClass)
+                    *alphaClass = rowClass;
+            }
+        }
+        return true;
+    }
+
+    // Allocates an image for a QOI in memory and decodes straight into its pixels, from the heap in the `background`.
+    static LunoImage *_Luno_LoadQoi(const unsigned char *data, size_t size, bool background)
+    {
+        _LunoQoi qoi;
+        if (!_Luno_ParseQoi(data, size, &qoi))
+            return NULL;
+
+        LunoImage *image = _Luno_AllocImageIn(background ? NULL : _lunoContext.imageArena, qoi.width, qoi.height, false);
+        if (!image)
+        {
+            fprintf(stderr, "Memory allocation failed for pixel data\n");
+            return NULL;
+        }
+
+        if (!_Luno_DecodeQoi(&qoi, image->pixels, image->pitch, true, &image->alphaClass))
+        {
+            _Luno_FreeNewImage(image);
+            return NULL;
+        }
+        return image;
+    }
+
+    // Encodes an image as QOI with straight alpha. Returns the file data (released with LUNO_FREE) and its size in
+    // `*size`, NULL if out of memory.
+    static unsigned char *_Luno_EncodeQoi(const LunoImage *image, size_t *size)
+    {
+        size_t count = (size_t)image->width * image->height;
+        unsigned char *data = (unsigned char *)LUNO_MALLOC(LUNO_QOI_HEADER + count * 5 + LUNO_QOI_PADDING);
+        if (!data)
+            return NULL;
+
+        memcpy(data, "qoif", 4);
+        _Luno_WriteBigEndian(data + 4, (uint32_t)image->width);
+        _Luno_WriteBigEndian(data + 8, (uint32_t)image->height);
+        data[12] = (image->alphaClass == LUNO_ALPHA_OPAQUE) ? 3 : 4;
+        data[13] = 0; // sRGB with linear alpha
+
+        // Works on native pixels like the decoder; the hash and the ops only care which channel is which
+        LunoColor index[64];
+        memset(index, 0, sizeof(index));
+        LunoColor previous = {0, 0, 0, 255};
+        unsigned char *out = data + LUNO_QOI_HEADER;
+        int run = 0;
+        int pitch = _Luno_Pitch(image);
+        for (int y = 0; y < image->height; y++)
+        {
+            const LunoColor *row = image->pixels + (size_t)y * pitch;
+            for (int x = 0; x < image->width; x++)
+            {
+#ifdef LUNO_PREMULTIPLIED
+                // Back to straight alpha, still in the native channel order
+                LunoColor straight = _Luno_FromPixel(row[x]);
+                LunoColor pixel = {straight.b, straight.g, straight.r, straight.a};
+#else
+                LunoColor pixel = row[x];
+#endif
+                if (memcmp(&pixel, &previous, sizeof(LunoColor)) == 0)
+                {
+                    if (++run == 62)
+                    {
+                        *out++ = (unsigned char)(0xC0 | (run - 1));
+                        run = 0;
+                    }
+                    continue;
+                }
+                if (run > 0)
+                {
+                    *out++ = (unsigned char)(0xC0 | (run - 1));
+                    run = 0;
+                }
+
+                int hash = _Luno_QoiHash(pixel);
+                if (memcmp(&index[hash], &pixel, sizeof(LunoColor)) == 0)
+                {
+                    *out++ = (unsigned char)hash;
+                }
+                else if (pixel.a != previous.a)
+                {
+                    index[hash] = pixel;
+                    *out++ = 0xFF;
+                    *out++ = pixel.b;
+                    *out++ = pixel.g;
+                    *out++ = pixel.r;
+                    *out++ = pixel.a;
+                }
+                else
+                {
+                    index[hash] = pixel;
+                    int red = (signed char)(pixel.b - previous.b);
+                    int green = (signed char)(pixel.g - previous.g);
+                    int blue = (signed char)(pixel.r - previous.r);
+                    int redGreen = red - green;
+                    int blueGreen = blue - green;
+                    if (red >= -2 && red <= 1 && green >= -2 && green <= 1 && blue >= -2 && blue <= 1)
+                    {
+                        *out++ = (unsigned char)(0x40 | ((red + 2) << 4) | ((green + 2) << 2) | (blue + 2));
+                    }
+                    else if (green >= -32 && green <= 31 && redGreen >= -8 && redGreen <= 7 && blueGreen >= -8 && blueGreen <= 7)
+                    {
+                        *out++ = (unsigned char)(0x80 | (green + 32));
+                        *out++ = (unsigned char)(((redGreen + 8) << 4) | (blueGreen + 8));
+                    }
+                    else
+                    {
+                        *out++ = 0xFE;
+                        *out++ = pixel.b;
+                        *out++ = pixel.g;
+                        *out++ = pixel.r;
+                    }
+                }
+                previous = pixel;
+            }
+        }
+        if (run > 0)
+            *out++ = (unsigned char)(0xC0 | (run - 1));
+
+        memset(out, 0, LUNO_QOI_PADDING - 1);
+        out[LUNO_QOI_PADDING - 1] = 1;
+        *size = (size_t)(out - data) + LUNO_QOI_PADDING;
+        return data;
+    }
+
+    // Decodes TGA or QOI data, told apart by the QOI magic.
+    static LunoImage *_Luno_LoadImageData(const unsigned char *data, size_t size, bool background)
+    {
+        if (_Luno_IsQoi(data, size))
+            return _Luno_LoadQoi(data, size, background);
+        return _Luno_LoadTga(data, size, background);
+    }
+
+    // --- Asset Bundles ---
+    // Paths are found by binary search over the sorted names of every mounted bundle. Images come out as views of
+    // the pixels in the mapping; fonts copy their packed glyph tables instead of scanning the image.
+
+    static bool _Luno_CheckPakFont(const _LunoFileView *file, const _LunoPakEntry *entry)
+    {
+        if (entry->fontOffset % 4 != 0 || entry->fontOffset > file->size || sizeof(_LunoPakFont) > file->size - entry->fontOffset)
+            return false;
+
+        const _LunoPakFont *record = (const _LunoPakFont *)(file->data + entry->fontOffset);
+        if ((record->maskBits != 1 && record->maskBits != 8) ||
+            record->maskSize > file->size - entry->fontOffset - sizeof(_LunoPakFont))
+            return false;
+
+        // Text is drawn from the masks alone, so every glyph mask has to lie inside the packed ones
+        for (int i = 0; i < 256; i++)
+        {
+            const LunoGlyph *glyph = &record->glyphs[i];
+            int rowBytes = (record->maskBits == 1) ? (glyph->bounds.w + 7) / 8 : glyph->bounds.w;
+            if (glyph->bounds.w < 0 || glyph->bounds.h < 0 || glyph->maskOffset < 0 || glyph->maskPitch < rowBytes ||
+                (uint64_t)glyph->maskOffset + (uint64_t)glyph->maskPitch * glyph->bounds.h > record->maskSize)
+                return false;
+        }
+        return true;
+    }
+
+    // Checks that every offset of a bundle stays inside the file.
+    static bool _Luno_CheckPak(const _LunoFileView *file)
+    {
+        const _LunoPakHeader *header = (const _LunoPakHeader *)file->data;
+        if (file->size < sizeof(_LunoPakHeader) || memcmp(header->magic, LUNO_PAK_MAGIC, sizeof(LUNO_PAK_MAGIC)) != 0 ||
+            header->version != LUNO_PAK_VERSION || header->entrySize != sizeof(_LunoPakEntry) ||
+            header->fileSize != file->size || header->count > (file->size - sizeof(_LunoPakHeader)) / sizeof(_LunoPakEntry))
+            return false;
+
+        const _LunoPakEntry *entries = (const _LunoPakEntry *)(header + 1);
+        for (uint32_t i = 0; i < header->count; i++)
+        {
+            const _LunoPakEntry *entry = &entries[i];
+            uint64_t bytes = (uint64_t)entry->width * entry->height * sizeof(LunoColor);
+            if (entry->nameOffset >= file->size || !memchr(file->data + entry->nameOffset, 0, file->size - entry->nameOffset) ||
+                entry->width > INT_MAX || entry->height > INT_MAX || entry->alphaClass > LUNO_ALPHA_OPAQUE ||
+                entry->pixelOffset > file->size || bytes > file->size - entry->pixelOffset)
+                return false;
+            if (entry->fontOffset && !_Luno_CheckPakFont(file, entry))
+                return false;
+        }
+        return true;
+    }
+
+    // strcmp that reads '\\' in `path` as '/', the separator bundles store.
+    static int _Luno_PakCompare(const char *path, const char *name)
+    {
+        for (;; path++, name++)
+        {
+            int a = (*path == '\\') ? '/' : (unsigned char)*path;
+            int b = (unsigned char)*name;
+            if (a != b || !a)
+                return a - b;
+        }
+    }
+
+    // Finds `path` in the mounted bundles, newest first. Returns the entry index in `*found`, or -1.
+    static int _Luno_PakFind(const char *path, LunoPak **found)
+    {
+        for (LunoPak *pak = _lunoContext.paks; pak; pak = pak->next)
+        {
+            int low = 0;
+            int high = pak->count - 1;
+            while (low <= high)
+            {
+                int middle = (low + high) / 2;
+                int order = _Luno_PakCompare(path, (const char *)pak->file.data + pak->entries[middle].nameOffset);
+                if (order == 0)
+                {
+                    *found = pak;
+                    return middle;
+                }
+                if (order < 0)
+                    high = middle - 1;
+                else
+                    low = middle + 1;
+            }
+        }
+        return -1;
+    }
+
+    // Views keep the packed images alive in the bundle: destroying one frees the view only.
+    static LunoImage *_Luno_PakImage(LunoPak *pak, int index, bool background)
+    {
+        LunoImage *parent = &pak->images[index];
+        LunoImage *view = _Luno_AllocImageIn(background ? NULL : _lunoContext.imageArena, 0, 0, false);
+        if (!view)
+            return NULL;
+
+        view->pixels = parent->pixels;
+        view->width = parent->width;
+        view->height = parent->height;
+        view->pitch = parent->pitch;
+        view->alphaClass = parent->alphaClass;
+        view->parent = parent;
+        return view;
+    }
+
+    // Returns NULL if the image was not packed as a font of this glyph layout.
+    static LunoFont *_Luno_PakFont(LunoPak *pak, int index, int glyphWidth, int glyphHeight, bool background)
+    {
+        const _LunoPakEntry *entry = &pak->entries[index];
+        if (!entry->fontOffset)
+            return NULL;
+
+        const _LunoPakFont *record = (const _LunoPakFont *)(pak->file.data + entry->fontOffset);
+        if ((int)record->columns != glyphWidth || (int)record->rows != glyphHeight)
+            return NULL;
+
+        LunoFont *font = (LunoFont *)LUNO_MALLOC(sizeof(LunoFont));
+        unsigned char *mask = (unsigned char *)LUNO_MALLOC(record->maskSize > 0 ? record->maskSize : 1);
+        LunoImage *image = _Luno_PakImage(pak, index, background);
+        if (!font || !mask || !image)
+        {
+            _Luno_FreeNewImage(image);
+            LUNO_FREE(mask);
+            LUNO_FREE(font);
+            return NULL;
+        }
+
+        memcpy(font->glyphs, record->glyphs, sizeof(font->glyphs));
+        memcpy(mask, record + 1, record->maskSize);
+        font->image = image;
+        font->mask = mask;
+        font->maskBits = (int)record->maskBits;
+        font->ownsImage = true;
+        return font;
+    }
+
+    // --- Background Loading ---
+    // Async loads wait in a binary heap until one of LUNO_LOAD_THREADS threads takes the most urgent. A thread loads
+    // without the lock, then links the result into the finished list, which Luno_Update drains on the main thread:
+    // callbacks, destroying cancelled results and reusing slots all happen there. Background loads use the heap and
+    // decode serially, since image arenas and the thread pool belong to the main thread.
+
+    // Loads an image file or bundle entry. Returns NULL with the reason in `*error` if it fails.
+    static LunoImage *_Luno_ReadImage(const char *filePath, bool background, const char **error)
+    {
+        // Bundles are only mounted and unmounted on the main thread
+        if (background)
+            _Luno_MutexLock(&_lunoLoader.mutex);
+        LunoPak *pak;
+        int index = _Luno_PakFind(filePath, &pak);
+        LunoImage *packed = (index >= 0) ? _Luno_PakImage(pak, index, background) : NULL;
+        if (background)
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+        if (index >= 0)
+        {
+            *error = packed ? NULL : "Out of memory";
+            return packed;
+        }
+
+        // Decoded straight from the mapped file, which is unmapped right after
+        _LunoFileView file;
+        if (!_Luno_OpenFileView(filePath, &file, false))
+        {
+            *error = "Unable to read image file";
+            return NULL;
+        }
+
+        LunoImage *image = _Luno_LoadImageData(file.data, file.size, background);
+        _Luno_CloseFileView(&file);
+        *error = image ? NULL : "Unable to load image data";
+        return image;
+    }
+
+    static int _Luno_LoadHandle(int index)
+    {
+        return (_lunoLoader.loads[index].generation << 20) | (index + 1);
+    }
+
+    // Index of the load behind a handle, -1 if it was taken or cancelled.
+    static int _Luno_LoadFind(int handle)
+    {
+        int index = (handle & 0xFFFFF) - 1;
+        if (handle <= 0 || index < 0 || index >= _lunoLoader.count)
+            return -1;
+        _LunoLoad *load = &_lunoLoader.loads[index];
+        if (load->state == LUNO_LOAD_NONE || load->cancelled || _Luno_LoadHandle(index) != handle)
+            return -1;
+        return index;
+    }
+
+    static void _Luno_LoadFree(int index)
+    {
+        _LunoLoad *load = &_lunoLoader.loads[index];
+        LUNO_FREE(load->path);
+        load->path = NULL;
+        load->generation = (load->generation + 1) & 0x7FF;
+        load->state = LUNO_LOAD_NONE;
+        load->next = _lunoLoader.freeList;
+        _lunoLoader.freeList = index;
+    }
+
+    // True if load `a` starts before load `b`.
+    static bool _Luno_LoadBefore(int a, int b)
+    {
+        const _LunoLoad *first = &_lunoLoader.loads[a];
+        const _LunoLoad *second = &_lunoLoader.loads[b];
+        if (first->priority != second->priority)
+            return first->priority > second->priority;
+        return (int)(first->sequence - second->sequence) < 0;
+    }
+
+    static void _Luno_HeapPlace(int position, int index)
+    {
+        _lunoLoader.heap[position] = index;
+        _lunoLoader.loads[index].heapIndex = position;
+    }
+
+    // Moves the load at `position` up or down until the heap order holds again.
+    static void _Luno_HeapFix(int position)
+    {
+        int index = _lunoLoader.heap[position];
+        while (position > 0 && _Luno_LoadBefore(index, _lunoLoader.heap[(position - 1) / 2]))
+        {
+            _Luno_HeapPlace(position, _lunoLoader.heap[(position - 1) / 2]);
+            position = (position - 1) / 2;
+        }
+        for (;;)
+        {
+            int child = position * 2 + 1;
+            if (child >= _lunoLoader.heapCount)
+                break;
+            if (child + 1 < _lunoLoader.heapCount && _Luno_LoadBefore(_lunoLoader.heap[child + 1], _lunoLoader.heap[child]))
+                child++;
+            if (!_Luno_LoadBefore(_lunoLoader.heap[child], index))
+                break;
+            _Luno_HeapPlace(position, _lunoLoader.heap[child]);
+            position = child;
+        }
+        _Luno_HeapPlace(position, index);
+    }
+
+    static void _Luno_HeapRemove(int position)
+    {
+        int last = _lunoLoader.heap[--_lunoLoader.heapCount];
+        if (position == _lunoLoader.heapCount)
+            return;
+        _Luno_HeapPlace(position, last);
+        _Luno_HeapFix(position);
+    }
+
+    // Runs a load on the calling thread and stores its result in `load`, a copy the lock does not guard.
+    static void _Luno_RunLoad(_LunoLoad *load)
+    {
+        if (!load->path)
+        {
+            load->image = _Luno_LoadImageData(load->buffer, (size_t)load->bufferLen, true);
+            load->error = load->image ? NULL : "Unable to load image data";
+            return;
+        }
+
+        if (load->glyphWidth > 0)
+        {
+            // Bundles may hold the glyphs ready-made; otherwise they are built from the image
+            _Luno_MutexLock(&_lunoLoader.mutex);
+            LunoPak *pak;
+            int index = _Luno_PakFind(load->path, &pak);
+            load->font = (index >= 0) ? _Luno_PakFont(pak, index, load->glyphWidth, load->glyphHeight, true) : NULL;
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+            if (load->font)
+                return;
+        }
+
+        LunoImage *image = _Luno_ReadImage(load->path, true, &load->error);
+        if (!image || load->glyphWidth <= 0)
+        {
+            load->image = image;
+            return;
+        }
+
+        load->font = Luno_FontFromImage(image, load->glyphWidth, load->glyphHeight);
+        if (!load->font)
+        {
+            _Luno_FreeNewImage(image);
+            load->error = "Image does not split into the glyph layout";
+            return;
+        }
+        load->font->ownsImage = true;
+    }
+
+    // Stores the result of a load that ran without the lock and links it into the finished list.
+    static void _Luno_LoadFinish(int index, const _LunoLoad *result)
+    {
+        _LunoLoad *load = &_lunoLoader.loads[index];
+        load->image = result->image;
+        load->font = result->font;
+        load->error = result->error;
+        load->stage = _LUNO_LOAD_FINISHED;
+        load->next = -1;
+        if (_lunoLoader.finishedTail >= 0)
+            _lunoLoader.loads[_lunoLoader.finishedTail].next = index;
+        else
+            _lunoLoader.finishedHead = index;
+        _lunoLoader.finishedTail = index;
+        _Luno_CondBroadcast(&_lunoLoader.done);
+    }
+
+    static void _Luno_LoaderLoop(void)
+    {
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        for (;;)
+        {
+            while (!_lunoLoader.quit && _lunoLoader.heapCount == 0)
+                _Luno_CondWait(&_lunoLoader.wake, &_lunoLoader.mutex);
+            if (_lunoLoader.quit)
+                break;
+
+            int index = _lunoLoader.heap[0];
+            _Luno_HeapRemove(0);
+            _lunoLoader.loads[index].stage = _LUNO_LOAD_RUNNING;
+            _LunoLoad load = _lunoLoader.loads[index];
+
+            // The main thread may grow `loads` meanwhile but leaves a running load's path alone
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+            _Luno_RunLoad(&load);
+            _Luno_MutexLock(&_lunoLoader.mutex);
+
+            _Luno_LoadFinish(index, &load);
+        }
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+    }
+
+#ifdef _WIN32
+    static DWORD WINAPI _Luno_LoaderMain(LPVOID arg)
+    {
+        (void)arg;
+        _Luno_LoaderLoop();
+        return 0;
+    }
+#else
+    static void *_Luno_LoaderMain(void *arg)
+    {
+        (void)arg;
+        _Luno_LoaderLoop();
+        return NULL;
+    }
+#endif
+
+    // Queues a load filled in by the caller. Returns its handle, 0 if out of memory.
+    static int _Luno_LoaderQueue(const _LunoLoad *request)
+    {
+        if (!_lunoLoader.initialized)
+        {
+            _Luno_MutexInit(&_lunoLoader.mutex);
+            _Luno_CondInit(&_lunoLoader.wake);
+            _Luno_CondInit(&_lunoLoader.done);
+            _lunoLoader.freeList = -1;
+            _lunoLoader.finishedHead = -1;
+            _lunoLoader.finishedTail = -1;
+            _lunoLoader.initialized = true;
+        }
+
+        // Threads start with the first load, a failed start leaves the loads to Luno_WaitLoad
+        while (_lunoLoader.running < LUNO_LOAD_THREADS)
+        {
+            if (!_Luno_ThreadStart(&_lunoLoader.threads[_lunoLoader.running], _Luno_LoaderMain, NULL))
+                break;
+            _lunoLoader.running++;
+        }
+
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        int index = _lunoLoader.freeList;
+        if (index >= 0)
+        {
+            _lunoLoader.freeList = _lunoLoader.loads[index].next;
+        }
+        else
+        {
+            // Handles keep 20 bits for the index; every slot fits into the heap at once
+            if (_lunoLoader.count == 0xFFFFF)
+            {
+                _Luno_MutexUnlock(&_lunoLoader.mutex);
+                return 0;
+            }
+            if (_lunoLoader.count == _lunoLoader.capacity)
+            {
+                int capacity = _lunoLoader.capacity ? _lunoLoader.capacity * 2 : 64;
+                _LunoLoad *loads = (_LunoLoad *)LUNO_REALLOC(_lunoLoader.loads, capacity * sizeof(_LunoLoad));
+                if (loads)
+                    _lunoLoader.loads = loads;
+                int *heap = loads ? (int *)LUNO_REALLOC(_lunoLoader.heap, capacity * sizeof(int)) : NULL;
+                if (!heap)
+                {
+                    _Luno_MutexUnlock(&_lunoLoader.mutex);
+                    return 0;
+                }
+                _lunoLoader.heap = heap;
+                _lunoLoader.capacity = capacity;
+            }
+            index = _lunoLoader.count++;
+            _lunoLoader.loads[index].generation = 0;
+        }
 
-            break;
+        _LunoLoad *load = &_lunoLoader.loads[index];
+        int generation = load->generation;
+        *load = *request;
+        load->generation = generation;
+        load->state = LUNO_LOAD_PENDING;
+        load->stage = _LUNO_LOAD_QUEUED;
+        load->cancelled = false;
+        load->sequence = _lunoLoader.sequence++;
+        load->image = NULL;
+        load->font = NULL;
+        load->error = NULL;
+        load->next = -1;
+        _Luno_HeapPlace(_lunoLoader.heapCount++, index);
+        _Luno_HeapFix(load->heapIndex);
+        _Luno_CondBroadcast(&_lunoLoader.wake);
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+        return _Luno_LoadHandle(index);
+    }
+
+    // Makes a finished load visible to the game: its callback is called or its handle listed. Cancelled loads are
+    // destroyed instead.
+    static void _Luno_LoadDispatch(int index)
+    {
+        _LunoLoad *load = &_lunoLoader.loads[index];
+        if (load->cancelled)
+        {
+            Luno_DestroyImage(load->image);
+            Luno_DestroyFont(load->font);
+            _Luno_LoadFree(index);
+            return;
         }
 
-        case WM_MOUSEWHEEL:
+        load->state = (load->image || load->font) ? LUNO_LOAD_DONE : LUNO_LOAD_FAILED;
+        int handle = _Luno_LoadHandle(index);
+
+        // `load` may move from here on, callbacks can start loads
+        if (load->callback)
         {
-            _lunoContext.mouseWheelDelta += GET_WHEEL_DELTA_WPARAM(wParam) / WHEEL_DELTA;
-            break;
+            load->callback(handle, load->user);
+            return;
         }
+        if (_lunoLoader.dispatchedCount == _lunoLoader.dispatchedCapacity)
+        {
+            int capacity = _lunoLoader.dispatchedCapacity ? _lunoLoader.dispatchedCapacity * 2 : 64;
+            int *dispatched = (int *)LUNO_REALLOC(_lunoLoader.dispatched, capacity * sizeof(int));
+            if (!dispatched)
+                return;
+            _lunoLoader.dispatched = dispatched;
+            _lunoLoader.dispatchedCapacity = capacity;
+        }
+        _lunoLoader.dispatched[_lunoLoader.dispatchedCount++] = handle;
+    }
 
-        case WM_SETCURSOR:
-            if (_lunoContext.isCursorHidden && LOWORD(lParam) == HTCLIENT)
-            {
-                SetCursor(0);
-                break;
-            }
-            goto unhandled;
-        case WM_SIZE:
+    // Dispatches every load finished so far, one at a time so callbacks may wait for or cancel any load.
+    static void _Luno_LoaderDispatch(void)
+    {
+        _lunoLoader.dispatchedCount = 0;
+        for (;;)
         {
-            if (wParam != SIZE_MINIMIZED)
+            _Luno_MutexLock(&_lunoLoader.mutex);
+            int index = _lunoLoader.finishedHead;
+            if (index >= 0)
             {
-                // Update window dimensions
-                _lunoContext.windowWidth = LOWORD(lParam);
-                _lunoContext.windowHeight = HIWORD(lParam);
-
-                // Clear the window
-                RECT clientRect;
-                GetClientRect(hwnd, &clientRect);
-                HBRUSH brush = CreateSolidBrush(RGB(_lunoContext.clearColor.r, _lunoContext.clearColor.g, _lunoContext.clearColor.b));
-                FillRect(_lunoContext.hdc, &clientRect, brush);
-                DeleteObject(brush);
-
-                // Redraw the window with the updated size
-                RedrawWindow(hwnd, NULL, NULL, RDW_INVALIDATE | RDW_UPDATENOW);
+                _lunoLoader.finishedHead = _lunoLoader.loads[index].next;
+                if (_lunoLoader.finishedHead < 0)
+                    _lunoLoader.finishedTail = -1;
             }
-            break;
-        }
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
 
-        case WM_CLOSE:
-        case WM_QUIT:
-            PostQuitMessage(0);
-            break;
-        default:
-        unhandled:
-            return DefWindowProc(hwnd, message, wParam, lParam);
+            if (index < 0)
+                break;
+            _Luno_LoadDispatch(index);
         }
-        return 0;
     }
 
-    static void _Luno_BlitImage(LunoImage *dst, LunoImage *src, int x, int y)
+    // Stops the threads once their current loads finished and destroys every result nobody took.
+    static void _Luno_LoaderRelease(void)
     {
-        for (int j = 0; j < src->height; j++)
-        {
-            int dstY = y + j;
-            if (dstY < 0 || dstY >= dst->height)
-                continue; // Skip rows outside the destination bounds
+        if (!_lunoLoader.initialized)
+            return;
 
-            for (int i = 0; i < src->width; i++)
-            {
-                int dstX = x + i;
-                if (dstX < 0 || dstX >= dst->width)
-                    continue; // Skip columns outside the destination bounds
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        _lunoLoader.quit = true;
+        _Luno_CondBroadcast(&_lunoLoader.wake);
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+        for (int i = 0; i < _lunoLoader.running; i++)
+            _Luno_ThreadJoin(_lunoLoader.threads[i]);
 
-                LunoColor *dstPixel = &dst->pixels[dstX + dstY * dst->width];
-                LunoColor srcPixel = src->pixels[i + j * src->width];
-                *dstPixel = _Luno_BlendPixel(*dstPixel, srcPixel);
-            }
+        for (int i = 0; i < _lunoLoader.count; i++)
+        {
+            _LunoLoad *load = &_lunoLoader.loads[i];
+            if (load->state == LUNO_LOAD_NONE)
+                continue;
+            Luno_DestroyImage(load->image);
+            Luno_DestroyFont(load->font);
+            LUNO_FREE(load->path);
         }
+        LUNO_FREE(_lunoLoader.loads);
+        LUNO_FREE(_lunoLoader.heap);
+        LUNO_FREE(_lunoLoader.dispatched);
+
+        // The mutex and condition variables stay initialized for the next Luno_Create
+        _lunoLoader.running = 0;
+        _lunoLoader.quit = false;
+        _lunoLoader.loads = NULL;
+        _lunoLoader.count = _lunoLoader.capacity = 0;
+        _lunoLoader.freeList = -1;
+        _lunoLoader.heap = NULL;
+        _lunoLoader.heapCount = 0;
+        _lunoLoader.finishedHead = _lunoLoader.finishedTail = -1;
+        _lunoLoader.dispatched = NULL;
+        _lunoLoader.dispatchedCount = _lunoLoader.dispatchedCapacity = 0;
     }
 
-    // Function to convert pixels loaded from rc_load_tga to LunoImage
-    LunoImage *_ConvertPixelsToLunoImage(unsigned char *pixels, int width, int height)
+    // --- Timer Wheel ---
+    // Level L of the wheel has 64 slots of 64^L milliseconds. A timer is linked into the slot its expiry falls in on
+    // the lowest level that reaches that far and moves down a level when the wheel reaches the start of its slot.
+    // Starting, cancelling and expiring a timer are O(1), and advancing touches the slots passed rather than every
+    // timer; runs of empty slots are skipped using the occupancy bits.
+
+    // Milliseconds since Luno_Create of the current frame.
+    static long long _Luno_FrameTick(void)
     {
-        // Create a new LunoImage
-        LunoImage *image = (LunoImage *)malloc(sizeof(LunoImage));
-        if (!image)
-            return NULL;
+        return (long long)((_lunoContext.prevTime - _lunoContext.startTime) * 1000);
+    }
 
-        image->width = width;
-        image->height = height;
+    static int _Luno_WheelHandle(int index)
+    {
+        return (_lunoWheel.timers[index].generation << 20) | (index + 1);
+    }
+
+    // Index of the timer behind a handle, -1 if it expired or was cancelled.
+    static int _Luno_WheelFind(int handle)
+    {
+        int index = (handle & 0xFFFFF) - 1;
+        if (handle <= 0 || index < 0 || index >= _lunoWheel.count)
+            return -1;
+        if (_lunoWheel.timers[index].list < 0 || _Luno_WheelHandle(index) != handle)
+            return -1;
+        return index;
+    }
+
+    static void _Luno_WheelLink(int index, int list)
+    {
+        _LunoWheelTimer *timer = &_lunoWheel.timers[index];
+        timer->list = list;
+        timer->prev = -1;
+        timer->next = _lunoWheel.heads[list];
+        if (timer->next >= 0)
+            _lunoWheel.timers[timer->next].prev = index;
+        _lunoWheel.heads[list] = index;
+        if (list < LUNO_WHEEL_PENDING)
+            _lunoWheel.occupied[list >> 6] |= 1ULL << (list & 63);
+    }
+
+    static void _Luno_WheelUnlink(int index)
+    {
+        _LunoWheelTimer *timer = &_lunoWheel.timers[index];
+        int list = timer->list;
+        if (timer->prev >= 0)
+            _lunoWheel.timers[timer->prev].next = timer->next;
+        else
+            _lunoWheel.heads[list] = timer->next;
+        if (timer->next >= 0)
+            _lunoWheel.timers[timer->next].prev = timer->prev;
+        if (_lunoWheel.heads[list] < 0 && list < LUNO_WHEEL_PENDING)
+            _lunoWheel.occupied[list >> 6] &= ~(1ULL << (list & 63));
+        timer->list = -1;
+    }
+
+    // Links a timer into the slot of its expiry on the lowest level that reaches it. Expiries beyond the top level
+    // are parked in its furthest slot and placed again when the wheel gets there.
+    static void _Luno_WheelSchedule(int index)
+    {
+        long long when = _lunoWheel.timers[index].expires;
+        long long delta = when - _lunoWheel.now;
+        long long reach = 1LL << (6 * LUNO_WHEEL_LEVELS);
+        if (delta >= reach)
+            when = _lunoWheel.now + reach - 1;
+
+        int level = 0;
+        while (level < LUNO_WHEEL_LEVELS - 1 && delta >= 1LL << (6 * (level + 1)))
+            level++;
+        _Luno_WheelLink(index, level * 64 + (int)((when >> (6 * level)) & 63));
+    }
+
+    static void _Luno_WheelFree(int index)
+    {
+        _LunoWheelTimer *timer = &_lunoWheel.timers[index];
+        timer->generation = (timer->generation + 1) & 0x7FF;
+        timer->list = -1;
+        timer->next = _lunoWheel.freeList;
+        _lunoWheel.freeList = index;
+    }
+
+    static void _Luno_WheelExpire(int index)
+    {
+        _LunoWheelTimer *timer = &_lunoWheel.timers[index];
+        int handle = _Luno_WheelHandle(index);
+        void (*callback)(int timer, void *user) = timer->callback;
+        void *user = timer->user;
 
-        // Allocate memory for the new pixel array
-        image->pixels = (LunoColor *)malloc(sizeof(LunoColor) * image->width * image->height);
-        if (image->pixels == NULL)
+        if (timer->interval > 0)
         {
-            fprintf(stderr, "Failed to allocate memory for LunoImage pixels.\n");
-            exit(1);
+            timer->expires += timer->interval;
+            _Luno_WheelSchedule(index);
         }
+        else
+        {
+            _Luno_WheelFree(index);
+        }
+
+        // `timer` may move from here on, callbacks can start timers
+        if (callback)
+        {
+            callback(handle, user);
+            return;
+        }
+        if (_lunoWheel.expiredCount == _lunoWheel.expiredCapacity)
+        {
+            int capacity = _lunoWheel.expiredCapacity ? _lunoWheel.expiredCapacity * 2 : 64;
+            int *expired = (int *)LUNO_REALLOC(_lunoWheel.expired, capacity * sizeof(int));
+            if (!expired)
+                return;
+            _lunoWheel.expired = expired;
+            _lunoWheel.expiredCapacity = capacity;
+        }
+        _lunoWheel.expired[_lunoWheel.expiredCount++] = handle;
+    }
 
-        // Convert pixel data from rcTga to LunoImage
-        for (int y = 0; y < height; y++)
+    // Advances the wheel to `tick`, expiring every timer due on the way.
+    static void _Luno_WheelAdvance(long long tick)
+    {
+        _lunoWheel.expiredCount = 0;
+        while (_lunoWheel.now < tick)
         {
-            for (int x = 0; x < width; x++)
+            // Nothing happens before the next slot start of the lowest occupied level
+            int level = 0;
+            while (level < LUNO_WHEEL_LEVELS && !_lunoWheel.occupied[level])
+                level++;
+            long long span = 1LL << (6 * level);
+            long long next = level < LUNO_WHEEL_LEVELS ? (_lunoWheel.now / span + 1) * span : tick;
+            if (next > tick)
+                next = tick;
+            _lunoWheel.now = next;
+
+            // Move the timers of every slot starting here down, highest level first
+            for (int l = LUNO_WHEEL_LEVELS - 1; l > 0; l--)
+            {
+                if (next & ((1LL << (6 * l)) - 1))
+                    continue;
+                int list = l * 64 + (int)((next >> (6 * l)) & 63);
+                while (_lunoWheel.heads[list] >= 0)
+                {
+                    int index = _lunoWheel.heads[list];
+                    _Luno_WheelUnlink(index);
+                    _Luno_WheelSchedule(index);
+                }
+            }
+
+            // Expire the level 0 slot through the pending list, so callbacks may cancel any timer
+            int slot = (int)(next & 63);
+            while (_lunoWheel.heads[slot] >= 0)
             {
-                int index = (y * width + x) * 4; // 4 bytes per pixel (RGBA)
-                image->pixels[y * width + x].r = pixels[index + 0];
-                image->pixels[y * width + x].g = pixels[index + 1];
-                image->pixels[y * width + x].b = pixels[index + 2];
-                image->pixels[y * width + x].a = pixels[index + 3];
+                int index = _lunoWheel.heads[slot];
+                _Luno_WheelUnlink(index);
+                _Luno_WheelLink(index, LUNO_WHEEL_PENDING);
+            }
+            while (_lunoWheel.heads[LUNO_WHEEL_PENDING] >= 0)
+            {
+                int index = _lunoWheel.heads[LUNO_WHEEL_PENDING];
+                _Luno_WheelUnlink(index);
+                _Luno_WheelExpire(index);
             }
         }
+    }
 
-        return image;
+    static void _Luno_WheelRelease(void)
+    {
+        LUNO_FREE(_lunoWheel.timers);
+        LUNO_FREE(_lunoWheel.expired);
+        memset(&_lunoWheel, 0, sizeof(_lunoWheel));
     }
 
     // --- Public Interface Implementation ---
@@ -544,52 +5071,39 @@ extern "C"
         }
 
         _lunoContext.isCursorHidden = false;
-
-        WNDCLASSA wc = {0};
-        wc.lpfnWndProc = _LunoWindowProc;
-        wc.hInstance = GetModuleHandle(NULL);
-        wc.lpszClassName = title;
-
-        if (!RegisterClassA(&wc))
-        {
-            return false;
-        }
-
         _lunoContext.title = title;
 
-        _lunoContext.hwnd = CreateWindowA(
-            title,
-            title,
-            WS_OVERLAPPEDWINDOW | WS_VISIBLE,
-            CW_USEDEFAULT, CW_USEDEFAULT, width, height,
-            NULL, NULL, GetModuleHandle(NULL), NULL);
-
-        if (!_lunoContext.hwnd)
+        if (!_Luno_PlatformCreate(title, width, height))
         {
             return false;
         }
 
-        _lunoContext.hdc = GetDC(_lunoContext.hwnd);
-
         // Initialize back buffer
         _lunoContext.backbuffer.width = width;
         _lunoContext.backbuffer.height = height;
-        _lunoContext.backbuffer.pixels = (LunoColor *)calloc(width * height, sizeof(LunoColor));
+        _lunoContext.backbuffer.pitch = width;
+        _lunoContext.backbuffer.pixels = (LunoColor *)_Luno_AlignedAlloc((size_t)width * height * sizeof(LunoColor));
         if (!_lunoContext.backbuffer.pixels)
         {
             return false;
         }
+        memset(_lunoContext.backbuffer.pixels, 0, (size_t)width * height * sizeof(LunoColor));
 
         _lunoContext.windowWidth = width;
         _lunoContext.windowHeight = height;
         _lunoContext.clearColor = (LunoColor){0, 0, 0, 0};
-        _lunoContext.prevTime = 0;
         _lunoContext.startTime = _Luno_Now();
+        _lunoContext.prevTime = _lunoContext.startTime;
+        _lunoContext.accumulator = 0;
 
         lunoFPS = 0;
         lunoDT = 0;
         lunoMS = 0;
 
+        // The first frame is presented whole
+        _lunoContext.partialPresent = true;
+        _Luno_MarkAllDirty();
+
         // Load the default font
         _lunoContext.defaultFont = Luno_LoadFontMem(_lunoFontImageData, _lunoFontImageDataSize, _lunoFontWidth, _lunoFontHeight);
         _lunoContext.currentFont = _lunoContext.defaultFont;
@@ -597,313 +5111,697 @@ extern "C"
         return true;
     }
 
-    void Luno_Close()
+    void Luno_Close()
+    {
+        // Recorded draws die with the backbuffer
+        _lunoContext.frame.size = 0;
+        _lunoContext.frame.count = 0;
+        _Luno_PoolStop();
+
+        if (_lunoContext.currentFont == _lunoContext.defaultFont)
+            _lunoContext.currentFont = NULL;
+        Luno_DestroyFont(_lunoContext.defaultFont);
+        _lunoContext.defaultFont = NULL;
+
+        // Present what is still queued, then release the extra frame buffers
+        _Luno_PresentStop();
+        for (int i = 0; i < _lunoPresent.count; i++)
+        {
+            if (_lunoPresent.frames[i].image.pixels != _lunoContext.backbuffer.pixels)
+                _Luno_AlignedFree(_lunoPresent.frames[i].image.pixels);
+        }
+        _lunoPresent.count = 0;
+        _lunoPresent.restore = false;
+
+        _Luno_WheelRelease();
+        _Luno_LoaderRelease();
+
+        // Clean up custom back buffer
+        if (_lunoContext.backbuffer.pixels)
+        {
+            _Luno_AlignedFree(_lunoContext.backbuffer.pixels);
+            _lunoContext.backbuffer.pixels = NULL;
+        }
+        _Luno_PlatformClose();
+    }
+
+    void Luno_SetWindowScale(int factor)
+    {
+        if (factor <= 0)
+        {
+            return; // Invalid factor
+        }
+
+        // Calculate the new dimensions
+        int newWidth = _lunoContext.backbuffer.width * factor;
+        int newHeight = _lunoContext.backbuffer.height * factor;
+
+        // Update the window size
+        _Luno_PlatformSetWindowSize(newWidth, newHeight);
+
+        // Update _lunoContext values
+        _lunoContext.windowWidth = newWidth;
+        _lunoContext.windowHeight = newHeight;
+    }
+
+    void Luno_Clear()
+    {
+        if (!_lunoContext.backbuffer.pixels)
+        {
+            printf("ERROR <Luno_Clear>: No window! Create a window first!");
+            exit(0);
+        }
+
+        // Fill directly: the backbuffer is drawn into afterwards, so it keeps the conservative alpha class
+        LunoRect bounds = {0, 0, _lunoContext.backbuffer.width, _lunoContext.backbuffer.height};
+        if (_Luno_EncodeCommand(_LUNO_DRAW_CLEAR, bounds, _Luno_ToPixel(_lunoContext.clearColor), false, 0))
+            _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
+    }
+
+    void Luno_SetClearColor(LunoColor color)
+    {
+        _lunoContext.clearColor = color;
+    }
+
+    void Luno_DrawPixel(int x, int y, LunoColor color)
+    {
+        if (color.a <= 0)
+            return; // Skip fully transparent pixels
+
+        if (_Luno_EncodeCommand(_LUNO_DRAW_PIXEL, (LunoRect){x, y, 1, 1}, _Luno_ToPixel(color), false, 0))
+            _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
+    }
+
+    LunoColor Luno_GetPixel(LunoImage *image, int x, int y)
+    {
+        if (!image || x < 0 || y < 0 || x >= image->width || y >= image->height)
+        {
+            // Return a fully transparent color for invalid coordinates or null image
+            return (LunoColor){0, 0, 0, 0};
+        }
+
+        if (image == &_lunoContext.backbuffer)
+            _Luno_FlushDraws();
+
+        return _Luno_FromPixel(image->pixels[x + y * _Luno_Pitch(image)]);
+    }
+
+    LunoImage *Luno_CreateImage(int width, int height)
+    {
+        LunoImage *image = _Luno_AllocImage(width, height, true);
+        if (!image)
+            return NULL;
+
+        image->alphaClass = LUNO_ALPHA_TRANSLUCENT; // Pixels are expected to be written directly
+        return image;
+    }
+
+    LunoImage *Luno_LoadImageMem(unsigned char *buffer, int bufferLen)
+    {
+        if (!buffer || bufferLen <= 0)
+        {
+            printf("ERROR <Luno_LoadImageMem>: Invalid image buffer!");
+            exit(0);
+        }
+
+        LunoImage *image = _Luno_LoadImageData(buffer, bufferLen, false);
+        if (!image)
+        {
+            printf("ERROR <Luno_LoadImageMem>: Unable to load image data!");
+            exit(0);
+        }
+        return image;
+    }
+
+    LunoImage *Luno_LoadImage(const char *filePath)
+    {
+        if (!filePath)
+        {
+            printf("ERROR <Luno_LoadImage>: No image path provided!");
+            exit(0);
+        }
+
+        const char *error;
+        LunoImage *image = _Luno_ReadImage(filePath, false, &error);
+        if (!image)
+        {
+            printf("ERROR <Luno_LoadImage>: %s!", error);
+            exit(0);
+        }
+        return image;
+    }
+
+    bool Luno_SaveImage(LunoImage *image, const char *filePath)
+    {
+        if (!image || !image->pixels || !filePath || image->width <= 0 || image->height <= 0)
+            return false;
+        _Luno_FlushDraws(); // Recorded draws may still write its pixels
+
+        size_t size;
+        unsigned char *data = _Luno_EncodeQoi(image, &size);
+        if (!data)
+            return false;
+
+        FILE *file = fopen(filePath, "wb");
+        bool written = file && fwrite(data, 1, size, file) == size;
+        if (file && fclose(file) != 0)
+            written = false;
+        LUNO_FREE(data);
+        return written;
+    }
+
+    void Luno_FillImage(LunoImage *image, LunoColor color)
+    {
+        if (!image || !image->pixels)
+        {
+            printf("ERROR <Luno_FillImage>: Invalid image!");
+            exit(0);
+        }
+
+        _Luno_FlushDraws(); // Recorded draws may still read the old pixels
+
+        LunoColor pixel = _Luno_ToPixel(color);
+        int count = image->width * image->height;
+        int pitch = _Luno_Pitch(image);
+        _LunoFillJob job = {image->pixels, pixel, (size_t)count * sizeof(LunoColor) >= LUNO_STREAM_THRESHOLD, image->width, pitch};
+        if (pitch == image->width)
+            Luno_ParallelFor(count, LUNO_PARALLEL_THRESHOLD, _Luno_FillBand, &job);
+        else
+            Luno_ParallelFor(image->height, _Luno_RowGrain(image->width), _Luno_FillRowBand, &job);
+        image->alphaClass = _Luno_ClassifyAlpha(&pixel, 1);
+
+        // A view may have made its parents less opaque
+        for (LunoImage *parent = image->parent; parent; parent = parent->parent)
+        {
+            if (image->alphaClass < parent->alphaClass)
+                parent->alphaClass = image->alphaClass;
+        }
+    }
+
+    void Luno_ConvertPixels(void *dst, LunoPixelFormat dstFormat, const void *src, LunoPixelFormat srcFormat, int count)
+    {
+        if (!dst || !src || count <= 0)
+            return;
+
+        _LunoConvertJob job = {dst, dstFormat, src, srcFormat};
+        Luno_ParallelFor(count, LUNO_PARALLEL_THRESHOLD, _Luno_ConvertBand, &job);
+    }
+
+    void Luno_UpdateImageAlpha(LunoImage *image)
+    {
+        if (!image || !image->pixels)
+            return;
+        _Luno_FlushDraws(); // Recorded blits were submitted with the old alpha class
+        image->alphaClass = _Luno_ClassifyImage(image);
+    }
+
+    void Luno_DrawImage(LunoImage *image, int x, int y)
     {
-        // Clean up custom back buffer
-        if (_lunoContext.backbuffer.pixels)
+        if (!image || !image->pixels)
         {
-            free(_lunoContext.backbuffer.pixels);
-            _lunoContext.backbuffer.pixels = NULL;
+            printf("ERROR <Luno_DrawImage>: Invalid image!");
+            exit(0);
         }
-        if (_lunoContext.hdc)
+
+        Luno_DrawImageRect(image, x, y, (LunoRect){0, 0, image->width, image->height});
+    }
+
+    void Luno_DrawImageRect(LunoImage *image, int x, int y, LunoRect srcRect)
+    {
+        if (!image || !image->pixels)
         {
-            ReleaseDC(_lunoContext.hwnd, _lunoContext.hdc);
-            _lunoContext.hdc = NULL;
+            printf("ERROR <Luno_DrawImageRect>: Invalid image!");
+            exit(0);
         }
-        if (_lunoContext.hwnd)
+
+        // Clip the source once here, so the command only keeps the visible part
+        LunoRect clipped = srcRect;
+        if (!_Luno_ClipRect(&clipped, image->width, image->height))
+            return;
+        LunoRect bounds = {x + clipped.x - srcRect.x, y + clipped.y - srcRect.y, clipped.w, clipped.h};
+        _LunoImageArgs *args = (_LunoImageArgs *)_Luno_EncodeCommand(_LUNO_DRAW_IMAGE, bounds, (LunoColor){0}, false, sizeof(_LunoImageArgs));
+        if (!args)
+            return;
+        LunoRect visible = ((const _LunoCommand *)_lunoContext.scratch.data)->bounds;
+        args->image = image;
+        args->srcX = clipped.x + visible.x - bounds.x;
+        args->srcY = clipped.y + visible.y - bounds.y;
+        _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
+    }
+
+    void Luno_DestroyImage(LunoImage *image)
+    {
+        if (!image)
+            return;
+        _Luno_FlushDraws();
+        if (!image->arena)
         {
-            DestroyWindow(_lunoContext.hwnd);
-            _lunoContext.hwnd = NULL;
+            _Luno_AlignedFree(image);
+            return;
         }
-        UnregisterClassA(_lunoContext.title, GetModuleHandle(NULL));
+        // The memory goes back with the arena
+        image->pixels = NULL;
+        image->width = 0;
+        image->height = 0;
     }
 
-    void Luno_SetWindowScale(int factor)
+    LunoImage *Luno_CreateImageView(LunoImage *image, LunoRect rect)
     {
-        if (factor <= 0)
+        if (!image || !image->pixels)
         {
-            return; // Invalid factor
+            printf("ERROR <Luno_CreateImageView>: Invalid image!");
+            exit(0);
         }
 
-        // Calculate the new dimensions
-        int newWidth = _lunoContext.backbuffer.width * factor;
-        int newHeight = _lunoContext.backbuffer.height * factor;
+        if (!_Luno_ClipRect(&rect, image->width, image->height))
+            rect = (LunoRect){0, 0, 0, 0};
+        LunoImage *view = _Luno_AllocImage(0, 0, false);
+        if (!view)
+            return NULL;
 
-        // Update the window size
-        SetWindowPos(
-            _lunoContext.hwnd,
-            NULL,
-            0, 0,
-            newWidth,
-            newHeight,
-            SWP_NOMOVE | SWP_NOZORDER | SWP_NOACTIVATE);
+        view->pitch = _Luno_Pitch(image);
+        view->pixels = image->pixels + rect.x + (size_t)rect.y * view->pitch;
+        view->width = rect.w;
+        view->height = rect.h;
+        view->parent = image;
+        // Parts of an opaque image are opaque, others may be more opaque than the whole
+        view->alphaClass = image->alphaClass == LUNO_ALPHA_OPAQUE ? LUNO_ALPHA_OPAQUE : _Luno_ClassifyImage(view);
+        return view;
+    }
 
-        // Update _lunoContext values
-        _lunoContext.windowWidth = newWidth;
-        _lunoContext.windowHeight = newHeight;
+    int Luno_SliceImage(LunoImage *image, int frameWidth, int frameHeight, LunoImage **views, int maxViews)
+    {
+        if (!image || frameWidth <= 0 || frameHeight <= 0)
+            return 0;
+
+        int columns = image->width / frameWidth;
+        int count = columns * (image->height / frameHeight);
+        for (int i = 0; views && i < count && i < maxViews; i++)
+        {
+            LunoRect frame = {(i % columns) * frameWidth, (i / columns) * frameHeight, frameWidth, frameHeight};
+            views[i] = Luno_CreateImageView(image, frame);
+        }
+        return count;
     }
 
-    void Luno_Clear()
+    LunoImageArena *Luno_CreateImageArena(int blockSize)
     {
-        Luno_FillImage(&_lunoContext.backbuffer, _lunoContext.clearColor);
+        LunoImageArena *arena = (LunoImageArena *)LUNO_CALLOC(1, sizeof(LunoImageArena));
+        if (!arena)
+            return NULL;
+        arena->blockSize = _Luno_AlignSize(blockSize > 0 ? (size_t)blockSize : 4 * 1024 * 1024);
+        return arena;
     }
 
-    void Luno_SetClearColor(LunoColor color)
+    void Luno_SetImageArena(LunoImageArena *arena)
     {
-        _lunoContext.clearColor = color;
+        _lunoContext.imageArena = arena;
     }
 
-    void Luno_DrawPixel(int x, int y, LunoColor color)
+    void Luno_ResetImageArena(LunoImageArena *arena)
     {
-        if (color.a <= 0)
-            return; // Skip fully transparent pixels
+        if (!arena)
+            return;
+        _Luno_FlushDraws();
 
-        if (x < 0 || y < 0 || x >= _lunoContext.backbuffer.width || y >= _lunoContext.backbuffer.height)
+        // Keep one regular block, oversized ones are unlikely to fit the next images
+        _LunoArenaBlock *kept = NULL;
+        _LunoArenaBlock *block = arena->blocks;
+        while (block)
         {
-            return;
+            _LunoArenaBlock *next = block->next;
+            if (!kept && block->size == arena->blockSize)
+                kept = block;
+            else
+                _Luno_AlignedFree(block);
+            block = next;
         }
-
-        LunoColor *pixel = &_lunoContext.backbuffer.pixels[x + y * _lunoContext.backbuffer.width];
-        LunoColor src = {color.b, color.g, color.r, color.a}; // Convert LunoColor to LunoPixel
-        *pixel = _Luno_BlendPixel(*pixel, src);
-    }
-
-    LunoColor Luno_GetPixel(LunoImage *image, int x, int y)
-    {
-        if (!image || x < 0 || y < 0 || x >= image->width || y >= image->height)
+        if (kept)
         {
-            // Return a fully transparent color for invalid coordinates or null image
-            return (LunoColor){0, 0, 0, 0};
+            kept->next = NULL;
+            kept->used = 0;
         }
-
-        LunoColor *pixel = &image->pixels[x + y * image->width];
-        return (LunoColor){pixel->r, pixel->g, pixel->b, pixel->a};
+        arena->blocks = kept;
     }
 
-    LunoImage *Luno_CreateImage(int width, int height)
+    void Luno_DestroyImageArena(LunoImageArena *arena)
     {
-        LunoImage *image = (LunoImage *)malloc(sizeof(LunoImage));
-        if (!image)
-            return NULL;
-
-        image->width = width;
-        image->height = height;
-        image->pixels = (LunoColor *)calloc(width * height, sizeof(LunoColor));
-        if (!image->pixels)
-        {
-            image->width = 0;
-            image->height = 0;
-        }
-        return image;
+        if (!arena)
+            return;
+        Luno_ResetImageArena(arena);
+        _Luno_AlignedFree(arena->blocks);
+        if (_lunoContext.imageArena == arena)
+            _lunoContext.imageArena = NULL;
+        LUNO_FREE(arena);
     }
 
-    LunoImage *Luno_LoadImageMem(unsigned char *buffer, int bufferLen)
+    LunoPak *Luno_OpenPak(const char *filePath)
     {
-        if (!buffer || bufferLen <= 0)
+        if (!filePath)
         {
-            printf("ERROR <Luno_LoadImageMem>: Invalid image buffer!");
+            printf("ERROR <Luno_OpenPak>: No bundle path provided!");
             exit(0);
         }
 
-        int width;
-        int height;
-        unsigned char *data = rc_load_tga_mem(buffer, bufferLen, &width, &height);
-        if (!data)
+        LunoPak *pak = (LunoPak *)LUNO_CALLOC(1, sizeof(LunoPak));
+        if (!pak)
         {
-            printf("ERROR <Luno_LoadImageMem>: Unable to load image data!");
+            printf("ERROR <Luno_OpenPak>: Out of memory!");
             exit(0);
         }
 
-        LunoImage *image = _ConvertPixelsToLunoImage(data, width, height);
-        if (!image)
+        // Copy-on-write, so images from the bundle can be drawn into like any other
+        if (!_Luno_OpenFileView(filePath, &pak->file, true))
         {
-            free(data);
-            printf("ERROR <Luno_LoadImageMem>: Unable to convert pixel data to LunoImage!");
+            printf("ERROR <Luno_OpenPak>: Unable to read bundle file!");
             exit(0);
         }
 
-        free(data);
-        return image;
-    }
-
-    LunoImage *Luno_LoadImage(const char *filePath)
-    {
-        if (!filePath)
+        if (!_Luno_CheckPak(&pak->file))
         {
-            printf("ERROR <Luno_LoadImage>: No image path provided!");
+            printf("ERROR <Luno_OpenPak>: Invalid bundle file!");
             exit(0);
         }
 
-        int width;
-        int height;
-        unsigned char *data = rc_load_tga(filePath, &width, &height);
+        const _LunoPakHeader *header = (const _LunoPakHeader *)pak->file.data;
+#ifdef LUNO_PREMULTIPLIED
+        bool premultiplied = true;
+#else
+        bool premultiplied = false;
+#endif
+        if (((header->flags & LUNO_PAK_PREMULTIPLIED) != 0) != premultiplied)
+        {
+            printf("ERROR <Luno_OpenPak>: Bundle was packed with a different LUNO_PREMULTIPLIED setting!");
+            exit(0);
+        }
 
-        LunoImage *image = _ConvertPixelsToLunoImage(data, width, height);
-        if (!image)
+        pak->entries = (const _LunoPakEntry *)(header + 1);
+        pak->count = (int)header->count;
+        pak->images = (LunoImage *)LUNO_CALLOC(pak->count > 0 ? pak->count : 1, sizeof(LunoImage));
+        if (!pak->images)
         {
-            free(data);
-            printf("ERROR <Luno_LoadImage>: Unable to convert pixel data to LunoImage!");
+            printf("ERROR <Luno_OpenPak>: Out of memory!");
             exit(0);
         }
 
-        free(data);
-        return image;
+        // Offsets become pointers into the mapping; nothing is decoded
+        for (int i = 0; i < pak->count; i++)
+        {
+            const _LunoPakEntry *entry = &pak->entries[i];
+            LunoImage *image = &pak->images[i];
+            image->pixels = (LunoColor *)(pak->file.data + entry->pixelOffset);
+            image->width = (int)entry->width;
+            image->height = (int)entry->height;
+            image->alphaClass = (LunoAlphaClass)entry->alphaClass;
+            image->format = LUNO_FORMAT_NATIVE;
+            image->pitch = image->width;
+        }
+
+        if (_lunoLoader.initialized)
+            _Luno_MutexLock(&_lunoLoader.mutex);
+        pak->next = _lunoContext.paks;
+        _lunoContext.paks = pak;
+        if (_lunoLoader.initialized)
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+        return pak;
     }
 
-    void Luno_FillImage(LunoImage *image, LunoColor color)
+    void Luno_ClosePak(LunoPak *pak)
     {
-        if (!image || !image->pixels)
-        {
-            printf("ERROR <Luno_FillImage>: Invalid image!");
-            exit(0);
-        }
+        if (!pak)
+            return;
+        _Luno_FlushDraws(); // Recorded draws may still read its pixels
 
-        LunoColor pixel = {color.b, color.g, color.r, color.a};
-        for (int i = 0; i < image->width * image->height; i++)
+        // Background loads look paths up under the loader's lock
+        if (_lunoLoader.initialized)
+            _Luno_MutexLock(&_lunoLoader.mutex);
+        for (LunoPak **link = &_lunoContext.paks; *link; link = &(*link)->next)
         {
-            image->pixels[i] = pixel;
+            if (*link == pak)
+            {
+                *link = pak->next;
+                break;
+            }
         }
+        if (_lunoLoader.initialized)
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+
+        _Luno_CloseFileView(&pak->file);
+        LUNO_FREE(pak->images);
+        LUNO_FREE(pak);
     }
 
-    void Luno_DrawImage(LunoImage *image, int x, int y)
+    int Luno_LoadImageAsync(const char *filePath, int priority, void (*callback)(int load, void *user), void *user)
     {
-        _Luno_BlitImage(&_lunoContext.backbuffer, image, x, y);
+        if (!filePath)
+            return 0;
+
+        _LunoLoad request = {LUNO_LOAD_NONE};
+        request.path = (char *)LUNO_MALLOC(strlen(filePath) + 1);
+        if (!request.path)
+            return 0;
+        strcpy(request.path, filePath);
+        request.priority = priority;
+        request.callback = callback;
+        request.user = user;
+
+        int load = _Luno_LoaderQueue(&request);
+        if (!load)
+            LUNO_FREE(request.path);
+        return load;
     }
 
-    void Luno_DrawImageRect(LunoImage *image, int x, int y, LunoRect srcRect)
+    int Luno_LoadImageMemAsync(unsigned char *buffer, int bufferLen, int priority, void (*callback)(int load, void *user), void *user)
     {
-        if (!image || !image->pixels)
+        if (!buffer || bufferLen <= 0)
+            return 0;
+
+        _LunoLoad request = {LUNO_LOAD_NONE};
+        request.buffer = buffer;
+        request.bufferLen = bufferLen;
+        request.priority = priority;
+        request.callback = callback;
+        request.user = user;
+        return _Luno_LoaderQueue(&request);
+    }
+
+    int Luno_LoadFontAsync(const char *filePath, int glyphWidth, int glyphHeight, int priority, void (*callback)(int load, void *user), void *user)
+    {
+        if (!filePath || glyphWidth <= 0 || glyphHeight <= 0)
+            return 0;
+
+        _LunoLoad request = {LUNO_LOAD_NONE};
+        request.path = (char *)LUNO_MALLOC(strlen(filePath) + 1);
+        if (!request.path)
+            return 0;
+        strcpy(request.path, filePath);
+        request.glyphWidth = glyphWidth;
+        request.glyphHeight = glyphHeight;
+        request.priority = priority;
+        request.callback = callback;
+        request.user = user;
+
+        int load = _Luno_LoaderQueue(&request);
+        if (!load)
+            LUNO_FREE(request.path);
+        return load;
+    }
+
+    LunoLoadState Luno_GetLoadState(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        return (index >= 0) ? _lunoLoader.loads[index].state : LUNO_LOAD_NONE;
+    }
+
+    const char *Luno_GetLoadError(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0 || _lunoLoader.loads[index].state != LUNO_LOAD_FAILED)
+            return NULL;
+        return _lunoLoader.loads[index].error;
+    }
+
+    LunoImage *Luno_TakeLoadedImage(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0 || _lunoLoader.loads[index].state == LUNO_LOAD_PENDING || _lunoLoader.loads[index].glyphWidth > 0)
+            return NULL;
+
+        LunoImage *image = _lunoLoader.loads[index].image;
+        _Luno_LoadFree(index);
+        return image;
+    }
+
+    LunoFont *Luno_TakeLoadedFont(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0 || _lunoLoader.loads[index].state == LUNO_LOAD_PENDING || _lunoLoader.loads[index].glyphWidth <= 0)
+            return NULL;
+
+        LunoFont *font = _lunoLoader.loads[index].font;
+        _Luno_LoadFree(index);
+        return font;
+    }
+
+    bool Luno_CancelLoad(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0)
+            return false;
+
+        _LunoLoad *entry = &_lunoLoader.loads[index];
+        if (entry->state != LUNO_LOAD_PENDING)
         {
-            printf("ERROR <Luno_DrawImageRect>: Invalid image!");
-            exit(0);
+            Luno_DestroyImage(entry->image);
+            Luno_DestroyFont(entry->font);
+            _Luno_LoadFree(index);
+            return true;
         }
 
-        // Clamp the source rectangle to the bounds of the image
-        int srcXEnd = min(srcRect.x + srcRect.w, image->width);
-        int srcYEnd = min(srcRect.y + srcRect.h, image->height);
+        // Running and finished loads are freed when they are dispatched. Loads from memory are waited for, so their
+        // buffer can go right away.
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        bool queued = (entry->stage == _LUNO_LOAD_QUEUED);
+        if (queued)
+            _Luno_HeapRemove(entry->heapIndex);
+        else
+            entry->cancelled = true;
+        while (!entry->path && entry->stage == _LUNO_LOAD_RUNNING)
+            _Luno_CondWait(&_lunoLoader.done, &_lunoLoader.mutex);
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+        if (queued)
+            _Luno_LoadFree(index);
+        return true;
+    }
+
+    bool Luno_SetLoadPriority(int load, int priority)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0)
+            return false;
 
-        for (int j = srcRect.y; j < srcYEnd; j++)
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        _LunoLoad *entry = &_lunoLoader.loads[index];
+        bool queued = (entry->state == LUNO_LOAD_PENDING && entry->stage == _LUNO_LOAD_QUEUED);
+        if (queued)
         {
-            int dstY = y + (j - srcRect.y);
-            if (dstY < 0 || dstY >= _lunoContext.backbuffer.height)
-                continue; // Skip rows outside the backbuffer bounds
+            entry->priority = priority;
+            _Luno_HeapFix(entry->heapIndex);
+        }
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+        return queued;
+    }
 
-            for (int i = srcRect.x; i < srcXEnd; i++)
-            {
-                int dstX = x + (i - srcRect.x);
-                if (dstX < 0 || dstX >= _lunoContext.backbuffer.width)
-                    continue; // Skip columns outside the backbuffer bounds
+    bool Luno_WaitLoad(int load)
+    {
+        int index = _Luno_LoadFind(load);
+        if (index < 0)
+            return false;
+        if (_lunoLoader.loads[index].state != LUNO_LOAD_PENDING)
+            return _lunoLoader.loads[index].state == LUNO_LOAD_DONE;
 
-                LunoColor *dstPixel = &_lunoContext.backbuffer.pixels[dstX + dstY * _lunoContext.backbuffer.width];
-                LunoColor srcPixel = image->pixels[i + j * image->width];
-                *dstPixel = _Luno_BlendPixel(*dstPixel, srcPixel);
-            }
+        _Luno_MutexLock(&_lunoLoader.mutex);
+        _LunoLoad *entry = &_lunoLoader.loads[index];
+        if (entry->stage == _LUNO_LOAD_QUEUED)
+        {
+            // Nobody took it yet: loading it here beats waiting for the loads ahead of it
+            _Luno_HeapRemove(entry->heapIndex);
+            entry->stage = _LUNO_LOAD_RUNNING;
+            _LunoLoad copy = *entry;
+            _Luno_MutexUnlock(&_lunoLoader.mutex);
+            _Luno_RunLoad(&copy);
+            _Luno_MutexLock(&_lunoLoader.mutex);
+            _Luno_LoadFinish(index, &copy);
+        }
+        while (entry->stage != _LUNO_LOAD_FINISHED)
+            _Luno_CondWait(&_lunoLoader.done, &_lunoLoader.mutex);
+
+        // Take it out of the finished list so Luno_Update does not dispatch it again
+        int *link = &_lunoLoader.finishedHead;
+        int prev = -1;
+        while (*link != index)
+        {
+            prev = *link;
+            link = &_lunoLoader.loads[*link].next;
         }
+        *link = entry->next;
+        if (_lunoLoader.finishedTail == index)
+            _lunoLoader.finishedTail = prev;
+        _Luno_MutexUnlock(&_lunoLoader.mutex);
+
+        bool loaded = (entry->image || entry->font);
+        _Luno_LoadDispatch(index);
+        return loaded;
     }
 
-    void Luno_DestroyImage(LunoImage *image)
+    int Luno_GetFinishedLoads(int *loads, int maxLoads)
     {
-        if (image && image->pixels)
+        for (int i = 0; loads && i < _lunoLoader.dispatchedCount && i < maxLoads; i++)
         {
-            free(image->pixels);
-            image->pixels = NULL;
-            image->width = 0;
-            image->height = 0;
+            loads[i] = _lunoLoader.dispatched[i];
         }
+        return _lunoLoader.dispatchedCount;
     }
 
     void Luno_DrawLine(int x1, int y1, int x2, int y2, LunoColor color)
     {
-        int dx = abs(x2 - x1);
-        int dy = abs(y2 - y1);
-        int sx = x1 < x2 ? 1 : -1;
-        int sy = y1 < y2 ? 1 : -1;
-        int err = dx - dy;
+        if (color.a == 0)
+            return;
 
-        while (true)
-        {
-            Luno_DrawPixel(x1, y1, color);
-            if (x1 == x2 && y1 == y2)
-                break;
-            int e2 = 2 * err;
-            if (e2 > -dy)
-            {
-                err -= dy;
-                x1 += sx;
-            }
-            if (e2 < dx)
-            {
-                err += dx;
-                y1 += sy;
-            }
-        }
+        LunoRect bounds = {_Luno_Min(x1, x2), _Luno_Min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1};
+        _LunoShapeArgs *args = (_LunoShapeArgs *)_Luno_EncodeCommand(_LUNO_DRAW_LINE, bounds, _Luno_ToPixel(color), false, sizeof(_LunoShapeArgs));
+        if (!args)
+            return;
+        *args = (_LunoShapeArgs){x1, y1, x2, y2};
+        _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
     }
 
     void Luno_DrawRect(LunoRect rect, LunoColor color, bool fill)
     {
+        if (color.a == 0)
+            return;
+
         if (fill)
         {
-            for (int y = rect.y; y < rect.y + rect.h; y++)
-            {
-                Luno_DrawLine(rect.x, y, rect.x + rect.w - 1, y, color);
-            }
-        }
-        else
-        {
-            Luno_DrawLine(rect.x, rect.y, rect.x + rect.w - 1, rect.y, color);                           // Top border
-            Luno_DrawLine(rect.x, rect.y + rect.h - 1, rect.x + rect.w - 1, rect.y + rect.h - 1, color); // Bottom border
-            Luno_DrawLine(rect.x, rect.y, rect.x, rect.y + rect.h - 1, color);                           // Left border
-            Luno_DrawLine(rect.x + rect.w - 1, rect.y, rect.x + rect.w - 1, rect.y + rect.h - 1, color); // Right border
+            // The clipped bounds are all a filled rect needs
+            if (_Luno_EncodeCommand(_LUNO_DRAW_RECT, rect, _Luno_ToPixel(color), true, 0))
+                _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
+            return;
         }
+
+        // The outline runs from x to x + w - 1, even for degenerate sizes
+        LunoRect bounds = _Luno_UnionRect((LunoRect){rect.x, rect.y, 1, 1}, (LunoRect){rect.x + rect.w - 1, rect.y + rect.h - 1, 1, 1});
+        _LunoShapeArgs *args = (_LunoShapeArgs *)_Luno_EncodeCommand(_LUNO_DRAW_RECT, bounds, _Luno_ToPixel(color), false, sizeof(_LunoShapeArgs));
+        if (!args)
+            return;
+        *args = (_LunoShapeArgs){rect.x, rect.y, rect.w, rect.h};
+        _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
     }
 
     void Luno_DrawCircle(int x, int y, int radius, LunoColor color, bool fill)
     {
-        int px = 0;
-        int py = radius;
-        int d = 1 - radius;
+        if (color.a == 0 || (fill && radius < 0))
+            return;
 
-        while (px <= py)
-        {
-            // Draw symmetric points for the current pixel
-            if (fill)
-            {
-                for (int i = -py; i <= py; i++)
-                {
-                    Luno_DrawPixel(x + px, y + i, color);
-                    Luno_DrawPixel(x - px, y + i, color);
-                }
-                for (int i = -px; i <= px; i++)
-                {
-                    Luno_DrawPixel(x + py, y + i, color);
-                    Luno_DrawPixel(x - py, y + i, color);
-                }
-            }
-            else
-            {
-                // Draw only border pixels
-                Luno_DrawPixel(x + px, y + py, color);
-                Luno_DrawPixel(x - px, y + py, color);
-                Luno_DrawPixel(x + px, y - py, color);
-                Luno_DrawPixel(x - px, y - py, color);
-                Luno_DrawPixel(x + py, y + px, color);
-                Luno_DrawPixel(x - py, y + px, color);
-                Luno_DrawPixel(x + py, y - px, color);
-                Luno_DrawPixel(x - py, y - px, color);
-            }
+        LunoRect bounds = {x - abs(radius), y - abs(radius), 2 * abs(radius) + 1, 2 * abs(radius) + 1};
+        _LunoShapeArgs *args = (_LunoShapeArgs *)_Luno_EncodeCommand(_LUNO_DRAW_CIRCLE, bounds, _Luno_ToPixel(color), fill, sizeof(_LunoShapeArgs));
+        if (!args)
+            return;
+        *args = (_LunoShapeArgs){x, y, radius, 0};
+        _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
+    }
 
-            // Update the decision parameter and pixel positions
-            if (d < 0)
-            {
-                d += 2 * px + 3;
-            }
-            else
-            {
-                d += 2 * (px - py) + 5;
-                py--;
-            }
-            px++;
-        }
+    void Luno_DrawEllipse(int x, int y, int radiusX, int radiusY, LunoColor color, bool fill)
+    {
+        if (radiusX < 0 || radiusY < 0 || color.a == 0)
+            return;
+
+        LunoRect bounds = {x - radiusX, y - radiusY, 2 * radiusX + 1, 2 * radiusY + 1};
+        _LunoShapeArgs *args = (_LunoShapeArgs *)_Luno_EncodeCommand(_LUNO_DRAW_ELLIPSE, bounds, _Luno_ToPixel(color), fill, sizeof(_LunoShapeArgs));
+        if (!args)
+            return;
+        *args = (_LunoShapeArgs){x, y, radiusX, radiusY};
+        _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
     }
 
     bool Luno_Update()
@@ -914,17 +5812,33 @@ extern "C"
             exit(0);
         }
         // present
-        // RedrawWindow(_lunoContext.hwnd, 0, 0, RDW_INVALIDATE | RDW_UPDATENOW);
-        InvalidateRect(_lunoContext.hwnd, NULL, FALSE);
+        _Luno_FlushDraws();
+        if (_lunoStats.overlay)
+            _Luno_DrawStatsOverlay();
+        double presentStart = _lunoStats.enabled ? _Luno_PerfNow() : 0;
+        if (_lunoPresent.count > 1)
+        {
+            _Luno_QueueFrame();
+        }
+        else
+        {
+            _Luno_PlatformPresent();
+            if (_lunoPresent.callback)
+                _lunoPresent.callback(&_lunoContext.backbuffer, _lunoPresent.user);
+        }
+        _lunoContext.dirtyCount = 0;
+        _lunoContext.dirtyFull = !_lunoContext.partialPresent;
 
-        double now = GetTickCount64() / 1000.0;
-        double wait = (_lunoContext.prevTime + _lunoContext.stepTime) - now;
+        double sleepStart = _lunoStats.enabled ? _Luno_PerfNow() : 0;
+        double now = _Luno_Now();
+        double deadline = _lunoContext.prevTime + _lunoContext.stepTime;
         double prev = _lunoContext.prevTime;
 
-        if (wait > 0)
+        if (deadline > now)
         {
-            Sleep((DWORD)(wait * 1000));
-            _lunoContext.prevTime += _lunoContext.stepTime;
+            // Frames start on the schedule rather than on the wake-up, so lunoDT stays at the exact step
+            _Luno_PlatformSleepUntil(deadline);
+            _lunoContext.prevTime = deadline;
         }
         else
         {
@@ -935,11 +5849,23 @@ extern "C"
         lunoFPS = (lunoDT > 0) ? (1.0 / lunoDT) : 0;
         lunoMS = (int)((_lunoContext.prevTime - _lunoContext.startTime) * 1000);
 
-        if (lunoDT > _lunoContext.stepTime * 10)
+        if (_lunoContext.stepTime > 0 && lunoDT > _lunoContext.stepTime * 10)
         {
             lunoDT = _lunoContext.stepTime;
         }
 
+        if (_lunoContext.fixedStep > 0)
+        {
+            _lunoContext.accumulator += lunoDT;
+            if (_lunoContext.accumulator > _lunoContext.fixedStep * LUNO_MAX_FIXED_STEPS)
+                _lunoContext.accumulator = _lunoContext.fixedStep * LUNO_MAX_FIXED_STEPS;
+        }
+
+        if (_lunoWheel.initialized)
+            _Luno_WheelAdvance(_Luno_FrameTick());
+        if (_lunoLoader.initialized)
+            _Luno_LoaderDispatch();
+
         for (int i = 0; i < 256; i++)
         {
             _lunoContext.keysPrev[i] = _lunoContext.keys[i];
@@ -949,18 +5875,11 @@ extern "C"
             _lunoContext.mouseButtonsPrev[i] = _lunoContext.mouseButtons[i];
         }
 
-        MSG msg;
-        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-        {
-            if (msg.message == WM_QUIT)
-            {
-                return false;
-            }
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
-        }
-
-        return true;
+        double pumpStart = _lunoStats.enabled ? _Luno_PerfNow() : 0;
+        bool running = _Luno_PlatformPumpMessages();
+        if (_lunoStats.enabled)
+            _Luno_FinishFrameStats(presentStart, sleepStart, pumpStart);
+        return running;
     }
 
     bool Luno_IsKeyPressed(int key)
@@ -1019,20 +5938,7 @@ extern "C"
         _lunoContext.isCursorHidden = !visible;
 
         // Update the cursor state
-        if (visible)
-        {
-            SetCursor(LoadCursor(NULL, IDC_ARROW)); // Restore default cursor
-        }
-        else
-        {
-            SetCursor(NULL); // Hide the cursor
-        }
-
-        // Force cursor re-evaluation for the client area
-        if (_lunoContext.hwnd)
-        {
-            PostMessage(_lunoContext.hwnd, WM_SETCURSOR, 0, HTCLIENT);
-        }
+        _Luno_PlatformSetCursorVisibility(visible);
     }
 
     bool Luno_IsCursorVisible()
@@ -1040,17 +5946,23 @@ extern "C"
         return !_lunoContext.isCursorHidden;
     }
 
+    // Milliseconds since Luno_Create, small enough for the int fields of LunoTimer.
+    static int _Luno_Millis(void)
+    {
+        return (int)((_Luno_Now() - _lunoContext.startTime) * 1000);
+    }
+
     LunoTimer Luno_CreateTimer(int interval)
     {
         LunoTimer timer;
         timer.interval = interval;
-        timer.lastTrigger = (int)(_Luno_Now() * 1000);
+        timer.lastTrigger = _Luno_Millis();
         return timer;
     }
 
     bool Luno_TimerTicked(LunoTimer *timer)
     {
-        int now = (int)(_Luno_Now() * 1000);
+        int now = _Luno_Millis();
         if ((now - timer->lastTrigger) >= timer->interval)
         {
             timer->lastTrigger = now;
@@ -1061,40 +5973,190 @@ extern "C"
 
     void Luno_ResetTimer(LunoTimer *timer)
     {
-        timer->lastTrigger = (int)(_Luno_Now() * 1000);
+        timer->lastTrigger = _Luno_Millis();
     }
 
     int Luno_TimerElapsed(LunoTimer *timer)
     {
-        int now = (int)(_Luno_Now() * 1000);
+        int now = _Luno_Millis();
         return now - timer->lastTrigger;
     }
 
+    int Luno_StartTimer(int delay, int interval, void (*callback)(int timer, void *user), void *user)
+    {
+        if (!_lunoWheel.initialized)
+        {
+            for (int i = 0; i <= LUNO_WHEEL_PENDING; i++)
+                _lunoWheel.heads[i] = -1;
+            _lunoWheel.freeList = -1;
+            _lunoWheel.now = _Luno_FrameTick();
+            _lunoWheel.initialized = true;
+        }
+
+        int index = _lunoWheel.freeList;
+        if (index >= 0)
+        {
+            _lunoWheel.freeList = _lunoWheel.timers[index].next;
+        }
+        else
+        {
+            // Handles keep 20 bits for the index
+            if (_lunoWheel.count == 0xFFFFF)
+                return 0;
+            if (_lunoWheel.count == _lunoWheel.capacity)
+            {
+                int capacity = _lunoWheel.capacity ? _lunoWheel.capacity * 2 : 64;
+                _LunoWheelTimer *timers = (_LunoWheelTimer *)LUNO_REALLOC(_lunoWheel.timers, capacity * sizeof(_LunoWheelTimer));
+                if (!timers)
+                    return 0;
+                _lunoWheel.timers = timers;
+                _lunoWheel.capacity = capacity;
+            }
+            index = _lunoWheel.count++;
+            _lunoWheel.timers[index].generation = 0;
+        }
+
+        _LunoWheelTimer *timer = &_lunoWheel.timers[index];
+        timer->expires = _lunoWheel.now + (delay > 0 ? delay : 1);
+        timer->interval = interval > 0 ? interval : 0;
+        timer->callback = callback;
+        timer->user = user;
+        _Luno_WheelSchedule(index);
+        return _Luno_WheelHandle(index);
+    }
+
+    bool Luno_CancelTimer(int timer)
+    {
+        int index = _Luno_WheelFind(timer);
+        if (index < 0)
+            return false;
+        _Luno_WheelUnlink(index);
+        _Luno_WheelFree(index);
+        return true;
+    }
+
+    bool Luno_IsTimerPending(int timer)
+    {
+        return _Luno_WheelFind(timer) >= 0;
+    }
+
+    int Luno_GetExpiredTimers(int *timers, int maxTimers)
+    {
+        for (int i = 0; timers && i < _lunoWheel.expiredCount && i < maxTimers; i++)
+        {
+            timers[i] = _lunoWheel.expired[i];
+        }
+        return _lunoWheel.expiredCount;
+    }
+
+    long long Luno_GetTimeNs()
+    {
+        return (long long)((_Luno_Now() - _lunoContext.startTime) * 1e9);
+    }
+
+    void Luno_SetFixedTimestep(double seconds)
+    {
+        _lunoContext.fixedStep = seconds > 0 ? seconds : 0;
+        _lunoContext.accumulator = 0;
+    }
+
+    bool Luno_StepFixed()
+    {
+        if (_lunoContext.fixedStep <= 0 || _lunoContext.accumulator < _lunoContext.fixedStep)
+            return false;
+        _lunoContext.accumulator -= _lunoContext.fixedStep;
+        return true;
+    }
+
+    double Luno_GetInterpolationAlpha()
+    {
+        if (_lunoContext.fixedStep <= 0)
+            return 0;
+        return _lunoContext.accumulator / _lunoContext.fixedStep;
+    }
+
     LunoFont *Luno_FontFromImage(LunoImage *image, int glyphWidth, int glyphHeight)
     {
-        LunoFont *font = (LunoFont *)malloc(sizeof(LunoFont));
+        LunoFont *font = (LunoFont *)LUNO_MALLOC(sizeof(LunoFont));
         if (!font)
             return NULL;
 
         if (glyphWidth <= 0 || glyphHeight <= 0 || image->width % glyphWidth != 0 || image->height % glyphHeight != 0)
         {
-            free(font);
+            LUNO_FREE(font);
             return NULL;
         }
 
         font->image = image;
+        font->ownsImage = false;
 
         int charWidth = image->width / glyphWidth;
         int charHeight = image->height / glyphHeight;
 
+        // Glyph alpha is used as coverage. Binary fonts store one bit per pixel, others one byte.
+        bool binary = _Luno_ClassifyImage(image) != LUNO_ALPHA_TRANSLUCENT;
+        int pitch = _Luno_Pitch(image);
+        font->maskBits = binary ? 1 : 8;
+        size_t maskSize = 0;
+
         for (int i = 0; i < 256; i++)
         {
             LunoGlyph *glyph = &font->glyphs[i];
             glyph->rect.x = (i % glyphWidth) * charWidth;
-            glyph->rect.y = (i / glyphHeight) * charHeight;
+            glyph->rect.y = (i / glyphWidth) * charHeight;
             glyph->rect.w = charWidth;
             glyph->rect.h = charHeight;
             glyph->xadv = charWidth; // Default advance is the character width
+
+            // Tight bounds of the covered pixels; glyphs past the end of the image stay empty
+            int x0 = charWidth, y0 = charHeight, x1 = 0, y1 = 0;
+            for (int y = 0; y < charHeight && glyph->rect.y + y < image->height; y++)
+            {
+                const LunoColor *row = &image->pixels[glyph->rect.x + (glyph->rect.y + y) * pitch];
+                for (int x = 0; x < charWidth; x++)
+                {
+                    if (row[x].a == 0)
+                        continue;
+                    x0 = _Luno_Min(x0, x);
+                    x1 = _Luno_Max(x1, x + 1);
+                    y0 = _Luno_Min(y0, y);
+                    y1 = _Luno_Max(y1, y + 1);
+                }
+            }
+
+            if (x0 < x1)
+                glyph->bounds = (LunoRect){x0, y0, x1 - x0, y1 - y0};
+            else
+                glyph->bounds = (LunoRect){0, 0, 0, 0};
+            glyph->maskPitch = binary ? (glyph->bounds.w + 7) / 8 : glyph->bounds.w;
+            glyph->maskOffset = (int)maskSize;
+            glyph->covered = 0; // Counted while the mask is filled in
+            maskSize += (size_t)glyph->maskPitch * glyph->bounds.h;
+        }
+
+        font->mask = (unsigned char *)LUNO_CALLOC(maskSize > 0 ? maskSize : 1, 1);
+        if (!font->mask)
+        {
+            LUNO_FREE(font);
+            return NULL;
+        }
+
+        for (int i = 0; i < 256; i++)
+        {
+            LunoGlyph *glyph = &font->glyphs[i];
+            for (int y = 0; y < glyph->bounds.h; y++)
+            {
+                const LunoColor *row = &image->pixels[glyph->rect.x + glyph->bounds.x + (glyph->rect.y + glyph->bounds.y + y) * pitch];
+                unsigned char *mask = font->mask + glyph->maskOffset + y * glyph->maskPitch;
+                for (int x = 0; x < glyph->bounds.w; x++)
+                {
+                    if (!binary)
+                        mask[x] = row[x].a;
+                    else if (row[x].a)
+                        mask[x >> 3] |= (unsigned char)(0x80 >> (x & 7));
+                    glyph->covered += row[x].a != 0;
+                }
+            }
         }
 
         return font;
@@ -1102,12 +6164,26 @@ extern "C"
 
     LunoFont *Luno_LoadFont(const char *filePath, int glyphWidth, int glyphHeight)
     {
+        // Bundles may hold the glyphs ready-made; otherwise they are built from the image
+        LunoPak *pak;
+        int index = filePath ? _Luno_PakFind(filePath, &pak) : -1;
+        LunoFont *packed = (index >= 0) ? _Luno_PakFont(pak, index, glyphWidth, glyphHeight, false) : NULL;
+        if (packed)
+            return packed;
+
         LunoImage *fontImage = Luno_LoadImage(filePath);
 
         if (!fontImage)
             return NULL;
 
-        return Luno_FontFromImage(fontImage, glyphWidth, glyphHeight);
+        LunoFont *font = Luno_FontFromImage(fontImage, glyphWidth, glyphHeight);
+        if (!font)
+        {
+            Luno_DestroyImage(fontImage);
+            return NULL;
+        }
+        font->ownsImage = true;
+        return font;
     }
 
     LunoFont *Luno_LoadFontMem(unsigned char *buffer, int bufferLen, int glyphWidth, int glyphHeight)
@@ -1116,14 +6192,25 @@ extern "C"
         if (!fontImage)
             return NULL;
 
-        return Luno_FontFromImage(fontImage, glyphWidth, glyphHeight);
+        LunoFont *font = Luno_FontFromImage(fontImage, glyphWidth, glyphHeight);
+        if (!font)
+        {
+            Luno_DestroyImage(fontImage);
+            return NULL;
+        }
+        font->ownsImage = true;
+        return font;
     }
 
     void Luno_DestroyFont(LunoFont *font)
     {
         if (!font)
             return;
-        free(font);
+        _Luno_FlushDraws();
+        if (font->ownsImage)
+            Luno_DestroyImage(font->image);
+        LUNO_FREE(font->mask);
+        LUNO_FREE(font);
     }
 
     void Luno_SetFont(LunoFont *font)
@@ -1184,38 +6271,31 @@ extern "C"
             exit(0);
         }
 
-        for (const char *p = text; *p; p++)
-        {
-            unsigned char c = *p;
-            LunoGlyph *glyph = &_lunoContext.currentFont->glyphs[c];
+        LunoColor pixel = _Luno_ToPixel(color); // Convert once, not per texel
+        if (pixel.a == 0)
+            return;
 
-            for (int j = 0; j < glyph->rect.h; j++)
+        // The text is copied into the command, split where it would not fit into one
+        LunoFont *font = _lunoContext.currentFont;
+        size_t maxLength = _LUNO_MAX_COMMAND_SIZE - sizeof(_LunoCommand) - sizeof(_LunoTextArgs) - 1;
+        size_t length = strlen(text);
+        while (length > 0)
+        {
+            size_t chunk = length < maxLength ? length : maxLength;
+            LunoRect bounds = _Luno_TextBounds(font, text, chunk, x, y);
+            _LunoTextArgs *args = (_LunoTextArgs *)_Luno_EncodeCommand(_LUNO_DRAW_TEXT, bounds, pixel, false, sizeof(_LunoTextArgs) + chunk + 1);
+            if (args)
             {
-                for (int i = 0; i < glyph->rect.w; i++)
-                {
-                    int srcX = glyph->rect.x + i;
-                    int srcY = glyph->rect.y + j;
-                    int dstX = x + i;
-                    int dstY = y + j;
-
-                    if (dstX < 0 || dstY < 0 || dstX >= _lunoContext.backbuffer.width || dstY >= _lunoContext.backbuffer.height)
-                        continue;
-
-                    LunoColor *srcPixel = &_lunoContext.currentFont->image->pixels[srcX + srcY * _lunoContext.currentFont->image->width];
-                    if (srcPixel->a == 0)
-                        continue; // Skip fully transparent pixels
-
-                    // Blend the glyph pixel with the provided text color
-                    LunoColor textColor = {color.b, color.g, color.r, color.a};
-                    LunoColor blendedPixel = _Luno_BlendPixel(*srcPixel, textColor);
-
-                    // Write the blended pixel to the backbuffer
-                    LunoColor *dstPixel = &_lunoContext.backbuffer.pixels[dstX + dstY * _lunoContext.backbuffer.width];
-                    *dstPixel = _Luno_BlendPixel(*dstPixel, blendedPixel);
-                }
+                *args = (_LunoTextArgs){font, x, y};
+                memcpy(args + 1, text, chunk);
+                ((char *)(args + 1))[chunk] = '\0';
+                _Luno_SubmitCommand((const _LunoCommand *)_lunoContext.scratch.data);
             }
 
-            x += glyph->xadv; // Advance the x position
+            for (size_t i = 0; i < chunk; i++)
+                x += font->glyphs[(unsigned char)text[i]].xadv;
+            text += chunk;
+            length -= chunk;
         }
     }
 
@@ -1260,192 +6340,319 @@ extern "C"
         return (distanceSquared <= radiusSum * radiusSum) ? true : false;
     }
 
-#ifdef __cplusplus
-}
-#endif
-
-//////////////////////////////////////////////////////////////////////////////
-// Tga loading functions
-//////////////////////////////////////////////////////////////////////////////
+    LunoImage *Luno_GetBackbuffer()
+    {
+        _Luno_FlushDraws();
+        return &_lunoContext.backbuffer;
+    }
 
-unsigned char *rc_load_tga_mem(unsigned char *data, size_t size, int *width, int *height)
-{
-    if (size < 18)
+    void Luno_ReadFrame(LunoColor *pixels)
     {
-        fprintf(stderr, "Invalid TGA data: insufficient size\n");
-        return NULL;
+        if (!pixels || !_lunoContext.backbuffer.pixels)
+        {
+            printf("ERROR <Luno_ReadFrame>: No window! Create a window first!");
+            exit(0);
+        }
+
+        _Luno_FlushDraws();
+        int count = _lunoContext.backbuffer.width * _lunoContext.backbuffer.height;
+        Luno_ConvertPixels(pixels, LUNO_FORMAT_RGBA32, _lunoContext.backbuffer.pixels, LUNO_FORMAT_NATIVE, count);
     }
 
-    // Read the TGA header
-    unsigned char *header = data;
+    void Luno_MarkDirty(LunoRect rect)
+    {
+        _Luno_MarkDirty(rect);
+    }
 
-    // Verify image type (uncompressed or RLE compressed true-color)
-    if (header[2] != 2 && header[2] != 10)
+    int Luno_GetDirtyRects(LunoRect *rects, int maxRects)
     {
-        fprintf(stderr, "Unsupported TGA image type (only uncompressed or RLE true-color supported)\n");
-        return NULL;
+        if (_lunoContext.dirtyFull)
+        {
+            if (rects && maxRects > 0)
+                rects[0] = (LunoRect){0, 0, _lunoContext.backbuffer.width, _lunoContext.backbuffer.height};
+            return 1;
+        }
+
+        for (int i = 0; rects && i < _lunoContext.dirtyCount && i < maxRects; i++)
+        {
+            rects[i] = _lunoContext.dirtyRects[i];
+        }
+        return _lunoContext.dirtyCount;
     }
 
-    // Extract image dimensions and pixel depth
-    *width = header[12] | (header[13] << 8);
-    *height = header[14] | (header[15] << 8);
-    int pixel_depth = header[16];
+    void Luno_SetPartialPresent(bool enabled)
+    {
+        _lunoContext.partialPresent = enabled;
+        if (!enabled)
+            _Luno_MarkAllDirty();
+    }
 
-    if (pixel_depth != 32 && pixel_depth != 24)
+    void Luno_SetFrameStats(bool enabled)
     {
-        fprintf(stderr, "Unsupported TGA pixel depth (only 24-bit and 32-bit supported)\n");
-        return NULL;
+        if (enabled && !_lunoStats.enabled)
+        {
+            // Start over, the first frame is measured from here
+            memset(&_lunoStats.current, 0, sizeof(_lunoStats.current));
+            memset(&_lunoStats.last, 0, sizeof(_lunoStats.last));
+            _lunoStats.windowCount = 0;
+            _lunoStats.windowNext = 0;
+            _lunoStats.frameEnd = _Luno_PerfNow();
+        }
+        _lunoStats.enabled = enabled;
+        if (!enabled)
+            _lunoStats.overlay = false;
     }
 
-    const unsigned char *pixel_data = data + 18;
-    size_t data_size = size - 18;
+    void Luno_GetFrameStats(LunoFrameStats *stats)
+    {
+        if (stats)
+            *stats = _lunoStats.last;
+    }
 
-    unsigned char *pixels = malloc((*width) * (*height) * 4);
-    if (!pixels)
+    void Luno_SetStatsOverlay(bool visible)
     {
-        fprintf(stderr, "Memory allocation failed for pixel data\n");
-        return NULL;
+        if (visible)
+            Luno_SetFrameStats(true);
+        _lunoStats.overlay = visible;
     }
 
-    if (header[2] == 2)
+    void Luno_SetFrameBuffering(int count)
     {
-        // Uncompressed TGA
-        int bytes_per_pixel = pixel_depth / 8;
-        if (data_size < (*width) * (*height) * bytes_per_pixel)
+        LunoImage *bb = &_lunoContext.backbuffer;
+        if (!bb->pixels)
         {
-            fprintf(stderr, "Insufficient pixel data for uncompressed TGA\n");
-            free(pixels);
-            return NULL;
+            printf("ERROR <Luno_SetFrameBuffering>: No window! Create a window first!");
+            exit(0);
         }
 
-        for (int i = 0; i < (*width) * (*height); i++)
+        count = _Luno_Max(1, _Luno_Min(count, 3));
+        _Luno_FlushDraws();
+        _Luno_PresentStop();
+        if (!_lunoPresent.initialized)
         {
-            int src_index = i * bytes_per_pixel;
-            int dst_index = i * 4;
+            _Luno_MutexInit(&_lunoPresent.mutex);
+            _Luno_CondInit(&_lunoPresent.wake);
+            _Luno_CondInit(&_lunoPresent.done);
+            _lunoPresent.initialized = true;
+        }
 
-            pixels[dst_index + 0] = pixel_data[src_index + 0];                                // Blue
-            pixels[dst_index + 1] = pixel_data[src_index + 1];                                // Green
-            pixels[dst_index + 2] = pixel_data[src_index + 2];                                // Red
-            pixels[dst_index + 3] = (bytes_per_pixel == 4) ? pixel_data[src_index + 3] : 255; // Alpha
+        // Keep the buffer being drawn as the first one, new buffers catch up on its content when first drawn
+        for (int i = 0; i < _lunoPresent.count; i++)
+        {
+            if (_lunoPresent.frames[i].image.pixels != bb->pixels)
+                _Luno_AlignedFree(_lunoPresent.frames[i].image.pixels);
+        }
+        memset(_lunoPresent.frames, 0, sizeof(_lunoPresent.frames));
+        for (int i = 0; i < count; i++)
+        {
+            _LunoFrame *frame = &_lunoPresent.frames[i];
+            frame->image = *bb;
+            if (i > 0)
+            {
+                frame->image.pixels = (LunoColor *)_Luno_AlignedAlloc((size_t)bb->width * bb->height * sizeof(LunoColor));
+                if (!frame->image.pixels)
+                {
+                    printf("ERROR <Luno_SetFrameBuffering>: Out of memory!");
+                    exit(0);
+                }
+                frame->behind = (LunoRect){0, 0, bb->width, bb->height};
+            }
         }
+        _lunoPresent.count = count;
+        _lunoPresent.current = 0;
+        _lunoPresent.state = _Luno_PresentState(-1, -1);
+        _Luno_PresentStart();
+    }
+
+    void Luno_SetPresentCallback(void (*callback)(const LunoImage *frame, void *user), void *user)
+    {
+        // The present thread reads the callback without locking, so swap it while the thread is stopped
+        _Luno_PresentStop();
+        _lunoPresent.callback = callback;
+        _lunoPresent.user = user;
+        _Luno_PresentStart();
+    }
+
+    void Luno_SetThreadCount(int count)
+    {
+        _Luno_FlushDraws();
+        _Luno_PoolStop(); // Restarted with the new count on the next parallel job
+        _lunoPool.threadCount = _Luno_Max(count, 0);
+    }
+
+    int Luno_GetThreadCount()
+    {
+        return _Luno_ThreadCount();
     }
-    else if (header[2] == 10)
+
+    void Luno_ParallelFor(int count, int grain, void (*fn)(void *data, int begin, int end), void *data)
     {
-        // RLE-compressed TGA
-        const unsigned char *ptr = pixel_data;
-        unsigned char *out_ptr = pixels;
-        int pixel_count = (*width) * (*height);
-        int bytes_per_pixel = pixel_depth / 8;
+        if (!fn || count <= 0)
+            return;
 
-        while (pixel_count > 0 && ptr < data + size)
+        grain = _Luno_Max(grain, 1);
+        if (count <= grain)
         {
-            unsigned char packet_header = *ptr++;
-            int packet_size = (packet_header & 0x7F) + 1;
+            fn(data, 0, count);
+            return;
+        }
 
-            if (packet_header & 0x80)
-            {
-                // RLE packet
-                if (ptr + bytes_per_pixel > data + size)
-                {
-                    fprintf(stderr, "Insufficient RLE pixel data\n");
-                    free(pixels);
-                    return NULL;
-                }
+        _LunoParallelFor loop = {fn, data, count, grain};
+        _Luno_RunParallel(_Luno_ParallelBand, &loop, (count - 1) / grain + 1);
+    }
 
-                for (int i = 0; i < packet_size; i++)
-                {
-                    if (pixel_count <= 0)
-                        break;
+    void Luno_SetTiledRendering(bool enabled)
+    {
+        _Luno_FlushDraws();
+        _lunoContext.tiledRendering = enabled;
+    }
 
-                    out_ptr[0] = ptr[0];                                // Blue
-                    out_ptr[1] = ptr[1];                                // Green
-                    out_ptr[2] = ptr[2];                                // Red
-                    out_ptr[3] = (bytes_per_pixel == 4) ? ptr[3] : 255; // Alpha
+    LunoCommandBuffer *Luno_CreateCommandBuffer()
+    {
+        LunoCommandBuffer *buffer = (LunoCommandBuffer *)LUNO_CALLOC(1, sizeof(LunoCommandBuffer));
+        if (!buffer)
+        {
+            printf("ERROR <Luno_CreateCommandBuffer>: Out of memory!");
+            exit(0);
+        }
+        return buffer;
+    }
 
-                    out_ptr += 4;
-                    pixel_count--;
-                }
-                ptr += bytes_per_pixel;
-            }
-            else
-            {
-                // Raw packet
-                int raw_size = packet_size * bytes_per_pixel;
-                if (ptr + raw_size > data + size)
-                {
-                    fprintf(stderr, "Insufficient raw pixel data\n");
-                    free(pixels);
-                    return NULL;
-                }
+    void Luno_BeginCommandBuffer(LunoCommandBuffer *buffer)
+    {
+        if (!buffer)
+        {
+            printf("ERROR <Luno_BeginCommandBuffer>: Invalid command buffer!");
+            exit(0);
+        }
 
-                for (int i = 0; i < packet_size; i++)
-                {
-                    if (pixel_count <= 0)
-                        break;
+        buffer->size = 0;
+        buffer->count = 0;
+        _lunoContext.recording = buffer;
+    }
 
-                    out_ptr[0] = ptr[0];                                // Blue
-                    out_ptr[1] = ptr[1];                                // Green
-                    out_ptr[2] = ptr[2];                                // Red
-                    out_ptr[3] = (bytes_per_pixel == 4) ? ptr[3] : 255; // Alpha
+    void Luno_EndCommandBuffer()
+    {
+        _lunoContext.recording = NULL;
+    }
 
-                    out_ptr += 4;
-                    ptr += bytes_per_pixel;
-                    pixel_count--;
-                }
-            }
+    void Luno_SubmitCommandBuffer(LunoCommandBuffer *buffer)
+    {
+        if (!buffer || buffer == _lunoContext.recording)
+        {
+            printf("ERROR <Luno_SubmitCommandBuffer>: Invalid command buffer!");
+            exit(0);
         }
 
-        if (pixel_count > 0)
+        for (int offset = 0; offset < buffer->size;)
         {
-            fprintf(stderr, "Not enough pixel data for RLE-compressed TGA\n");
-            free(pixels);
-            return NULL;
+            const _LunoCommand *cmd = (const _LunoCommand *)(buffer->data + offset);
+            _Luno_SubmitCommand(cmd);
+            offset += cmd->size * 8;
         }
     }
 
-    return pixels;
-}
+    int Luno_GetCommandCount(LunoCommandBuffer *buffer)
+    {
+        return buffer ? buffer->count : 0;
+    }
 
-static unsigned char *rc_load_tga(const char *filename, int *width, int *height)
-{
-    FILE *file = fopen(filename, "rb");
-    if (!file)
+    void Luno_DestroyCommandBuffer(LunoCommandBuffer *buffer)
     {
-        perror("Failed to open TGA file");
-        return NULL;
+        if (!buffer)
+            return;
+        if (_lunoContext.recording == buffer)
+            _lunoContext.recording = NULL;
+        LUNO_FREE(buffer->data);
+        LUNO_FREE(buffer);
     }
 
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+#ifdef LUNO_HEADLESS
+    void Luno_SetTimeSource(double (*timeSource)(void))
+    {
+        _lunoContext.timeSource = timeSource;
+    }
 
-    if (file_size <= 0)
+    void Luno_InjectKey(int key, bool down)
     {
-        fprintf(stderr, "Invalid TGA file size\n");
-        fclose(file);
-        return NULL;
+        if (key < 0 || key >= 256)
+            return;
+        _lunoContext.keys[key] = down;
+    }
+
+    void Luno_InjectMouseButton(int button, bool down)
+    {
+        if (button < 0 || button >= 3)
+            return;
+        _lunoContext.mouseButtons[button] = down;
+    }
+
+    void Luno_InjectMouseMove(int x, int y)
+    {
+        int prevx = _lunoContext.mousePos.x;
+        int prevy = _lunoContext.mousePos.y;
+
+        // Clamp the mouse position to the backbuffer dimensions
+        _lunoContext.mousePos.x = _Luno_Max(0, _Luno_Min(x, _lunoContext.backbuffer.width - 1));
+        _lunoContext.mousePos.y = _Luno_Max(0, _Luno_Min(y, _lunoContext.backbuffer.height - 1));
+
+        _lunoContext.mouseDelta.x += _lunoContext.mousePos.x - prevx;
+        _lunoContext.mouseDelta.y += _lunoContext.mousePos.y - prevy;
+    }
+
+    void Luno_InjectMouseWheel(int delta)
+    {
+        _lunoContext.mouseWheelDelta += delta;
+    }
+
+    void Luno_InjectQuit()
+    {
+        _lunoContext.quitRequested = true;
     }
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// Tga loading functions
+//////////////////////////////////////////////////////////////////////////////
+
+// Decodes a TGA to top-down BGRA pixels, released with LUNO_FREE. Luno_LoadImage decodes straight into the image.
+static inline unsigned char *rc_load_tga_mem(unsigned char *data, size_t size, int *width, int *height)
+{
+    _LunoTga tga;
+    if (!_Luno_ParseTga(data, size, &tga))
+        return NULL;
 
-    unsigned char *data = malloc(file_size);
-    if (!data)
+    unsigned char *pixels = LUNO_MALLOC((size_t)tga.width * tga.height * 4);
+    if (!pixels)
     {
-        fprintf(stderr, "Memory allocation failed for file data\n");
-        fclose(file);
+        fprintf(stderr, "Memory allocation failed for pixel data\n");
         return NULL;
     }
 
-    if (fread(data, 1, file_size, file) != (size_t)file_size)
+    LunoAlphaClass alpha_class;
+    if (!_Luno_DecodeTga(&tga, (LunoColor *)pixels, tga.width, false, true, &alpha_class))
     {
-        fprintf(stderr, "Failed to read TGA file\n");
-        free(data);
-        fclose(file);
+        LUNO_FREE(pixels);
         return NULL;
     }
 
-    fclose(file);
+    *width = tga.width;
+    *height = tga.height;
+    return pixels;
+}
+
+static inline unsigned char *rc_load_tga(const char *filename, int *width, int *height)
+{
+    _LunoFileView file;
+    if (!_Luno_OpenFileView(filename, &file, false))
+        return NULL;
 
-    unsigned char *pixels = rc_load_tga_mem(data, file_size, width, height);
-    free(data);
+    unsigned char *pixels = rc_load_tga_mem((unsigned char *)file.data, file.size, width, height);
+    _Luno_CloseFileView(&file);
     return pixels;
 }
 